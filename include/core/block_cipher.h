@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// OpenSSL cipher context
+struct evp_cipher_ctx_st;
+
+namespace dfs {
+namespace core {
+
+/**
+ * BlockCipher - AES-XTS encryption of data extents at rest
+ * Keys are held per volume or per tenant under a key id. Each extent is
+ * encrypted in place as one XTS data unit tweaked by its first block
+ * number, so reads decrypt directly in the buffer they were read into.
+ * Extents that are not a multiple of 16 bytes (compressed extents) use
+ * ciphertext stealing and keep their length. The cipher is libcrypto's
+ * XTS, which uses AES-NI or VAES where the CPU has them.
+ */
+class BlockCipher {
+public:
+    // XTS keys are a data key followed by a tweak key of the same size
+    static constexpr size_t XTS_AES128_KEY_SIZE = 32;
+    static constexpr size_t XTS_AES256_KEY_SIZE = 64;
+    
+    // Smallest data unit XTS can encrypt: one AES block
+    static constexpr size_t MIN_UNIT_SIZE = 16;
+    
+    BlockCipher();
+    
+    // Register or replace the key for a volume or tenant
+    void set_key(uint32_t key_id, const std::vector<uint8_t>& key);
+    
+    // Register a key read from a file holding the raw 32 or 64 key bytes,
+    // such as filesystem.encryption_key_file
+    void load_key_file(uint32_t key_id, const std::string& path);
+    
+    // Forget a key; its contexts are wiped once no operation is using them
+    void remove_key(uint32_t key_id);
+    
+    bool has_key(uint32_t key_id) const;
+    
+    // Encrypt or decrypt a data unit in place
+    void encrypt(uint32_t key_id, uint64_t sector, uint8_t* data, size_t size) const;
+    void decrypt(uint32_t key_id, uint64_t sector, uint8_t* data, size_t size) const;
+    
+private:
+    // Contexts keyed once for each direction; a call only sets the tweak
+    struct XtsContexts {
+        evp_cipher_ctx_st* encrypt;
+        evp_cipher_ctx_st* decrypt;
+    };
+    
+    // A key's contexts. A call borrows an idle pair and hands it back, so
+    // pairs are copied from the template only when more calls than ever
+    // before run on the key at once
+    struct XtsKey {
+        XtsContexts keyed;
+        mutable std::vector<XtsContexts> idle;
+        mutable std::mutex idle_mutex;
+        
+        XtsKey(const uint8_t* key, size_t key_size);
+        ~XtsKey();
+        
+        XtsKey(const XtsKey&) = delete;
+        XtsKey& operator=(const XtsKey&) = delete;
+        
+        XtsContexts acquire() const;
+        void release(XtsContexts contexts) const;
+    };
+    
+    std::unordered_map<uint32_t, std::shared_ptr<const XtsKey>> keys_;
+    mutable std::shared_mutex keys_mutex_;
+    
+    std::shared_ptr<const XtsKey> get_key(uint32_t key_id) const;
+    
+    // Clear a key buffer in a way the compiler cannot drop
+    static void wipe_key(std::vector<uint8_t>& key);
+    
+    static void process(const XtsKey& key, uint64_t sector, uint8_t* data, size_t size, bool encrypt);
+};
+
+} // namespace core
+} // namespace dfs
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+
+namespace dfs {
+namespace core {
+
+/**
+ * BlockCompressor - Transparent compression of data block groups
+ * A compressed group of consecutive blocks is stored as one extent: a header
+ * recording the algorithm, raw and stored lengths and a checksum of the raw
+ * data, followed by the payload. A group that would not save at least one
+ * whole block is stored raw and headerless, so it takes exactly its own
+ * blocks; the caller records which extents are raw in its extent map. Data
+ * that does not compress well is detected from a sample and stored raw
+ * without compressing the whole group. Decoded extents are kept in an LRU
+ * cache for reads.
+ */
+class BlockCompressor {
+public:
+    enum class Algorithm : uint8_t {
+        NONE = 0,   // Payload stored raw
+        LZ4 = 1     // LZ4 block format
+    };
+    
+    static constexpr uint32_t EXTENT_MAGIC = 0x44585443; // "CTXD"
+    
+    // On-disk header of a compressed extent, followed by stored_length payload bytes
+    struct ExtentHeader {
+        uint32_t magic;
+        uint8_t algorithm;
+        uint8_t reserved[3];
+        uint32_t raw_length;
+        uint32_t stored_length;
+        uint32_t checksum;      // CRC32C of the raw data
+    };
+    
+    struct CompressionConfig {
+        Algorithm algorithm;
+        uint32_t group_blocks;    // Blocks compressed together as one extent
+        uint32_t sample_size;     // Bytes compressed to decide whether to bypass
+        double min_savings;       // Fraction that must be saved to keep the compressed form
+        size_t cache_bytes;       // Decoded extent cache capacity
+        
+        CompressionConfig(Algorithm algorithm = Algorithm::LZ4, uint32_t group_blocks = 8,
+                          uint32_t sample_size = 4096, double min_savings = 0.125,
+                          size_t cache_bytes = 32 * 1024 * 1024);
+    };
+    
+    struct CompressionStats {
+        uint64_t extents_compressed;
+        uint64_t extents_stored_raw;
+        uint64_t extents_bypassed;    // Stored raw after sampling only
+        uint64_t raw_bytes;
+        uint64_t stored_bytes;
+        uint64_t cache_hits;
+        uint64_t cache_misses;
+    };
+    
+    // Bytes to store for a group; raw extents are the group data itself
+    struct EncodedExtent {
+        std::vector<uint8_t> bytes;
+        bool raw;                 // Headerless, to be flagged in the extent map
+    };
+    
+    // Reads the stored bytes of the extent starting at a block
+    using ExtentReader = std::function<std::vector<uint8_t>(uint32_t first_block)>;
+    
+    BlockCompressor(uint32_t block_size, const CompressionConfig& config = CompressionConfig());
+    
+    // Encode group data, compressed with a header or raw without one
+    EncodedExtent encode_extent(const uint8_t* data, size_t size);
+    
+    // Decode a stored extent; a compressed one has its header and checksum verified
+    std::vector<uint8_t> decode_extent(const uint8_t* stored, size_t size, bool raw) const;
+    
+    // Decoded contents of an extent, from the cache or read through reader
+    std::shared_ptr<const std::vector<uint8_t>> read_extent(uint32_t first_block, bool raw,
+                                                            const ExtentReader& reader);
+    
+    // Drop a cached extent after it is rewritten or freed
+    void invalidate_extent(uint32_t first_block);
+    
+    // Blocks needed to store an encoded extent
+    uint32_t blocks_for(size_t stored_size) const;
+    
+    // Raw bytes per group
+    size_t get_group_bytes() const;
+    
+    CompressionStats get_stats() const;
+    
+private:
+    uint32_t block_size_;
+    CompressionConfig config_;
+    
+    // LRU of decoded extents keyed by first block, most recent at the front
+    using CacheEntry = std::pair<uint32_t, std::shared_ptr<const std::vector<uint8_t>>>;
+    std::list<CacheEntry> cache_lru_;
+    std::unordered_map<uint32_t, std::list<CacheEntry>::iterator> cache_index_;
+    size_t cached_bytes_;
+    
+    // Extents being read on a cache miss; invalidate_extent() bumps the
+    // generation so a load that started earlier is not cached
+    struct PendingLoad {
+        uint32_t readers;
+        uint64_t generation;
+    };
+    std::unordered_map<uint32_t, PendingLoad> pending_loads_;
+    mutable std::mutex cache_mutex_;
+    
+    CompressionStats stats_;
+    mutable std::mutex stats_mutex_;
+    
+    // Check whether a sample of the data compresses well enough to try
+    bool sample_compresses(const uint8_t* data, size_t size) const;
+    
+    // Stored size a compressed extent must stay within to save a whole block
+    size_t compressed_limit(size_t size) const;
+    
+    // Decode a compressed extent after its header has been read
+    std::vector<uint8_t> decode_compressed(const uint8_t* stored, size_t size) const;
+    
+    // Stop tracking a load and report whether it may be cached (caller holds cache_mutex_)
+    bool finish_load(uint32_t first_block, uint64_t generation);
+    
+    // Evict least recently used extents until within capacity (caller holds cache_mutex_)
+    void evict_extents();
+};
+
+} // namespace core
+} // namespace dfs
@@ -5,40 +5,136 @@
 #include <mutex>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <functional>
 
 namespace dfs {
 namespace core {
 
+class SuperBlockCounters;
+
+/**
+ * BlockTree - A block pointer and the number of indirect levels below it
+ * (0 for a data block, 1 for a single indirect block, and so on)
+ */
+struct BlockTree {
+    uint32_t block_id;
+    uint32_t depth;
+};
+
 /**
  * BlockManager - Manages data block allocation and deallocation
- * Provides thread-safe block management with bitmap tracking
+ * Provides thread-safe block management with bitmap tracking.
+ * A shared indirect block shares its children implicitly: they gain a
+ * reference only when the indirect block is copied by cow_block(), and
+ * lose one when the last reference to it is dropped by deallocate_tree().
  */
 class BlockManager {
+public:
+    // Number of bitmap entries read together from the backing image
+    static constexpr uint32_t BITMAP_PAGE_SIZE = 4096;
+    
+    // Returns the child block pointers stored in an indirect block
+    using IndirectReader = std::function<std::vector<uint32_t>(uint32_t block_id)>;
+    
 private:
-    std::vector<bool> block_bitmap_;
-    std::mutex bitmap_mutex_;
+    mutable std::vector<bool> block_bitmap_;
+    mutable std::mutex bitmap_mutex_;
     uint32_t total_blocks_;
     uint32_t block_size_;
     uint32_t next_free_block_;
     
+    // Lazily attached bitmap pages
+    mutable std::vector<bool> page_loaded_;
+    mutable uint32_t unloaded_pages_;
+    mutable std::ifstream backing_file_;
+    std::streamoff backing_offset_;
+    
+    // Superblock free-count deltas (optional)
+    SuperBlockCounters* counters_;
+    
+    // Extra references to shared blocks (snapshots, clones); a used block
+    // without an entry has exactly one owner
+    std::unordered_map<uint32_t, uint32_t> extra_refs_;
+    
+    // Reads indirect blocks for cow_block() and deallocate_tree()
+    IndirectReader indirect_reader_;
+    
+    // Drop one reference if the block is shared, true if references remain (caller holds bitmap_mutex_)
+    bool drop_shared_ref(uint32_t block_id);
+    
+    // Non-zero children of an indirect block (caller holds bitmap_mutex_)
+    std::vector<uint32_t> read_children(uint32_t block_id) const;
+    
+    // Drop one reference to a block tree in the given bitmap and reference
+    // counts; an indirect block losing its last reference drops one from
+    // each child in turn (caller holds bitmap_mutex_)
+    void release_tree(uint32_t block_id, uint32_t depth, std::vector<bool>& bitmap,
+                      std::unordered_map<uint32_t, uint32_t>& refs, uint32_t& freed) const;
+    
     // Find next free block starting from given index
     uint32_t find_next_free_block(uint32_t start_index = 0) const;
     
+    // Fault in the bitmap page holding a block (caller holds bitmap_mutex_)
+    void ensure_page(uint32_t block_id) const;
+    
+    // Read a bitmap page from the backing image (caller holds bitmap_mutex_)
+    void load_page(uint32_t page_index) const;
+    
+    // Fault in every page that is not yet resident (caller holds bitmap_mutex_)
+    void load_all_pages() const;
+    
+    // Count free blocks in the bitmap (caller holds bitmap_mutex_)
+    uint32_t count_free_blocks() const;
+    
+    // Bitmap and reference counts with one reference per entry of released
+    // dropped, leaving the live state alone (caller holds bitmap_mutex_)
+    void image_without(const std::vector<BlockTree>& released, std::vector<bool>& bitmap,
+                       std::unordered_map<uint32_t, uint32_t>& refs) const;
+                       
 public:
     BlockManager(uint32_t total_blocks, uint32_t block_size);
     
+    // Report allocations to the superblock counters
+    void set_counters(SuperBlockCounters* counters);
+    
+    // Read indirect blocks; needed once files use them. The reader is called
+    // with the bitmap lock held, so it must not call back into this manager
+    void set_indirect_reader(IndirectReader reader);
+    
     // Allocate a single block
     uint32_t allocate_block();
     
     // Allocate multiple contiguous blocks
     std::vector<uint32_t> allocate_blocks(uint32_t count);
     
-    // Deallocate a single block
+    // Deallocate a single block; shared blocks only lose one reference
     void deallocate_block(uint32_t block_id);
     
-    // Deallocate multiple blocks
+    // Deallocate multiple blocks; shared blocks only lose one reference
     void deallocate_blocks(const std::vector<uint32_t>& block_ids);
     
+    // Drop one reference to a block with depth levels of indirect blocks
+    // below it; the last reference to an indirect block releases its children
+    void deallocate_tree(uint32_t block_id, uint32_t depth);
+    
+    // Add a reference to a used block
+    void add_block_ref(uint32_t block_id);
+    
+    // Add a reference to each block; no reference is added unless every block is used
+    void share_blocks(const std::vector<uint32_t>& block_ids);
+    
+    // Get number of owners of a block (0 = free)
+    uint32_t get_block_ref_count(uint32_t block_id) const;
+    
+    // Get a block that is safe to write in place of block_id: the block itself
+    // when it has one owner, otherwise a newly allocated block that takes over
+    // this owner's reference (the caller copies the data). depth is the number
+    // of indirect levels below block_id; copying an indirect block adds a
+    // reference to each of its children, since the copy points at them too
+    uint32_t cow_block(uint32_t block_id, uint32_t depth = 0);
+    
     // Check if block is free
     bool is_block_free(uint32_t block_id) const;
     
@@ -57,6 +153,9 @@ public:
     // Get block size
     uint32_t get_block_size() const;
     
+    // Copy of the free bitmap (true = free), consistent at the time of the call
+    std::vector<bool> copy_bitmap() const;
+    
     // Get block usage statistics
     struct BlockStats {
         uint32_t total_blocks;
@@ -66,12 +165,27 @@ public:
     };
     BlockStats get_block_stats() const;
     
-    // Serialize block bitmap to file
-    void serialize_bitmap(std::ofstream& file) const;
+    // Serialize block bitmap to file. The image is written as if each entry
+    // of released had lost one reference (see InodeTable::snapshot_only_blocks)
+    void serialize_bitmap(std::ofstream& file, const std::vector<BlockTree>& released = {}) const;
     
     // Deserialize block bitmap from file
     void deserialize_bitmap(std::ifstream& file);
     
+    // Serialize shared block reference counts to file, with released dropped
+    // as for serialize_bitmap()
+    void serialize_block_refs(std::ofstream& file, const std::vector<BlockTree>& released = {}) const;
+    
+    // Deserialize shared block reference counts from file
+    void deserialize_block_refs(std::ifstream& file);
+    
+    // Attach to a serialized bitmap at the given offset without reading it;
+    // pages are read from the image on first access
+    void attach_bitmap(const std::string& image_path, std::streamoff offset);
+    
+    // Get number of bitmap pages currently resident in memory
+    uint32_t get_loaded_page_count() const;
+    
     // Defragment blocks (optional optimization)
     void defragment_blocks();
     
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "block_manager.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <string>
+
+namespace dfs {
+namespace core {
+
+/**
+ * DedupEngine - Block-level deduplication through shared block references
+ * Blocks are fingerprinted with XXH3-128 of their contents. A block whose
+ * fingerprint is already indexed is stored as another reference to the
+ * indexed block instead of being written again.
+ *
+ * Writers using the engine must overwrite blocks through prepare_overwrite()
+ * and free them through release_block(), so the index never points at a
+ * block whose content changed or that was freed. A new block from
+ * write_block() is only indexed once commit_block() reports its data written.
+ */
+class DedupEngine {
+public:
+    // When duplicates are found
+    enum class Mode {
+        INLINE = 0,        // On the write path, before the block is written
+        POST_PROCESS = 1   // Later, by scanning recorded writes
+    };
+    
+    // 128-bit content fingerprint
+    struct Fingerprint {
+        uint64_t high;
+        uint64_t low;
+        
+        bool operator==(const Fingerprint& other) const {
+            return high == other.high && low == other.low;
+        }
+    };
+    
+    struct FingerprintHash {
+        size_t operator()(const Fingerprint& fingerprint) const {
+            return static_cast<size_t>(fingerprint.low);
+        }
+    };
+    
+    // Reads the current contents of a block
+    using BlockReader = std::function<std::vector<uint8_t>(uint32_t block_id)>;
+    
+    // Points every reference to from_block at to_block; returns false to keep from_block
+    using RemapCallback = std::function<bool(uint32_t from_block, uint32_t to_block)>;
+    
+    struct DedupConfig {
+        Mode mode;
+        bool verify_matches;         // Compare bytes on a fingerprint match (needs a reader)
+        size_t max_index_entries;    // Blocks beyond this are written but not indexed
+        
+        DedupConfig(Mode mode = Mode::INLINE, bool verify_matches = true,
+                    size_t max_index_entries = 1 << 22);
+    };
+    
+    struct DedupStats {
+        uint64_t blocks_written;
+        uint64_t duplicate_blocks;
+        uint64_t bytes_saved;
+        uint64_t verify_mismatches;
+        size_t index_entries;
+        size_t pending_blocks;
+    };
+    
+    DedupEngine(BlockManager& block_manager, const DedupConfig& config = DedupConfig());
+    
+    // Fingerprint a block's contents
+    static Fingerprint fingerprint(const void* data, size_t size);
+    
+    // Get the block to hold data. In inline mode a duplicate returns the
+    // existing block with a reference added and is_duplicate set; otherwise a
+    // new block is allocated, the caller writes the data to it and then calls
+    // commit_block().
+    uint32_t write_block(const std::vector<uint8_t>& data, bool& is_duplicate,
+                         const BlockReader& reader = nullptr);
+    
+    // Index a new block from write_block() now that its data is on disk
+    void commit_block(uint32_t block_id);
+    
+    // Record a block written outside write_block for post-process scanning
+    void record_written_block(uint32_t block_id);
+    
+    // Fingerprint up to max_blocks recorded blocks and fold duplicates into
+    // the indexed copy through remap; returns the number of blocks freed
+    size_t process_pending(const BlockReader& reader, const RemapCallback& remap,
+                           size_t max_blocks = SIZE_MAX);
+    
+    // Drop the index entry of a block whose contents are about to change
+    void prepare_overwrite(uint32_t block_id);
+    
+    // Drop one reference to a block, unindexing it once it is free
+    void release_block(uint32_t block_id);
+    
+    DedupStats get_stats() const;
+    
+    Mode get_mode() const;
+    
+private:
+    BlockManager& block_manager_;
+    DedupConfig config_;
+    
+    // Fingerprint index and its reverse map, so freed blocks can be unindexed
+    std::unordered_map<Fingerprint, uint32_t, FingerprintHash> index_;
+    std::unordered_map<uint32_t, Fingerprint> block_fingerprints_;
+    
+    // New blocks handed out by write_block() whose data is not written yet
+    std::unordered_map<uint32_t, Fingerprint> uncommitted_blocks_;
+    mutable std::mutex index_mutex_;
+    
+    // Blocks waiting for post-process scanning
+    std::deque<uint32_t> pending_blocks_;
+    mutable std::mutex pending_mutex_;
+    
+    uint64_t blocks_written_;
+    uint64_t duplicate_blocks_;
+    uint64_t bytes_saved_;
+    uint64_t verify_mismatches_;
+    
+    // Add a fingerprint for a block if there is room (caller holds index_mutex_)
+    void index_block(const Fingerprint& fingerprint, uint32_t block_id);
+    
+    // Remove a block's fingerprint (caller holds index_mutex_)
+    void unindex_block(uint32_t block_id);
+    
+    // Check that a pinned block still holds data; reads through the reader,
+    // so the caller must not hold index_mutex_
+    bool matches(uint32_t block_id, const std::vector<uint8_t>& data, const BlockReader& reader);
+    
+    // Whether the index still maps a fingerprint to block_id (caller holds index_mutex_)
+    bool still_indexed(const Fingerprint& fingerprint, uint32_t block_id) const;
+};
+
+} // namespace core
+} // namespace dfs
@@ -4,11 +4,17 @@
 #include "inode.h"
 #include "block_manager.h"
 #include "transaction_manager.h"
+#include "fs_checker.h"
+#include "dedup_engine.h"
+#include "block_compressor.h"
+#include "block_cipher.h"
 #include <string>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
+#include <map>
+#include <vector>
 
 namespace dfs {
 namespace core {
@@ -20,9 +26,14 @@ namespace core {
 class FileSystem {
 private:
     std::unique_ptr<SuperBlock> superblock_;
+    std::unique_ptr<SuperBlockCounters> superblock_counters_;  // Folded at checkpoint/unmount
     std::unique_ptr<InodeTable> inode_table_;
     std::unique_ptr<BlockManager> block_manager_;
     std::unique_ptr<TransactionManager> transaction_manager_;
+    std::unique_ptr<utils::ThreadPool> maintenance_pool_;  // Runs fsck phases
+    std::unique_ptr<DedupEngine> dedup_engine_;            // Null unless filesystem.enable_deduplication
+    std::unique_ptr<BlockCompressor> block_compressor_;    // Null unless filesystem.enable_compression
+    std::unique_ptr<BlockCipher> block_cipher_;            // Null unless filesystem.enable_encryption
     
     // File system state
     std::string mount_point_;
@@ -36,17 +47,44 @@ private:
     // Get or create mutex for specific inode
     std::shared_mutex& get_inode_mutex(uint32_t inode_num) const;
     
-    // Path resolution
+    // Read-only snapshots, keyed by name; memory only (see
+    // InodeTable::snapshot_only_blocks)
+    struct Snapshot {
+        std::string name;
+        uint64_t created_time;
+        std::shared_ptr<InodeTable> inode_table;
+    };
+    std::map<std::string, Snapshot> snapshots_;
+    
+    // Path resolution; symlinks in every component but the last are followed,
+    // at most MAX_SYMLINK_FOLLOW in total
     uint32_t resolve_path(const std::string& path) const;
+    uint32_t resolve_path(const InodeTable& table, const std::string& path) const;
+    
+    // Pick the inode table a path reads from: the snapshot's for paths under
+    // SNAPSHOT_ROOT (relative_path is then the path inside the snapshot)
+    const InodeTable& resolve_table(const std::string& path, std::string& relative_path) const;
     std::string get_parent_directory(const std::string& path) const;
     std::string get_filename(const std::string& path) const;
     
     // Directory operations
     bool add_directory_entry(uint32_t dir_inode, const std::string& name, uint32_t inode_num);
     bool remove_directory_entry(uint32_t dir_inode, const std::string& name);
+    
+    // Point an existing entry at another inode in place; returns the inode it
+    // referred to before
+    uint32_t replace_directory_entry(uint32_t dir_inode, const std::string& name, uint32_t inode_num);
+    
+    // Drop one link to an inode, freeing its blocks and the inode with the last one
+    void release_inode(uint32_t inode_num);
     std::vector<std::string> list_directory(uint32_t dir_inode) const;
     
-    // Block operations
+    // Block operations; writes go through BlockManager::cow_block so blocks
+    // shared with a snapshot are copied first, and through dedup_engine_
+    // when deduplication is enabled. With compression enabled, file data is
+    // written in block_compressor_ groups and read through its extent cache.
+    // With encryption enabled, each stored extent is encrypted in place after
+    // compression, tweaked by its first block, and decrypted in place on read.
     std::vector<uint32_t> get_file_blocks(uint32_t inode_num) const;
     bool write_file_blocks(uint32_t inode_num, const std::vector<uint8_t>& data);
     std::vector<uint8_t> read_file_blocks(uint32_t inode_num) const;
@@ -56,6 +94,11 @@ public:
     ~FileSystem();
     
     // File system lifecycle
+    // Mount selects the newest valid superblock copy, rewrites stale copies,
+    // marks it dirty and opens the WAL before serving. The inode table and
+    // bitmap are attached and faulted in on first access, and the WAL is
+    // replayed only after an unclean unmount (TransactionManager::recover).
+    // Unmount flushes metadata and marks the superblock clean.
     bool format(const std::string& device_path, uint32_t total_blocks, uint32_t block_size = 4096);
     bool mount(const std::string& device_path);
     bool unmount();
@@ -75,16 +118,37 @@ public:
     bool append_file(const std::string& path, const std::vector<uint8_t>& data);
     uint64_t get_file_size(const std::string& path) const;
     
-    // Directory operations
+    // Directory operations; rename and move are meant to rewrite directory
+    // entries only, leaving the inode and its data untouched
     std::vector<std::string> list_directory(const std::string& path) const;
     bool rename(const std::string& old_path, const std::string& new_path);
     bool move(const std::string& old_path, const std::string& new_path);
     
+    // Links; counts go through InodeTable::link_inode/unlink_inode and short
+    // symlink targets are stored inline (Inode::FAST_SYMLINK_MAX)
+    static constexpr int MAX_SYMLINK_FOLLOW = 40;
+    bool link(const std::string& existing_path, const std::string& new_path);
+    bool symlink(const std::string& target, const std::string& link_path);
+    std::string readlink(const std::string& path) const;
+    
+    // Copy a regular file by sharing its blocks (InodeTable::clone_inode)
+    bool clone_file(const std::string& source_path, const std::string& dest_path);
+    
     // Metadata operations
     Inode* get_inode(const std::string& path) const;
     bool set_permissions(const std::string& path, uint16_t permissions);
     bool set_ownership(const std::string& path, uint16_t uid, uint16_t gid);
     
+    // Snapshots of the whole volume, built on InodeTable::snapshot
+    static constexpr const char* SNAPSHOT_ROOT = "/.snapshots";
+    struct SnapshotInfo {
+        std::string name;
+        uint64_t created_time;
+    };
+    bool create_snapshot(const std::string& name);
+    bool delete_snapshot(const std::string& name);
+    std::vector<SnapshotInfo> list_snapshots() const;
+    
     // Transaction operations
     uint64_t begin_transaction();
     bool commit_transaction(uint64_t tx_id);
@@ -104,6 +168,11 @@ public:
     // Maintenance operations
     bool check_filesystem() const;
     bool repair_filesystem();
+    
+    // Parallel check; read-only checks may run while mounted, repair requires
+    // the file system to be unmounted or frozen. Blocks held by snapshots are
+    // counted as in use.
+    FileSystemChecker::CheckReport check_filesystem(const FileSystemChecker::CheckOptions& options) const;
     void defragment();
     
     // Statistics
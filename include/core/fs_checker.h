@@ -0,0 +1,153 @@
+#pragma once
+
+#include "inode.h"
+#include "block_manager.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <memory>
+
+namespace dfs {
+namespace utils {
+class ThreadPool;
+} // namespace utils
+
+namespace core {
+
+/**
+ * FileSystemChecker - Multi-phase consistency checker
+ * Each phase is partitioned by inode or block range across a ThreadPool.
+ * In read-only mode every phase reads one InodeTable view taken at the
+ * start, so it can run against a mounted file system without changing it.
+ * The block bitmap is copied right after the view; blocks allocated but not
+ * yet attached to an inode at that moment are reported as leaked.
+ */
+class FileSystemChecker {
+public:
+    // Checker phases, run in order
+    enum class Phase {
+        INODES = 0,        // Validate allocated inodes, collect block ownership
+        BLOCKS = 1,        // Cross-check block ownership against the bitmap
+        CONNECTIVITY = 2   // Verify every inode is reachable and link counts match
+    };
+    
+    // Progress of the running phase
+    struct CheckProgress {
+        Phase phase;
+        uint64_t completed;
+        uint64_t total;
+    };
+    
+    // Check configuration
+    struct CheckOptions {
+        bool repair;                 // Fix bitmap and pointer errors (offline only)
+        uint32_t partition_size;     // Inodes or blocks per task
+        
+        // Called after each partition; calls are serialized
+        std::function<void(const CheckProgress&)> progress_callback;
+        
+        // Returns child block pointers stored in an indirect block
+        std::function<std::vector<uint32_t>(uint32_t block_id)> indirect_reader;
+        
+        // Returns inode numbers referenced by a directory's entries
+        std::function<std::vector<uint32_t>(uint32_t dir_inode)> directory_reader;
+        
+        CheckOptions(bool repair = false, uint32_t partition_size = 8192);
+    };
+    
+    // Issues found by the checker
+    struct CheckReport {
+        uint32_t inodes_checked;
+        uint32_t blocks_checked;
+        std::vector<uint32_t> invalid_inodes;        // Failed Inode::is_valid()
+        std::vector<uint32_t> out_of_range_pointers; // Inodes pointing past the device
+        std::vector<uint32_t> duplicate_blocks;      // Claimed by more than one inode
+        std::vector<uint32_t> unmarked_blocks;       // Owned but marked free in the bitmap
+        std::vector<uint32_t> leaked_blocks;         // Marked used but owned by nothing
+        std::vector<uint32_t> unreachable_inodes;    // Allocated but not referenced by any directory
+        std::vector<uint32_t> link_count_mismatches; // link_count differs from directory references
+        bool root_valid;
+        bool connectivity_checked;
+        uint32_t repaired;
+        std::chrono::milliseconds duration;
+        
+        CheckReport();
+        
+        // True when no issue was found
+        bool is_clean() const;
+        
+        std::string to_string() const;
+    };
+    
+    FileSystemChecker(InodeTable& inode_table, BlockManager& block_manager,
+                      utils::ThreadPool& thread_pool);
+    
+    // Count blocks owned by a snapshot's inodes as in use
+    void add_snapshot(std::shared_ptr<const InodeTable> snapshot);
+    
+    // Run all phases
+    CheckReport run(const CheckOptions& options = CheckOptions());
+    
+private:
+    InodeTable& inode_table_;
+    BlockManager& block_manager_;
+    
+    // Table the phases read: a view in read-only mode, the live table when repairing
+    const InodeTable* view_;
+    utils::ThreadPool& thread_pool_;
+    std::vector<std::shared_ptr<const InodeTable>> snapshots_;
+    
+    // Owner markers for blocks not owned by a live inode
+    static constexpr uint32_t METADATA_OWNER = UINT32_MAX;
+    static constexpr uint32_t SNAPSHOT_OWNER = UINT32_MAX - 1;
+    
+    // Owner inode per block (0 = unowned)
+    std::vector<std::atomic<uint32_t>> block_owner_;
+    
+    // Directory references per inode, counted during connectivity
+    std::vector<std::atomic<uint32_t>> references_;
+    
+    // Set when indirect pointers exist but cannot be expanded, so leaked
+    // blocks may be indirect children and must not be freed by repair
+    std::atomic<bool> unresolved_indirect_;
+    
+    std::mutex report_mutex_;
+    std::mutex progress_mutex_;
+    
+    enum class ClaimResult {
+        CLAIMED,
+        DUPLICATE,
+        OUT_OF_RANGE
+    };
+    
+    void check_inodes(const CheckOptions& options, CheckReport& report);
+    void claim_snapshot_blocks(const CheckOptions& options);
+    void check_blocks(const CheckOptions& options, const std::vector<bool>& bitmap, CheckReport& report);
+    void check_connectivity(const CheckOptions& options, CheckReport& report);
+    
+    // Call visit on each block an inode points to, descending into indirect
+    // blocks through options.indirect_reader while visit returns true. visit
+    // is told whether the block was reached through a shared indirect block
+    void walk_blocks(const Inode& inode, const CheckOptions& options,
+                     const std::function<bool(uint32_t, bool)>& visit);
+    
+    // Record an inode as the owner of a block. Blocks with several references,
+    // or reached through a shared indirect block, may be claimed more than once
+    ClaimResult claim_block(uint32_t block_id, uint32_t inode_num, bool via_shared);
+    
+    // Run fn(first, count) over [0, total) in partitions on the thread pool,
+    // with the calling thread taking partitions too
+    void run_partitioned(Phase phase, uint64_t total, uint32_t partition_size,
+                         const CheckOptions& options,
+                         const std::function<void(uint64_t, uint64_t)>& fn);
+    
+    void report_progress(const CheckOptions& options, Phase phase,
+                         uint64_t completed, uint64_t total);
+};
+
+} // namespace core
+} // namespace dfs
@@ -4,7 +4,11 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <limits>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <fstream>
 #include <sys/stat.h>
 #include <thread>
 #include <iomanip>
@@ -13,11 +17,22 @@
 namespace dfs {
 namespace core {
 
+class SuperBlockCounters;
+class BlockManager;
+struct BlockTree;
+
 /**
  * Inode - File system metadata for files and directories
  * Contains file information, permissions, and block pointers
  */
 struct Inode {
+    // Longest symlink target stored inline in the block pointer fields
+    static constexpr size_t FAST_SYMLINK_MAX = sizeof(uint32_t) * 15;
+    
+    // Largest link count a non-directory inode may reach; link_inode refuses
+    // to go past it, so the uint32_t count cannot wrap
+    static constexpr uint32_t MAX_LINK_COUNT = std::numeric_limits<uint32_t>::max();
+    
     // File type and permissions
     uint16_t mode;
     
@@ -71,6 +86,20 @@ struct Inode {
     // Check if inode represents a symbolic link
     bool is_symlink() const;
     
+    // Check if inode is a symlink whose target is held in the block pointer
+    // fields instead of a data block
+    bool is_fast_symlink() const;
+    
+    // Store a symlink target inline; returns false if it exceeds FAST_SYMLINK_MAX
+    bool set_fast_symlink_target(const std::string& target);
+    
+    // Get the inline target of a fast symlink
+    std::string get_fast_symlink_target() const;
+    
+    // Get every non-zero block pointer (direct and indirect roots); empty for
+    // fast symlinks
+    std::vector<uint32_t> get_block_pointers() const;
+    
     // Get file permissions as string (e.g., "rw-r--r--")
     std::string get_permissions_string() const;
     
@@ -90,7 +119,7 @@ struct Inode {
     bool is_valid() const;
     
     // Get size of inode structure
-    static constexpr size_t size() { return sizeof(Inode); }
+    static constexpr size_t disk_size() { return sizeof(Inode); }
     
     // Debug and information
     std::string to_string() const;
@@ -102,25 +131,117 @@ private:
 
 /**
  * InodeTable - Manages inode allocation and storage
+ * Inodes are held in fixed-size chunks so that a table attached to an
+ * on-disk image can fault chunks in on first access instead of at mount.
+ * Snapshots share chunks and the first write to a shared chunk copies it;
+ * the copy adds a reference to the root blocks of its inodes, and deeper
+ * blocks are shared through BlockManager::cow_block. Read-only views share
+ * chunks the same way but hold no block references.
  */
 class InodeTable {
+public:
+    // Number of inodes loaded together from the backing image
+    static constexpr uint32_t CHUNK_SIZE = 256;
+    
 private:
-    std::vector<Inode> inodes_;
-    std::vector<bool> free_inodes_;
-    std::mutex table_mutex_;
+    struct InodeChunk {
+        std::vector<Inode> inodes;
+        std::vector<bool> free_inodes;
+        
+        // Cleared until the inodes are read from the backing image
+        std::atomic<bool> loaded{true};
+        
+        // Tables whose block references this chunk holds: the one that made
+        // it and the snapshots sharing it, but not read-only views
+        std::atomic<uint32_t> owners{1};
+    };
+    
+    // Image a lazily attached table reads chunks from, shared with the
+    // snapshots and views taken from it
+    struct BackingImage {
+        std::mutex mutex;
+        std::ifstream file;
+        std::streamoff offset = 0;
+        uint32_t unloaded_chunks = 0;
+    };
+    
+    std::vector<std::shared_ptr<InodeChunk>> chunks_;
+    uint32_t inode_count_;
+    mutable std::mutex table_mutex_;
     uint32_t next_free_inode_;
     
+    // Null unless the table is attached to an image
+    std::shared_ptr<BackingImage> backing_;
+    
+    // Superblock free-count deltas (optional)
+    SuperBlockCounters* counters_;
+    
+    // Block reference counts for chunks shared with snapshots (optional)
+    BlockManager* block_manager_;
+    
+    // Snapshots taken from this table, for snapshot_only_blocks()
+    mutable std::vector<std::weak_ptr<InodeTable>> snapshots_;
+    
+    // Get chunk holding an inode, faulting it in if needed (caller holds table_mutex_)
+    InodeChunk& chunk_for(uint32_t inode_num) const;
+    
+    // Get chunk holding an inode for modification, copying it first if it is
+    // shared with a snapshot or view (caller holds table_mutex_)
+    InodeChunk& writable_chunk(uint32_t inode_num);
+    
+    // Add a reference to the root blocks of a chunk's inodes, or drop one
+    // from each of their block trees
+    void add_chunk_block_refs(const InodeChunk& chunk);
+    void release_chunk_blocks(const InodeChunk& chunk);
+    
+    // Read a chunk from the backing image unless a table sharing it already did
+    void load_chunk(InodeChunk& chunk, uint32_t chunk_index) const;
+    
+    // Fault in every chunk that is not yet resident (caller holds table_mutex_)
+    void load_all_chunks() const;
+    
+    // Allocate a free inode (caller holds table_mutex_)
+    uint32_t allocate_inode_locked();
+    
+    // Build resident chunks for the given number of inodes
+    void reset_chunks(uint32_t inode_count);
+    
+    // Table sharing every chunk and the backing image (caller holds table_mutex_)
+    std::shared_ptr<InodeTable> share_chunks() const;
+    
 public:
     InodeTable(uint32_t max_inodes);
     
+    // Report allocations to the superblock counters
+    void set_counters(SuperBlockCounters* counters);
+    
+    // Track block references for snapshots; required before snapshot()
+    void set_block_manager(BlockManager* block_manager);
+    
     // Allocate a new inode
     uint32_t allocate_inode();
     
+    // Allocate a copy of a file inode that shares all of its blocks. Only
+    // the root blocks gain a reference; the copies diverge on write through
+    // BlockManager::cow_block, which shares an indirect block's children as
+    // it copies the block
+    uint32_t clone_inode(uint32_t source_inode);
+    
     // Deallocate an inode
     void deallocate_inode(uint32_t inode_num);
     
-    // Get inode by number
+    // Add a hard link to a non-directory inode; returns the new link count
+    uint32_t link_inode(uint32_t inode_num);
+    
+    // Drop a link and return the remaining count. At zero the caller frees
+    // the inode's blocks and deallocates it.
+    uint32_t unlink_inode(uint32_t inode_num);
+    
+    // Get inode by number for modification. Do not keep the pointer across
+    // snapshot() or view(): its chunk is shared from then on, so writes
+    // through it would show in the snapshot. Fetch the inode again instead.
     Inode* get_inode(uint32_t inode_num);
+    const Inode* get_inode(uint32_t inode_num) const;
     
     // Check if inode is free
     bool is_inode_free(uint32_t inode_num) const;
@@ -131,11 +252,42 @@ public:
     // Get total number of inodes
     uint32_t get_total_inode_count() const;
     
+    // Get number of chunks currently resident in memory
+    uint32_t get_loaded_chunk_count() const;
+    
+    // Copy a range of inodes and their free flags, taking the table lock only for the copy
+    void copy_range(uint32_t first_inode, uint32_t count, std::vector<Inode>& inodes,
+                    std::vector<bool>& free_flags) const;
+    
     // Serialize inode table to file
     void serialize(std::ofstream& file) const;
     
     // Deserialize inode table from file
     void deserialize(std::ifstream& file);
+    
+    // Attach to a serialized table at the given offset without reading it;
+    // chunks are read from the image on first access
+    void attach(const std::string& image_path, std::streamoff offset);
+    
+    // Create a point-in-time table sharing every chunk with this one,
+    // including chunks not yet read from the backing image. Snapshots live
+    // in memory only: each must be dropped with release_snapshot(), and none
+    // survives a remount (see snapshot_only_blocks).
+    std::shared_ptr<InodeTable> snapshot() const;
+    
+    // Create a point-in-time table for reading only. It shares chunks like a
+    // snapshot but holds no block references and needs no block manager;
+    // writes to this table copy the chunks it shares.
+    std::shared_ptr<const InodeTable> view() const;
+    
+    // Drop a snapshot taken from this table, releasing the blocks referenced
+    // only by chunks the snapshot no longer shares; the snapshot is left empty
+    void release_snapshot(InodeTable& snapshot);
+    
+    // Block trees referenced only by chunks of snapshots taken from this
+    // table, one entry per reference. Snapshots are not persisted, so the
+    // block bitmap and reference counts are written with these released
+    std::vector<BlockTree> snapshot_only_blocks() const;
 };
 
 } // namespace core
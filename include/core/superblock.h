@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <fstream>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <atomic>
+#include <array>
+#include <vector>
 
 namespace dfs {
 namespace core {
@@ -18,6 +22,14 @@ struct SuperBlock {
     // Magic number to identify the file system
     static constexpr uint32_t MAGIC_NUMBER = 0xDF5F0001;
     
+    // Mount state values
+    static constexpr uint32_t STATE_CLEAN = 0x1;  // Unmounted cleanly, WAL fully applied
+    static constexpr uint32_t STATE_DIRTY = 0x2;  // Mounted, or crashed while mounted
+    
+    // Byte offsets of the primary copy and the backup copies on the device
+    static constexpr uint64_t COPY_OFFSETS[] = {0, 1ULL << 20, 1ULL << 24, 1ULL << 28};
+    static constexpr uint32_t COPY_COUNT = sizeof(COPY_OFFSETS) / sizeof(COPY_OFFSETS[0]);
+    
     // File system signature
     uint32_t magic_number;
     
@@ -39,6 +51,9 @@ struct SuperBlock {
     // Root directory inode number
     uint32_t root_inode;
     
+    // Alignment hole before the 64-bit timestamps; always zero
+    uint32_t reserved1;
+    
     // Timestamp of last mount
     uint64_t last_mount_time;
     
@@ -48,18 +63,30 @@ struct SuperBlock {
     // File system version
     uint32_t version;
     
-    // Checksum for integrity verification
+    // Checksum for integrity verification (CRC32C)
     uint32_t checksum;
     
+    // Mount state (STATE_CLEAN or STATE_DIRTY)
+    uint32_t state;
+    
+    // Alignment hole before generation; always zero
+    uint32_t reserved2;
+    
+    // Incremented on every write of the copies; the newest valid copy wins at mount.
+    // Images written before it existed have zero padding here, so read as generation 0
+    uint64_t generation;
+    
     // Padding to align to block boundary
-    uint8_t padding[64];
+    uint8_t padding[48];
     
     SuperBlock();
     
     // Initialize superblock with default values
     void initialize(uint32_t total_blocks, uint32_t block_size = 4096);
     
-    // Validate superblock integrity
+    // Validate superblock integrity. The checksum is computed only on the
+    // image written by serialize() and write_copies(), so this applies to
+    // superblocks read from disk, not to one modified in memory since.
     bool is_valid() const;
     
     // Calculate and update checksum
@@ -71,15 +98,35 @@ struct SuperBlock {
     // Deserialize from binary format
     void deserialize(std::ifstream& file);
     
+    // Bump the generation and write every copy that fits on the device;
+    // backups are written before the primary
+    void write_copies(const std::string& device_path);
+    
+    // Read all copies in parallel and return the newest valid one. Indices of
+    // copies that are invalid or older are reported so they can be rewritten.
+    static SuperBlock read_newest_copy(const std::string& device_path,
+                                       std::vector<uint32_t>* stale_copies = nullptr);
+    
+    // Block numbers occupied by superblock copies on a device of this geometry
+    static std::vector<uint32_t> copy_block_numbers(uint32_t total_blocks, uint32_t block_size);
+    
     // Get size of superblock structure
     static constexpr size_t size() { return sizeof(SuperBlock); }
     
     // Block and inode management
+    // These adjust the free counts only. Hot allocation paths should record
+    // through SuperBlockCounters instead.
     bool allocate_block();
     bool deallocate_block();
     bool allocate_inode();
     bool deallocate_inode();
     
+    // Mount state management; like the allocators, these take effect on disk
+    // at the next write of the copies
+    void mark_dirty();
+    void mark_clean();
+    bool was_cleanly_unmounted() const;
+    
     // Utility methods
     void update_mount_time();
     bool is_space_available(uint32_t blocks_needed) const;
@@ -93,6 +140,57 @@ struct SuperBlock {
 private:
     // Calculate checksum for integrity verification
     static uint32_t calculate_checksum(const void* data, size_t size);
+    
+    // Checksum of this superblock's bytes with the checksum field zeroed
+    uint32_t compute_checksum() const;
+    
+    // Copy stamped with the write time and checksum, as written to disk
+    SuperBlock make_image() const;
+};
+
+// The struct is written to disk byte for byte; every byte is a named field
+static_assert(sizeof(SuperBlock) == 120, "SuperBlock on-disk size changed");
+static_assert(offsetof(SuperBlock, generation) == 64, "SuperBlock on-disk layout changed");
+
+/**
+ * SuperBlockCounters - Per-CPU free-count deltas for a SuperBlock
+ * Allocators record deltas into a CPU-local slot without touching the
+ * superblock; the deltas are folded into it at checkpoint or unmount.
+ */
+class SuperBlockCounters {
+public:
+    // Number of delta slots (allocations on more CPUs share slots)
+    static constexpr size_t SLOT_COUNT = 64;
+    
+    explicit SuperBlockCounters(SuperBlock& superblock);
+    
+    // Record allocation events
+    void block_allocated(uint32_t count = 1);
+    void block_freed(uint32_t count = 1);
+    void inode_allocated(uint32_t count = 1);
+    void inode_freed(uint32_t count = 1);
+    
+    // Free counts including deltas not yet folded into the superblock
+    uint32_t get_free_blocks() const;
+    uint32_t get_free_inodes() const;
+    
+    // Fold pending deltas into the superblock; call at checkpoint or unmount
+    void fold();
+    
+private:
+    struct alignas(64) Slot {
+        std::atomic<int64_t> block_delta{0};
+        std::atomic<int64_t> inode_delta{0};
+    };
+    
+    SuperBlock& superblock_;
+    std::array<Slot, SLOT_COUNT> slots_;
+    
+    // Slot for the calling thread's current CPU
+    static size_t current_slot();
+    
+    int64_t pending_block_delta() const;
+    int64_t pending_inode_delta() const;
 };
 
 } // namespace core
@@ -7,10 +7,14 @@
 #include <memory>
 #include <chrono>
 #include <atomic>
+#include <fstream>
+#include <string>
 
 namespace dfs {
 namespace core {
 
+class SuperBlock;
+
 /**
  * LogEntry - Represents a single operation in the transaction log
  */
@@ -69,7 +73,7 @@ struct Transaction {
 class TransactionManager {
 private:
     std::unordered_map<uint64_t, std::unique_ptr<Transaction>> active_transactions_;
-    std::mutex transaction_mutex_;
+    mutable std::mutex transaction_mutex_;
     std::atomic<uint64_t> next_transaction_id_;
     std::string log_file_path_;
     std::ofstream log_file_;
@@ -84,8 +88,8 @@ private:
     // Write log entry to disk
     void write_log_entry(const LogEntry& entry);
     
-    // Replay log entries for recovery
-    void replay_log_entries();
+    // Replay log entries for recovery; returns the number replayed
+    uint32_t replay_log_entries();
     
 public:
     TransactionManager(const std::string& log_file_path);
@@ -127,6 +131,11 @@ public:
     // Recover from log file
     void recover();
     
+    // Recover at mount: replay the log unless the superblock records a clean
+    // unmount, in which case every entry was already applied. Returns the
+    // number of entries replayed.
+    uint32_t recover(const SuperBlock& superblock);
+    
     // Get transaction statistics
     struct TransactionStats {
         uint32_t active_transactions;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * BlockPool - Size-class allocator for small, short-lived objects
+ * Blocks of up to MAX_BLOCK_SIZE bytes are recycled through per-thread
+ * free lists; a thread that frees more than it allocates hands whole
+ * batches to its NUMA node's shared list, where a thread that allocates
+ * more picks them up, preferring its own node's list. Suits objects
+ * created on one thread and freed on another, such as thread pool tasks
+ * and their future state. Larger requests go straight to operator new.
+ */
+class BlockPool {
+public:
+    static constexpr size_t MAX_BLOCK_SIZE = 256;
+    
+    static void* allocate(size_t size);
+    static void deallocate(void* block, size_t size) noexcept;
+};
+
+/**
+ * PoolAllocator - Standard allocator over BlockPool
+ * For allocator-aware types such as std::promise, whose shared state is
+ * then recycled instead of going through the general-purpose heap.
+ */
+template<typename T>
+struct PoolAllocator {
+    using value_type = T;
+    
+    PoolAllocator() noexcept = default;
+    
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+    
+    T* allocate(size_t count) {
+        if (alignof(T) > alignof(std::max_align_t)) {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T*>(BlockPool::allocate(count * sizeof(T)));
+    }
+    
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (alignof(T) > alignof(std::max_align_t)) {
+            ::operator delete(pointer);
+            return;
+        }
+        BlockPool::deallocate(pointer, count * sizeof(T));
+    }
+    
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+    
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+} // namespace utils
+} // namespace dfs
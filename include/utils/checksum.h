@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * Checksum - Integrity checksums and content hashes
+ * CRC32C uses the SSE4.2 crc32 instruction when the CPU supports it;
+ * XXH64 and XXH3-128 are fast non-cryptographic hashes for content
+ * fingerprints, and XXH32 is the checksum used by the LZ4 frame format
+ */
+class Checksum {
+public:
+    // 128-bit hash value
+    struct Hash128 {
+        uint64_t low;
+        uint64_t high;
+    };
+    
+    // CRC32C (Castagnoli) of a buffer, continuing from a previous value
+    static uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+    
+    // Check whether the hardware CRC32C path is in use
+    static bool has_hardware_crc32c();
+    
+    // XXH64 of a buffer (compatible with the reference xxHash implementation)
+    static uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0);
+    
+    // XXH32 of a buffer (compatible with the reference xxHash implementation)
+    static uint32_t xxh32(const void* data, size_t size, uint32_t seed = 0);
+    
+    // XXH3-128 of a buffer with the default secret (compatible with the
+    // reference xxHash implementation)
+    static Hash128 xxh3_128(const void* data, size_t size);
+    
+private:
+    static uint32_t crc32c_software(const uint8_t* data, size_t size, uint32_t crc);
+    static uint32_t crc32c_hardware(const uint8_t* data, size_t size, uint32_t crc);
+};
+
+} // namespace utils
+} // namespace dfs
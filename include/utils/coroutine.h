@@ -0,0 +1,242 @@
+#pragma once
+
+// Coroutine support needs a C++20 compiler; configure with
+// -DDFS_ENABLE_COROUTINES=ON. Without it this header declares nothing.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "thread_pool.h"
+#include "logger.h"
+#include <coroutine>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#define DFS_HAVE_COROUTINES 1
+
+namespace dfs {
+namespace utils {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+// Resume whoever awaited the finished coroutine, by symmetric transfer so
+// long chains of awaits do not grow the stack
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+    
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+    
+    void rethrow_if_failed() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+    
+    template<typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+    
+    T result() {
+        rethrow_if_failed();
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    void return_void() noexcept {}
+    
+    void result() {
+        rethrow_if_failed();
+    }
+};
+
+// Coroutine that starts at once and frees itself when it finishes
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+/**
+ * Task - Lazily started coroutine producing a T
+ * The body runs when the task is awaited, on the awaiting thread, and the
+ * awaiter resumes wherever the body finishes. Move-only; destroying an
+ * unawaited task destroys its frame without running it.
+ */
+template<typename T>
+class Task {
+public:
+    struct promise_type : detail::Promise<T> {
+        Task get_return_object() noexcept {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+    
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+    
+    // Awaiting starts the body and suspends the caller until it finishes
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+        
+        bool await_ready() const noexcept {
+            return !handle || handle.done();
+        }
+        
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+        
+        T await_resume() {
+            return handle.promise().result();
+        }
+    };
+    
+    Awaiter operator co_await() const noexcept {
+        return Awaiter{handle_};
+    }
+    
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Awaitable that moves the awaiting coroutine onto one of a pool's workers
+class ScheduleAwaiter {
+public:
+    ScheduleAwaiter(ThreadPool& pool, ThreadPool::Priority priority) : pool_(pool), priority_(priority) {}
+    
+    bool await_ready() const noexcept { return false; }
+    
+    // Throws, resuming the coroutine with the exception, if the pool is stopped
+    void await_suspend(std::coroutine_handle<> handle) {
+        pool_.post([handle]() { handle.resume(); }, priority_);
+    }
+    
+    void await_resume() const noexcept {}
+    
+private:
+    ThreadPool& pool_;
+    ThreadPool::Priority priority_;
+};
+
+inline ScheduleAwaiter schedule_on(ThreadPool& pool, ThreadPool::Priority priority = ThreadPool::Priority::NORMAL) {
+    return ScheduleAwaiter(pool, priority);
+}
+
+// Run a blocking call on the pool; the awaiting coroutine resumes on that worker
+template<typename F>
+Task<std::invoke_result_t<F>> run_on(ThreadPool& pool, F function,
+                                     ThreadPool::Priority priority = ThreadPool::Priority::NORMAL) {
+    co_await schedule_on(pool, priority);
+    co_return function();
+}
+
+// Start a task on the pool without waiting for it; exceptions are logged
+inline void spawn(ThreadPool& pool, Task<void> task, ThreadPool::Priority priority = ThreadPool::Priority::NORMAL) {
+    [](ThreadPool& target, Task<void> body, ThreadPool::Priority level) -> detail::DetachedTask {
+        try {
+            co_await schedule_on(target, level);
+            co_await body;
+        } catch (const std::exception& e) {
+            LOG_ERROR("Spawned task failed: " + std::string(e.what()));
+        } catch (...) {
+            LOG_ERROR("Spawned task failed with unknown exception");
+        }
+    }(pool, std::move(task), priority);
+}
+
+// Block the calling thread until a task finishes; for callers outside any coroutine
+template<typename T>
+T sync_wait(Task<T> task) {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::exception_ptr error;
+    std::optional<std::conditional_t<std::is_void<T>::value, bool, T>> result;
+    
+    // Named so the captures outlive the coroutine, which may finish on another thread
+    auto waiter = [&]() -> detail::DetachedTask {
+        try {
+            if constexpr (std::is_void<T>::value) {
+                co_await task;
+            } else {
+                result.emplace(co_await task);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        finished.notify_one();
+    };
+    waiter();
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&done] { return done; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void<T>::value) {
+        return std::move(*result);
+    }
+}
+
+} // namespace utils
+} // namespace dfs
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * CpuTopology - NUMA nodes and the CPUs this process may run on
+ * Read once from /sys/devices/system/node and the process's affinity
+ * mask. On systems without NUMA information every allowed CPU is placed
+ * in a single node 0, so callers need no special case.
+ */
+class CpuTopology {
+public:
+    struct Node {
+        int id;
+        std::vector<int> cpus;        // Allowed CPUs on this node, ascending
+    };
+    
+    static const CpuTopology& get_instance();
+    
+    const std::vector<Node>& get_nodes() const { return nodes_; }
+    size_t get_node_count() const { return nodes_.size(); }
+    
+    // Index into get_nodes() of the node holding a CPU, 0 if unknown
+    size_t node_of_cpu(int cpu) const;
+    
+    // Index of the node the calling thread is running on
+    size_t current_node() const;
+    
+    // Index of the node whose memory backs an address, or -1 if the kernel
+    // cannot tell (page not yet touched, or no NUMA support)
+    int node_of_address(const void* address) const;
+    
+    // Restrict the calling thread to the given CPUs; false if the kernel refused
+    static bool pin_current_thread(const std::vector<int>& cpus);
+    
+    // Parse a kernel CPU list such as "0-3,8,10-11"
+    static std::vector<int> parse_cpu_list(const std::string& list);
+    
+private:
+    CpuTopology();
+    
+    std::vector<Node> nodes_;
+    std::vector<size_t> cpu_to_node_;    // Indexed by CPU number
+    std::vector<size_t> id_to_node_;     // Indexed by kernel node id
+};
+
+} // namespace utils
+} // namespace dfs
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * InlineTask - Move-only void() callable with inline storage
+ * Callables up to INLINE_SIZE bytes that can be moved without throwing are
+ * stored in the object itself, so wrapping a small lambda allocates
+ * nothing; larger ones are moved to the heap. Unlike std::function it
+ * accepts move-only callables such as lambdas holding a std::promise.
+ */
+class InlineTask {
+public:
+    static constexpr size_t INLINE_SIZE = 64;
+    
+    InlineTask() noexcept : ops_(nullptr) {}
+    
+    template<typename F,
+             typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InlineTask>::value>::type>
+    InlineTask(F&& function) : ops_(nullptr) {
+        using Callable = typename std::decay<F>::type;
+        if constexpr (fits_inline<Callable>()) {
+            new (storage_) Callable(std::forward<F>(function));
+            ops_ = &inline_ops<Callable>;
+        } else {
+            *reinterpret_cast<Callable**>(storage_) = new Callable(std::forward<F>(function));
+            ops_ = &heap_ops<Callable>;
+        }
+    }
+    
+    InlineTask(InlineTask&& other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+    
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_) {
+                other.ops_->move(storage_, other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+    
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+    
+    ~InlineTask() {
+        reset();
+    }
+    
+    void operator()() {
+        ops_->invoke(storage_);
+    }
+    
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+    
+    // Check whether a callable type is stored without allocating
+    template<typename Callable>
+    static constexpr bool fits_inline() {
+        return sizeof(Callable) <= INLINE_SIZE && alignof(Callable) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Callable>::value;
+    }
+    
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* destination, void* source) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+    
+    template<typename Callable>
+    static void invoke_inline(void* storage) {
+        (*static_cast<Callable*>(storage))();
+    }
+    
+    template<typename Callable>
+    static void move_inline(void* destination, void* source) noexcept {
+        Callable* callable = static_cast<Callable*>(source);
+        new (destination) Callable(std::move(*callable));
+        callable->~Callable();
+    }
+    
+    template<typename Callable>
+    static void destroy_inline(void* storage) noexcept {
+        static_cast<Callable*>(storage)->~Callable();
+    }
+    
+    template<typename Callable>
+    static void invoke_heap(void* storage) {
+        (**static_cast<Callable**>(storage))();
+    }
+    
+    template<typename Callable>
+    static void move_heap(void* destination, void* source) noexcept {
+        *static_cast<Callable**>(destination) = *static_cast<Callable**>(source);
+    }
+    
+    template<typename Callable>
+    static void destroy_heap(void* storage) noexcept {
+        delete *static_cast<Callable**>(storage);
+    }
+    
+    template<typename Callable>
+    static constexpr Ops inline_ops = {&invoke_inline<Callable>, &move_inline<Callable>, &destroy_inline<Callable>};
+    
+    template<typename Callable>
+    static constexpr Ops heap_ops = {&invoke_heap<Callable>, &move_heap<Callable>, &destroy_heap<Callable>};
+    
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+    
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops* ops_;
+};
+
+} // namespace utils
+} // namespace dfs
@@ -1,23 +1,153 @@
 #pragma once
 
+#include "mpsc_ring.h"
 #include <string>
 #include <fstream>
 #include <mutex>
 #include <memory>
 #include <chrono>
 #include <atomic>
-#include <queue>
 #include <thread>
 #include <condition_variable>
+#include <deque>
+#include <vector>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// Lowest level the LOG_* macros compile in (0 = DEBUG .. 4 = CRITICAL).
+// Calls below it expand to dead code and never evaluate their arguments
+#ifndef DFS_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define DFS_LOG_MIN_LEVEL 1
+#else
+#define DFS_LOG_MIN_LEVEL 0
+#endif
+#endif
 
 namespace dfs {
 namespace utils {
 
+namespace detail {
+
+// Type tags for arguments captured by LOG_*F, decoded on the logger thread
+enum class LogArgType : uint8_t {
+    INT = 0,
+    UINT = 1,
+    DOUBLE = 2,
+    BOOL = 3,
+    CHAR = 4,
+    STRING = 5,
+    POINTER = 6
+};
+
+template<typename T>
+struct UnsupportedLogArg : std::false_type {};
+
+// Encodes arguments as tag + payload into a record's message buffer.
+// Strings are copied, since the caller's storage is gone by the time the
+// record is formatted; an argument that does not fit ends the encoding
+class LogArgWriter {
+public:
+    LogArgWriter(char* buffer, size_t capacity)
+        : buffer_(buffer), capacity_(capacity), length_(0), truncated_(false) {}
+    
+    size_t length() const { return length_; }
+    bool truncated() const { return truncated_; }
+    
+    template<typename T>
+    void write(const T& value) {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same<U, bool>::value) {
+            put(LogArgType::BOOL, &value, sizeof(bool));
+        } else if constexpr (std::is_same<U, char>::value) {
+            put(LogArgType::CHAR, &value, sizeof(char));
+        } else if constexpr (std::is_enum<U>::value) {
+            write(static_cast<std::underlying_type_t<U>>(value));
+        } else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value) {
+            int64_t encoded = value;
+            put(LogArgType::INT, &encoded, sizeof(encoded));
+        } else if constexpr (std::is_integral<U>::value) {
+            uint64_t encoded = value;
+            put(LogArgType::UINT, &encoded, sizeof(encoded));
+        } else if constexpr (std::is_floating_point<U>::value) {
+            double encoded = static_cast<double>(value);
+            put(LogArgType::DOUBLE, &encoded, sizeof(encoded));
+        } else if constexpr (!std::is_array<T>::value &&
+                             (std::is_same<U, const char*>::value || std::is_same<U, char*>::value)) {
+            put_string(value ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+            put_string(std::string_view(value));
+        } else if constexpr (std::is_pointer<U>::value) {
+            uint64_t encoded = reinterpret_cast<uintptr_t>(value);
+            put(LogArgType::POINTER, &encoded, sizeof(encoded));
+        } else {
+            static_assert(UnsupportedLogArg<T>::value, "LOG_*F arguments must be numbers, strings or pointers");
+        }
+    }
+    
+private:
+    char* buffer_;
+    size_t capacity_;
+    size_t length_;
+    bool truncated_;
+    
+    void put(LogArgType type, const void* data, size_t size) {
+        if (truncated_ || capacity_ - length_ < 1 + size) {
+            truncated_ = true;
+            return;
+        }
+        buffer_[length_++] = static_cast<char>(type);
+        std::memcpy(buffer_ + length_, data, size);
+        length_ += size;
+    }
+    
+    void put_string(std::string_view text) {
+        if (truncated_ || capacity_ - length_ < 1 + sizeof(uint16_t)) {
+            truncated_ = true;
+            return;
+        }
+        size_t room = capacity_ - length_ - 1 - sizeof(uint16_t);
+        uint16_t size = static_cast<uint16_t>(text.size() < room ? text.size() : room);
+        truncated_ = size < text.size();
+        
+        buffer_[length_++] = static_cast<char>(LogArgType::STRING);
+        std::memcpy(buffer_ + length_, &size, sizeof(size));
+        length_ += sizeof(size);
+        std::memcpy(buffer_ + length_, text.data(), size);
+        length_ += size;
+    }
+};
+
+// Swallows the arguments of a compiled-out LOG_*F call so they still type-check
+template<typename... Args>
+inline void discard_log_args(const Args&...) {}
+
+// Entry point of the LOG_*F macros into Logger::logf
+struct FormatLogCall;
+
+} // namespace detail
+
 /**
  * Logger - Thread-safe logging system with multiple output destinations
- * Supports different log levels, file rotation, and async logging
+ * Supports different log levels, file rotation, and async logging.
+ * In async mode producers copy each message into a fixed-size record in a
+ * bounded lock-free ring, so logging never allocates; a single consumer
+ * thread drains the ring in batches and writes each batch with one call
+ * per output. Each thread stages records in its own buffer first and
+ * hands them to the ring in one batch when the buffer fills, on WARN and
+ * above, at thread exit, or when the consumer sweeps it. When the ring is
+ * full, records are dropped and counted, or the producer waits for space,
+ * per overflow_policy.
+ * The LOG_* macros check the level first, so a disabled level costs one
+ * load and never builds its message; levels below DFS_LOG_MIN_LEVEL are
+ * compiled out. LOG_*F("... {} ...", args) captures its arguments into
+ * the record instead, and the consumer thread does the formatting.
+ * The file sink writes text, JSON lines or a compact binary format in
+ * large batches. Rotation only renames the file on the logging path; a
+ * background thread shifts old files and compresses them to .lz4.
  */
 class Logger {
 public:
@@ -30,18 +160,44 @@ public:
         LOG_CRITICAL = 4
     };
     
-    // Log entry structure
+    // What a producer does when the async ring is full
+    enum class OverflowPolicy {
+        DROP = 0,     // Discard the record and count it in dropped_logs
+        BLOCK = 1     // Wait for the consumer to free a slot
+    };
+    
+    // Encoding of the log file; the console always gets text
+    enum class FileFormat {
+        TEXT = 0,     // Human-readable lines
+        JSON = 1,     // One JSON object per line, for Loki/promtail ingestion
+        BINARY = 2    // Length-prefixed records; see format_binary_entry
+    };
+    
+    // Message bytes stored per record; longer messages are truncated
+    static constexpr size_t MESSAGE_CAPACITY = 440;
+    
+    // Log entry structure; fixed size so it can live in a ring slot.
+    // source_file, function_name and format must be string literals
+    // (__FILE__, __FUNCTION__), since async records outlive the call.
+    // With a format, message holds the encoded arguments instead of text
     struct LogEntry {
         Level level;
-        std::string message;
-        std::string source_file;
         uint32_t line_number;
-        std::string function_name;
+        const char* source_file;
+        const char* function_name;
+        const char* format;
         std::chrono::system_clock::time_point timestamp;
-        std::thread::id thread_id;
+        uint64_t thread_id;
+        uint32_t length;
+        bool truncated;
+        char message[MESSAGE_CAPACITY];
         
-        LogEntry(Level lvl, const std::string& msg, const std::string& file = "",
-                uint32_t line = 0, const std::string& func = "");
+        LogEntry();
+        
+        void assign(Level lvl, const std::string& msg, const char* file, uint32_t line, const char* func);
+        
+        // Fill the metadata for a formatted record; the caller encodes the arguments
+        void assign_format(Level lvl, const char* fmt, const char* file, uint32_t line, const char* func);
     };
     
     // Logger configuration
@@ -54,6 +210,12 @@ public:
         size_t max_log_file_size;
         uint32_t max_log_files;
         std::chrono::seconds log_rotation_interval;
+        size_t queue_capacity;            // Records in the async ring, rounded up to a power of two
+        OverflowPolicy overflow_policy;
+        FileFormat file_format;
+        size_t write_buffer_size;         // Bytes the async worker gathers before writing
+        bool compress_rotated;            // LZ4-compress rotated files in the background
+        size_t staging_records;           // Records a thread buffers before handing them over; 0 disables
         
         LoggerConfig(Level min_lvl = Level::LOG_INFO,
                     const std::string& file_path = "dfs.log",
@@ -62,54 +224,144 @@ public:
                     bool async = true,
                     size_t max_size = 10 * 1024 * 1024, // 10MB
                     uint32_t max_files = 5,
-                    std::chrono::seconds rotation = std::chrono::hours(24));
+                    std::chrono::seconds rotation = std::chrono::hours(24),
+                    size_t capacity = 8192,
+                    OverflowPolicy overflow = OverflowPolicy::DROP,
+                    FileFormat format = FileFormat::TEXT,
+                    size_t buffer_size = 256 * 1024,
+                    bool compress = true,
+                    size_t staging = 32);
     };
-
+    
 private:
     LoggerConfig config_;
     std::atomic<Level> current_level_;
     std::ofstream log_file_;
     std::mutex file_mutex_;
+    uint64_t file_size_;
+    std::chrono::steady_clock::time_point file_opened_at_;
     
-    // Async logging
-    std::queue<LogEntry> log_queue_;
+    // Background rotation: the logging path renames the full file to a
+    // .pending name and queues it; this thread shifts and compresses it
+    std::thread rotation_thread_;
+    std::mutex rotation_mutex_;
+    std::condition_variable rotation_condition_;
+    std::deque<std::string> pending_rotations_;
+    bool stop_rotation_;
+    
+    // Async logging: producers fill ring slots; the worker drains them.
+    // The worker sleeps on queue_condition_ only after setting
+    // worker_sleeping_, and producers notify only when they see it set
+    std::unique_ptr<MpscRing<LogEntry>> ring_;
     std::mutex queue_mutex_;
     std::condition_variable queue_condition_;
+    std::condition_variable space_condition_;
+    std::atomic<bool> worker_sleeping_;
+    std::atomic<size_t> waiters_;         // Producers blocked on a full ring, and flush() callers
+    std::atomic<uint64_t> enqueued_logs_;
+    std::atomic<uint64_t> written_logs_;
     std::thread worker_thread_;
     std::atomic<bool> stop_worker_;
     
+    // Per-thread staging. A buffer's lock is only contended by consumer
+    // sweeps, which use try_lock so they never wait on a producer
+    struct StagingBuffer {
+        std::mutex mutex;
+        std::vector<LogEntry> entries;
+        size_t count = 0;
+        Logger* owner = nullptr;          // Cleared when the logger is destroyed
+        bool retired = false;             // The owning thread has exited
+    };
+    
+    // Thread-local link to the calling thread's buffer for one logger
+    // instance; hands it over at thread exit
+    struct StagingHandle {
+        uint64_t logger_id = 0;
+        std::shared_ptr<StagingBuffer> buffer;
+        
+        StagingHandle() = default;
+        StagingHandle(StagingHandle&& other) noexcept;
+        StagingHandle& operator=(StagingHandle&& other) noexcept;
+        
+        void release();
+        ~StagingHandle();
+    };
+    
+    std::mutex staging_mutex_;
+    std::vector<std::shared_ptr<StagingBuffer>> staging_buffers_;
+    size_t staging_capacity_;
+    uint64_t instance_id_;
+    
     // Statistics
     std::atomic<uint64_t> total_logs_;
     std::atomic<uint64_t> logs_by_level_[5];
+    std::atomic<uint64_t> dropped_logs_;
     std::chrono::steady_clock::time_point start_time_;
     
+    // Formatted output of one batch of records, written with one call per output
+    struct OutputBatch {
+        std::string file_text;
+        std::string stdout_text;
+        std::string stderr_text;
+        std::string scratch;              // Message text for JSON and binary records
+        size_t count = 0;
+        
+        size_t bytes() const {
+            return file_text.size() + stdout_text.size() + stderr_text.size();
+        }
+    };
+    
     // Helper methods
-    std::string level_to_string(Level level) const;
-    std::string format_log_entry(const LogEntry& entry) const;
-    void write_to_file(const LogEntry& entry);
-    void write_to_console(const LogEntry& entry);
-    void rotate_log_file();
+    const char* level_to_string(Level level) const;
+    void format_log_entry(const LogEntry& entry, std::string& out) const;
+    void format_json_entry(const LogEntry& entry, std::string& out, std::string& scratch) const;
+    void format_binary_entry(const LogEntry& entry, std::string& out, std::string& scratch) const;
+    void append_message(const LogEntry& entry, std::string& out) const;
+    void append_entry(const LogEntry& entry, OutputBatch& batch) const;
+    void write_batch(OutputBatch& batch);
+    void open_log_file();
+    void begin_rotation_locked();
+    void finish_rotation(const std::string& pending_path);
+    void rotation_thread_function();
     void worker_thread_function();
-
+    void render_format(const LogEntry& entry, std::string& out) const;
+    
+    // Writes one record in place; context points at the caller's arguments
+    using EntryFill = void (*)(LogEntry& entry, const void* context);
+    
+    void submit(Level level, EntryFill fill, const void* context);
+    bool enqueue(EntryFill fill, const void* context);
+    void wake_worker();
+    
+    StagingBuffer& staging_buffer();
+    void stage(Level level, EntryFill fill, const void* context);
+    void drain_staging_locked(StagingBuffer& buffer, bool from_worker);
+    void sweep_staging(bool from_worker);
+    
 public:
     Logger(const LoggerConfig& config);
     ~Logger();
     
-    // Log methods
-    void log(Level level, const std::string& message, const std::string& file = "",
-            uint32_t line = 0, const std::string& function = "");
+    // Check a level before building a message for it
+    bool is_enabled(Level level) const {
+        return level >= current_level_.load(std::memory_order_relaxed);
+    }
+    
+    // Log methods; file and function must be string literals
+    void log(Level level, const std::string& message, const char* file = "",
+            uint32_t line = 0, const char* function = "");
     
     // Convenience methods
-    void debug(const std::string& message, const std::string& file = "",
-              uint32_t line = 0, const std::string& function = "");
-    void info(const std::string& message, const std::string& file = "",
-             uint32_t line = 0, const std::string& function = "");
-    void warn(const std::string& message, const std::string& file = "",
-             uint32_t line = 0, const std::string& function = "");
-    void error(const std::string& message, const std::string& file = "",
-              uint32_t line = 0, const std::string& function = "");
-    void critical(const std::string& message, const std::string& file = "",
-                 uint32_t line = 0, const std::string& function = "");
+    void debug(const std::string& message, const char* file = "",
+              uint32_t line = 0, const char* function = "");
+    void info(const std::string& message, const char* file = "",
+             uint32_t line = 0, const char* function = "");
+    void warn(const std::string& message, const char* file = "",
+             uint32_t line = 0, const char* function = "");
+    void error(const std::string& message, const char* file = "",
+              uint32_t line = 0, const char* function = "");
+    void critical(const std::string& message, const char* file = "",
+                 uint32_t line = 0, const char* function = "");
     
     // Specialized logging methods
     void log_transaction(uint64_t tx_id, const std::string& operation, 
@@ -140,6 +392,7 @@ public:
         uint64_t critical_logs;
         std::chrono::milliseconds uptime;
         size_t queue_size;
+        uint64_t dropped_logs;            // Records discarded on a full ring
         bool async_enabled;
     };
     LoggerStats get_stats() const;
@@ -151,20 +404,125 @@ public:
     
 private:
     static std::unique_ptr<Logger> instance_;
+    static std::atomic<Logger*> current_instance_;    // Lock-free fast path for get_instance()
     static std::mutex instance_mutex_;
+    static std::atomic<uint64_t> next_instance_id_;
+    static thread_local std::vector<StagingHandle> staging_handles_;
+    
+    // Deferred formatting: arguments are captured into the record and each
+    // {} in format is replaced on the logger thread, which reads format
+    // after the call returns. Only reachable through the LOG_*F macros,
+    // which accept nothing but a string literal there
+    friend struct detail::FormatLogCall;
+    
+    template<size_t N, typename... Args>
+    void logf(Level level, const char* file, uint32_t line, const char* function,
+              const char (&format)[N], const Args&... args) {
+        if (!is_enabled(level)) {
+            return;
+        }
+        
+        auto fill = [&](LogEntry& entry) {
+            entry.assign_format(level, format, file, line, function);
+            detail::LogArgWriter writer(entry.message, MESSAGE_CAPACITY);
+            (writer.write(args), ...);
+            entry.length = static_cast<uint32_t>(writer.length());
+            entry.truncated = writer.truncated();
+        };
+        using Fill = decltype(fill);
+        submit(level, [](LogEntry& entry, const void* context) {
+            (*static_cast<const Fill*>(context))(entry);
+        }, &fill);
+    }
+};
+
+namespace detail {
+
+struct FormatLogCall {
+    template<size_t N, typename... Args>
+    static void log(Logger* logger, Logger::Level level, const char* file, uint32_t line,
+                    const char* function, const char (&format)[N], const Args&... args) {
+        logger->logf(level, file, line, function, format, args...);
+    }
 };
 
-// Macro definitions for convenient logging
-#define LOG_DEBUG(msg) Logger::get_instance()->debug(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_INFO(msg) Logger::get_instance()->info(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_WARN(msg) Logger::get_instance()->warn(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_ERROR(msg) Logger::get_instance()->error(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_CRITICAL(msg) Logger::get_instance()->critical(msg, __FILE__, __LINE__, __FUNCTION__)
-
-#define LOG_TRANSACTION(tx_id, op, details) Logger::get_instance()->log_transaction(tx_id, op, details)
-#define LOG_PERFORMANCE(op, duration) Logger::get_instance()->log_performance(op, duration)
-#define LOG_ERROR_EXCEPTION(e, context) Logger::get_instance()->log_error(e, context)
-#define LOG_SYSTEM_EVENT(event, details) Logger::get_instance()->log_system_event(event, details)
+} // namespace detail
+
+// Macro definitions for convenient logging. The message expression is only
+// evaluated when the level is enabled
+#define DFS_LOG_AT(level, method, msg) \
+    do { \
+        ::dfs::utils::Logger* dfs_logger_ = ::dfs::utils::Logger::get_instance(); \
+        if (dfs_logger_->is_enabled(::dfs::utils::Logger::Level::level)) { \
+            dfs_logger_->method(msg, __FILE__, __LINE__, __FUNCTION__); \
+        } \
+    } while (0)
+
+#define DFS_LOGF_AT(level, ...) \
+    do { \
+        ::dfs::utils::Logger* dfs_logger_ = ::dfs::utils::Logger::get_instance(); \
+        if (dfs_logger_->is_enabled(::dfs::utils::Logger::Level::level)) { \
+            ::dfs::utils::detail::FormatLogCall::log(dfs_logger_, ::dfs::utils::Logger::Level::level, \
+                                                     __FILE__, __LINE__, __FUNCTION__, "" __VA_ARGS__); \
+        } \
+    } while (0)
+
+// Compiled-out call: still type-checked, never evaluated
+#define DFS_LOG_DISABLED(...) \
+    do { \
+        if (false) { \
+            ::dfs::utils::detail::discard_log_args(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// The "" prefix only concatenates with a string literal, so a LOG_*F
+// format cannot be a buffer that is gone before the logger thread reads it
+#define DFS_LOGF_DISABLED(...) DFS_LOG_DISABLED("" __VA_ARGS__)
+
+#if DFS_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(msg) DFS_LOG_AT(LOG_DEBUG, debug, msg)
+#define LOG_DEBUGF(...) DFS_LOGF_AT(LOG_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(msg) DFS_LOG_DISABLED(msg)
+#define LOG_DEBUGF(...) DFS_LOGF_DISABLED(__VA_ARGS__)
+#endif
+
+#if DFS_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(msg) DFS_LOG_AT(LOG_INFO, info, msg)
+#define LOG_INFOF(...) DFS_LOGF_AT(LOG_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(msg) DFS_LOG_DISABLED(msg)
+#define LOG_INFOF(...) DFS_LOGF_DISABLED(__VA_ARGS__)
+#endif
+
+#if DFS_LOG_MIN_LEVEL <= 2
+#define LOG_WARN(msg) DFS_LOG_AT(LOG_WARN, warn, msg)
+#define LOG_WARNF(...) DFS_LOGF_AT(LOG_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(msg) DFS_LOG_DISABLED(msg)
+#define LOG_WARNF(...) DFS_LOGF_DISABLED(__VA_ARGS__)
+#endif
+
+#if DFS_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(msg) DFS_LOG_AT(LOG_ERROR, error, msg)
+#define LOG_ERRORF(...) DFS_LOGF_AT(LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(msg) DFS_LOG_DISABLED(msg)
+#define LOG_ERRORF(...) DFS_LOGF_DISABLED(__VA_ARGS__)
+#endif
+
+#if DFS_LOG_MIN_LEVEL <= 4
+#define LOG_CRITICAL(msg) DFS_LOG_AT(LOG_CRITICAL, critical, msg)
+#define LOG_CRITICALF(...) DFS_LOGF_AT(LOG_CRITICAL, __VA_ARGS__)
+#else
+#define LOG_CRITICAL(msg) DFS_LOG_DISABLED(msg)
+#define LOG_CRITICALF(...) DFS_LOGF_DISABLED(__VA_ARGS__)
+#endif
+
+#define LOG_TRANSACTION(tx_id, op, details) ::dfs::utils::Logger::get_instance()->log_transaction(tx_id, op, details)
+#define LOG_PERFORMANCE(op, duration) ::dfs::utils::Logger::get_instance()->log_performance(op, duration)
+#define LOG_ERROR_EXCEPTION(e, context) ::dfs::utils::Logger::get_instance()->log_error(e, context)
+#define LOG_SYSTEM_EVENT(event, details) ::dfs::utils::Logger::get_instance()->log_system_event(event, details)
 
 } // namespace utils
 } // namespace dfs
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * Lz4 - LZ4 block format codec
+ * Output is compatible with the reference LZ4 block format (no frame
+ * header), so blocks can be inspected with standard tools. compress_frame
+ * wraps a whole stream in the LZ4 frame format, which the lz4 command-line
+ * tool can decompress.
+ */
+class Lz4 {
+public:
+    // Largest compressed size for an input of the given size
+    static size_t compress_bound(size_t size);
+    
+    // Compress into dst; returns the compressed size, or 0 if it does not fit in capacity
+    static size_t compress(const void* src, size_t size, void* dst, size_t capacity);
+    
+    // Decompress into dst; returns the decompressed size. Throws
+    // FileSystemCorruptedException on malformed input or if dst is too small.
+    static size_t decompress(const void* src, size_t size, void* dst, size_t capacity);
+    
+    // Compress everything read from in into one LZ4 frame of independent
+    // 4MB blocks with XXH32 block checksums; returns the bytes consumed.
+    // Throws FileSystemException if out fails
+    static uint64_t compress_frame(std::istream& in, std::ostream& out);
+    
+private:
+    // Minimum match length and the end-of-block rules of the format
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t LAST_LITERALS = 5;
+    static constexpr size_t MATCH_FIND_LIMIT = 12;
+    static constexpr size_t MAX_DISTANCE = 65535;
+    static constexpr int HASH_BITS = 12;
+    
+    // Frame format constants
+    static constexpr uint32_t FRAME_MAGIC = 0x184D2204;
+    static constexpr size_t FRAME_BLOCK_SIZE = 4 * 1024 * 1024;
+};
+
+} // namespace utils
+} // namespace dfs
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * MpscRing - Bounded lock-free multi-producer single-consumer ring
+ * Producers claim a slot by advancing the tail with a CAS, fill it in place
+ * and publish it through the slot's sequence number; the single consumer
+ * reads published slots in order and hands them back. Follows Vyukov's
+ * bounded MPMC queue with the consumer side reduced to one thread. A full
+ * ring fails the push instead of waiting, so callers choose the policy.
+ */
+template<typename T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity)
+        : head_(0), tail_(0) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        capacity_ = rounded;
+        mask_ = rounded - 1;
+        slots_.reset(new Slot[rounded]);
+        for (size_t i = 0; i < rounded; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+    
+    // Any thread: claim a slot, call fill(T&) on it and publish it; false if full
+    template<typename Fill>
+    bool try_push(Fill&& fill) {
+        size_t position = tail_.load(std::memory_order_relaxed);
+        Slot* slot;
+        
+        while (true) {
+            slot = &slots_[position & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            
+            if (difference == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // The consumer has not released this slot yet
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        fill(slot->value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Any thread: claim count consecutive slots with one CAS and call
+    // fill(T&, i) for each; all or nothing, false if they are not all free.
+    // The consumer frees slots in order, so the last one being free means
+    // the ones before it are too
+    template<typename Fill>
+    bool try_push_batch(size_t count, Fill&& fill) {
+        if (count == 0) {
+            return true;
+        }
+        if (count > capacity_) {
+            return false;
+        }
+        
+        size_t position = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            size_t last = position + count - 1;
+            size_t sequence = slots_[last & mask_].sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(last);
+            
+            if (difference == 0) {
+                if (tail_.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        for (size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[(position + i) & mask_];
+            fill(slot.value, i);
+            slot.sequence.store(position + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+    
+    // Consumer only: call consume(T&) on up to max published items in order
+    template<typename Consume>
+    size_t consume(Consume&& consume_item, size_t max) {
+        size_t consumed = 0;
+        while (consumed < max) {
+            Slot& slot = slots_[head_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+                break;
+            }
+            
+            consume_item(slot.value);
+            slot.sequence.store(head_ + capacity_, std::memory_order_release);
+            head_++;
+            consumed++;
+        }
+        consumed_.store(head_, std::memory_order_relaxed);
+        return consumed;
+    }
+    
+    // Consumer only: whether the next item is published
+    bool ready() const {
+        return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) == head_ + 1;
+    }
+    
+    // Approximate number of claimed slots
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = consumed_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+    
+    size_t capacity() const {
+        return capacity_;
+    }
+    
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    
+    // Consumer position; written only by the consumer
+    alignas(64) size_t head_;
+    std::atomic<size_t> consumed_{0};
+    
+    // Next slot producers will claim
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+} // namespace utils
+} // namespace dfs
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * Fork-join helpers on top of ThreadPool
+ * Work is split into chunks that the pool's workers and the calling thread
+ * claim from a shared counter, so the caller does useful work instead of
+ * sleeping on futures, and a call made from inside a pool task cannot
+ * deadlock: if every worker is busy the caller runs all chunks itself.
+ * The first exception thrown by a chunk is rethrown to the caller once the
+ * chunks already running have finished; chunks not yet started are skipped.
+ */
+
+// Run chunk(i) for every i in [0, chunks), helped by up to one pool worker
+// per chunk beyond the first; returns when all have run or been skipped
+void run_chunks(ThreadPool& pool, size_t chunks, const std::function<void(size_t)>& chunk,
+                ThreadPool::Priority priority = ThreadPool::Priority::NORMAL);
+
+// Call body(begin, end) over [first, last) in subranges of about grain items
+template<typename Index, typename Body>
+void parallel_for(ThreadPool& pool, Index first, Index last, Index grain, Body&& body,
+                  ThreadPool::Priority priority = ThreadPool::Priority::NORMAL) {
+    static_assert(std::is_integral<Index>::value, "parallel_for needs an integral index");
+    if (!(first < last)) {
+        return;
+    }
+    
+    Index step = std::max<Index>(grain, 1);
+    size_t chunks = static_cast<size_t>((last - first - 1) / step) + 1;
+    run_chunks(pool, chunks, [&](size_t i) {
+        Index begin = first + static_cast<Index>(i) * step;
+        Index end = last - begin > step ? begin + step : last;
+        body(begin, end);
+    }, priority);
+}
+
+// Reduce [first, last): map(begin, end) produces a value per subrange, and
+// the values are folded left to right with combine, so the result does not
+// depend on which thread ran which subrange
+template<typename T, typename Index, typename Map, typename Combine>
+T parallel_reduce(ThreadPool& pool, Index first, Index last, Index grain, T identity,
+                  Map&& map, Combine&& combine,
+                  ThreadPool::Priority priority = ThreadPool::Priority::NORMAL) {
+    static_assert(std::is_integral<Index>::value, "parallel_reduce needs an integral index");
+    if (!(first < last)) {
+        return identity;
+    }
+    
+    Index step = std::max<Index>(grain, 1);
+    size_t chunks = static_cast<size_t>((last - first - 1) / step) + 1;
+    std::vector<T> partials(chunks, identity);
+    run_chunks(pool, chunks, [&](size_t i) {
+        Index begin = first + static_cast<Index>(i) * step;
+        Index end = last - begin > step ? begin + step : last;
+        partials[i] = map(begin, end);
+    }, priority);
+    
+    T result = std::move(identity);
+    for (T& partial : partials) {
+        result = combine(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+/**
+ * TaskGraph - Runs tasks on a ThreadPool in dependency order
+ * Add tasks, declare which must finish before which, then run(); the graph
+ * can be run again. Tasks whose dependencies are met go to a ready list
+ * that pool workers and the calling thread both drain. If a task throws,
+ * tasks not yet started are skipped and run() rethrows the first exception.
+ */
+class TaskGraph {
+public:
+    using TaskId = size_t;
+    
+    explicit TaskGraph(ThreadPool& pool);
+    
+    TaskId add_task(std::function<void()> task, ThreadPool::Priority priority = ThreadPool::Priority::NORMAL);
+    
+    // Make after wait for before to finish
+    void add_dependency(TaskId before, TaskId after);
+    
+    size_t size() const { return tasks_.size(); }
+    
+    // Run every task and wait; throws std::invalid_argument on a cycle
+    void run();
+    
+private:
+    struct Node {
+        std::function<void()> task;
+        ThreadPool::Priority priority;
+        std::vector<TaskId> successors;
+        size_t dependencies;
+    };
+    
+    struct RunState;
+    
+    ThreadPool& pool_;
+    std::vector<Node> tasks_;
+    
+    // Run one ready task from the state's list, if any; false when none was ready
+    static bool run_ready(const std::shared_ptr<RunState>& state);
+};
+
+} // namespace utils
+} // namespace dfs
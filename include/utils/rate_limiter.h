@@ -14,7 +14,13 @@ namespace utils {
 
 /**
  * RateLimiter - Implements token bucket algorithm for request rate limiting
- * Provides per-client rate limiting with configurable thresholds
+ * Provides per-client rate limiting with configurable thresholds.
+ * Clients live in a sharded hash table whose bucket chains are read and
+ * extended with atomics only, so a check takes no lock. Removal unlinks
+ * under a per-shard mutex and frees entries once every lookup that could
+ * still see them has finished, tracked by a per-shard epoch. Each
+ * client's bucket and window are single atomic words updated by CAS, and
+ * configuration updates are published to checks under a sequence lock.
  */
 class RateLimiter {
 public:
@@ -29,53 +35,142 @@ public:
                        std::chrono::seconds window = std::chrono::seconds(1),
                        bool per_client = true);
     };
-
+    
 private:
-    // Token bucket for a single client
+    // Token bucket for a single client, kept as a generic cell rate
+    // algorithm. The state word is the theoretical arrival time: the moment,
+    // in nanoseconds since the limiter started, at which the bucket would be
+    // full again. Tokens refill continuously at refill_rate per second, each
+    // one taking 1e9 / refill_rate nanoseconds, and never exceed burst_capacity
     struct TokenBucket {
-        std::atomic<uint32_t> tokens;
-        std::chrono::steady_clock::time_point last_refill;
-        std::mutex bucket_mutex;
+        static constexpr uint64_t NANOS_PER_SECOND = 1000000000;
+        
+        std::atomic<uint64_t> state;
         
-        TokenBucket(uint32_t capacity);
+        explicit TokenBucket(uint64_t now_ns);
         
         // Try to consume tokens
         bool try_consume(uint32_t tokens_needed, uint32_t refill_rate, 
-                        std::chrono::seconds refill_interval);
+                        uint32_t burst_capacity, uint64_t now_ns);
         
-        // Refill tokens based on time elapsed
-        void refill(uint32_t refill_rate, std::chrono::seconds refill_interval);
+        // Whole tokens available at now_ns
+        uint32_t available(uint32_t refill_rate, uint32_t burst_capacity, uint64_t now_ns) const;
+        
+        // Fill the bucket
+        void reset(uint64_t now_ns);
     };
     
-    // Client-specific rate limiter
+    // Client-specific rate limiter. The bucket decides admission; the window
+    // word counts admitted requests for statistics and idle detection, with
+    // the window start (milliseconds since the limiter started) above the count
     struct ClientLimiter {
-        std::unique_ptr<TokenBucket> bucket;
-        std::atomic<uint32_t> request_count;
-        std::chrono::steady_clock::time_point window_start;
-        std::mutex window_mutex;
+        static constexpr int COUNT_BITS = 24;
+        static constexpr uint64_t COUNT_MASK = (uint64_t(1) << COUNT_BITS) - 1;
+        
+        TokenBucket bucket;
+        std::atomic<uint64_t> window;
         
-        ClientLimiter(uint32_t capacity);
+        explicit ClientLimiter(uint64_t now_ns);
         
         // Check if request is allowed
-        bool is_allowed(uint32_t tokens_needed, const RateLimitConfig& config);
+        bool is_allowed(uint32_t tokens_needed, const RateLimitConfig& config, uint64_t now_ns);
         
         // Reset window for sliding window rate limiting
-        void reset_window();
+        void reset_window(uint64_t now_ms);
+        
+        uint32_t request_count() const;
+        uint64_t window_start_ms() const;
     };
     
-    RateLimitConfig config_;
-    std::unordered_map<std::string, std::unique_ptr<ClientLimiter>> client_limiters_;
-    mutable std::mutex client_mutex_;
+    // Node of a bucket chain. Chains only grow at the head, so readers can
+    // walk them while entries are added; unlinked entries keep their next
+    // pointer until they are freed
+    struct ClientEntry {
+        std::string client_id;
+        size_t hash;
+        ClientLimiter limiter;
+        std::atomic<ClientEntry*> next;
+        
+        ClientEntry(const std::string& id, size_t key_hash, uint64_t now_ns);
+    };
+    
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr size_t BUCKETS_PER_SHARD = 256;
+    
+    // Each shard sits on its own cache lines, with its own statistics.
+    // Lookups count themselves in the reader slot of the epoch they started
+    // in; removal advances the epoch and waits for the old slot to empty
+    // before freeing, so no lookup or insert is left holding a freed entry
+    struct alignas(64) Shard {
+        std::atomic<ClientEntry*> buckets[BUCKETS_PER_SHARD];
+        std::mutex removal_mutex;
+        std::atomic<uint64_t> allowed_requests;
+        std::atomic<uint64_t> denied_requests;
+        alignas(64) std::atomic<uint64_t> epoch;
+        std::atomic<uint64_t> readers[2];
+        
+        Shard();
+        
+        // Wait until no lookup that started before this call is running
+        // (caller holds removal_mutex)
+        void synchronize();
+    };
+    
+    // Marks a lookup in a shard as running for its lifetime
+    class ReadGuard {
+    public:
+        explicit ReadGuard(Shard& shard);
+        ~ReadGuard();
+        
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    
+    private:
+        Shard& shard_;
+        size_t slot_;
+    };
+    
+    // Configuration published under a sequence lock, so lock-free checks
+    // never see half of an update. Every field is atomic; a reader retries
+    // while the sequence is odd or changes during its read
+    struct ConfigCell {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> max_requests_per_second;
+        std::atomic<uint32_t> burst_capacity;
+        std::atomic<std::chrono::seconds::rep> window_seconds;
+        std::atomic<bool> enable_per_client_limits;
+        std::mutex write_mutex;
+        
+        explicit ConfigCell(const RateLimitConfig& config);
+        
+        RateLimitConfig load() const;
+        void store(const RateLimitConfig& config);
+    };
+    
+    ConfigCell config_;
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<uint32_t> active_clients_;
     
     // Global rate limiter (when per-client limits are disabled)
     std::unique_ptr<TokenBucket> global_bucket_;
     
-    // Statistics
-    std::atomic<uint64_t> total_requests_;
-    std::atomic<uint64_t> allowed_requests_;
-    std::atomic<uint64_t> denied_requests_;
+    // Statistics; totals are summed over the shards
     std::chrono::steady_clock::time_point start_time_;
-
+    
+    uint64_t now_ns() const;
+    uint64_t now_ms() const;
+    Shard& shard_for(size_t hash) const;
+    std::atomic<ClientEntry*>& bucket_for(size_t hash) const;
+    
+    // Lookups; the entry stays valid while a ReadGuard on its shard is held
+    ClientEntry* find_entry(const std::string& client_id, size_t hash) const;
+    ClientEntry* find_or_create_entry(const std::string& client_id, size_t hash);
+    void record(Shard& shard, bool allowed);
+    
+    // Unlink an entry from its chain (caller holds the shard's removal_mutex);
+    // it is freed after the shard is synchronized
+    void unlink_entry_locked(ClientEntry* entry);
+    
 public:
     RateLimiter(const RateLimitConfig& config);
     ~RateLimiter();
@@ -86,9 +181,6 @@ public:
     // Check if request is allowed (global rate limiting)
     bool is_allowed(uint32_t tokens_needed = 1);
     
-    // Get client-specific rate limiter
-    ClientLimiter* get_client_limiter(const std::string& client_id);
-    
     // Remove client limiter (cleanup)
     void remove_client(const std::string& client_id);
     
@@ -96,7 +188,7 @@ public:
     void update_config(const RateLimitConfig& new_config);
     
     // Get current configuration
-    const RateLimitConfig& get_config() const;
+    RateLimitConfig get_config() const;
     
     // Get rate limiter statistics
     struct RateLimiterStats {
@@ -126,23 +218,34 @@ public:
 
 /**
  * SlidingWindowRateLimiter - Alternative rate limiter using sliding window
+ * Approximates the sliding window from two fixed window counters per
+ * client: the current window's count plus the previous window's count
+ * weighted by how much of it the sliding window still covers. Memory per
+ * client and the cost of each check are constant.
  */
 class SlidingWindowRateLimiter {
 private:
     struct RequestWindow {
-        std::vector<std::chrono::steady_clock::time_point> requests;
-        mutable std::mutex window_mutex;
+        uint64_t window_index = 0;
+        uint32_t current_count = 0;
+        uint32_t previous_count = 0;
+        
+        // Rotate the counters forward to the given fixed window
+        void advance(uint64_t index);
         
-        void add_request();
-        uint32_t get_request_count(std::chrono::seconds window_size) const;
-        void cleanup_old_requests(std::chrono::seconds window_size);
+        // Requests in the sliding window ending at elapsed_fraction of the current window
+        double estimate(double elapsed_fraction) const;
     };
     
-    std::unordered_map<std::string, std::unique_ptr<RequestWindow>> client_windows_;
+    std::unordered_map<std::string, RequestWindow> client_windows_;
     mutable std::mutex client_mutex_;
     uint32_t max_requests_per_window_;
     std::chrono::seconds window_size_;
-
+    std::chrono::steady_clock::time_point start_time_;
+    
+    // Fixed window containing now, and how far into it now is
+    void current_position(uint64_t& window_index, double& elapsed_fraction) const;
+    
 public:
     SlidingWindowRateLimiter(uint32_t max_requests, std::chrono::seconds window);
     
@@ -152,7 +255,7 @@ public:
     // Get request count for client in current window
     uint32_t get_request_count(const std::string& client_id) const;
     
-    // Clean up old requests
+    // Clean up clients with no requests in the last two windows
     void cleanup_old_requests();
 };
 
@@ -210,6 +210,9 @@ auto RetryHandler::execute_with_retry_and_classification(Func&& func, Args&&...
  * RetryManager - Manages multiple retry handlers for different operations
  */
 class RetryManager {
+public:
+    using RetryConfig = RetryHandler::RetryConfig;
+
 private:
     std::unordered_map<std::string, std::unique_ptr<RetryHandler>> handlers_;
     mutable std::mutex handlers_mutex_;
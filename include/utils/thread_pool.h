@@ -1,7 +1,11 @@
 #pragma once
 
+#include "work_stealing_deque.h"
+#include "inline_task.h"
+#include "block_pool.h"
+#include "cpu_topology.h"
 #include <vector>
-#include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -11,13 +15,36 @@
 #include <memory>
 #include <chrono>
 #include <algorithm>
+#include <array>
+#include <tuple>
 
 namespace dfs {
 namespace utils {
 
 /**
  * ThreadPool - Manages a pool of worker threads for concurrent task execution
- * Provides thread-safe task queuing and execution with priority support
+ * Each worker owns a Chase-Lev deque per priority. Tasks submitted by a
+ * worker go to its own deque (LIFO for locality); tasks submitted from
+ * outside the pool go to a shared injection queue. For the lane it picks,
+ * an idle worker tries its own deque, then the injection queue, then
+ * stealing from a randomly chosen worker.
+ * Lanes are scheduled by weighted fair queuing on execution time: each
+ * lane's virtual time advances by the time its tasks ran divided by its
+ * weight, and the non-empty lane with the lowest virtual time goes next.
+ * A lane that has made no progress for max_lane_wait is served first, so
+ * LOW work still runs under a steady stream of CRITICAL work.
+ * The pool grows toward max_threads while queued work waits longer than
+ * grow_latency_threshold, and workers idle for thread_timeout exit until
+ * min_threads remain. A monitor thread re-checks growth while work is
+ * queued, so the pool also grows when every worker is blocked on a task
+ * it queued itself.
+ * Submission does not touch the general-purpose heap for small callables:
+ * tasks hold them inline, task nodes and future state come from BlockPool,
+ * and post() skips the future altogether.
+ * With an affinity set, worker slots are spread round-robin over NUMA
+ * nodes and pinned to a core or to their node. post_on_node() and
+ * post_near() queue work for one node; its workers take it first and
+ * steal from workers on the same node before reaching across sockets.
  */
 class ThreadPool {
 public:
@@ -28,39 +55,174 @@ public:
         HIGH = 2,
         CRITICAL = 3
     };
+    static constexpr size_t PRIORITY_LEVELS = 4;
     
-    // Task wrapper with priority
+    // Worker placement
+    enum class Affinity {
+        NONE = 0,     // Threads float; the scheduler places them
+        CORE = 1,     // Each worker pinned to one core, nodes filled round-robin
+        NODE = 2      // Each worker pinned to the cores of its NUMA node
+    };
+    
+    // Thread pool configuration
+    struct ThreadPoolConfig {
+        size_t min_threads;
+        size_t max_threads;
+        std::chrono::seconds thread_timeout;
+        bool enable_work_stealing;    // Off routes every task through the shared injection queue
+        std::chrono::milliseconds grow_latency_threshold;  // Queue wait that triggers growth
+        std::array<uint32_t, PRIORITY_LEVELS> lane_weights; // Share of worker time, indexed by Priority
+        std::chrono::milliseconds max_lane_wait;           // Aging deadline for a lane with queued work
+        Affinity affinity;
+        
+        ThreadPoolConfig(size_t min_threads = 2, size_t max_threads = std::thread::hardware_concurrency(),
+                         std::chrono::seconds timeout = std::chrono::seconds(300),
+                         bool work_stealing = true,
+                         std::chrono::milliseconds grow_latency = std::chrono::milliseconds(10),
+                         std::array<uint32_t, PRIORITY_LEVELS> weights = {1, 4, 16, 64},
+                         std::chrono::milliseconds max_wait = std::chrono::milliseconds(1000),
+                         Affinity worker_affinity = Affinity::NONE);
+    };
+    
+    // Task wrapper with priority; nodes are recycled through BlockPool
     struct Task {
-        std::function<void()> function;
+        InlineTask function;
         Priority priority;
         std::chrono::steady_clock::time_point created_time;
         
-        Task(std::function<void()> func, Priority prio = Priority::NORMAL);
+        Task(InlineTask func, Priority prio = Priority::NORMAL);
         
-        // Comparison operator for priority queue
-        bool operator<(const Task& other) const;
+        static void* operator new(size_t size);
+        static void operator delete(void* pointer, size_t size) noexcept;
     };
-
+    
+    // Log2 histogram of durations; bucket i counts durations in [2^(i-1), 2^i) ns
+    struct TaskHistogram {
+        static constexpr size_t BUCKETS = 48;
+        
+        std::array<uint64_t, BUCKETS> buckets;
+        uint64_t count;
+        std::chrono::nanoseconds total;
+        
+        TaskHistogram();
+        
+        std::chrono::nanoseconds mean() const;
+        
+        // Upper bound of the bucket holding the given quantile (0.0 - 1.0)
+        std::chrono::nanoseconds percentile(double quantile) const;
+        
+        static size_t bucket_for(uint64_t nanoseconds);
+    };
+    
+    // Queue wait and execution time of the tasks run at one priority
+    struct PriorityTimings {
+        TaskHistogram queue_wait;
+        TaskHistogram execution;
+    };
+    
+    struct WorkerUtilization {
+        size_t index;
+        size_t node;                  // NUMA node index from CpuTopology
+        int cpu;                      // Pinned core, -1 unless Affinity::CORE
+        bool running;
+        uint64_t tasks_executed;
+        double utilization;           // Busy time over the thread's lifetime, 0.0 - 1.0
+    };
+    
 private:
-    std::vector<std::thread> workers_;
-    std::priority_queue<Task> tasks_;
-    std::mutex queue_mutex_;
+    // Per-worker state. Slots for max_threads_ workers are created up front
+    // so thieves can scan them without locking.
+    // Timing counters written only by the worker's own thread, so updates
+    // are plain relaxed stores; readers merge them across workers
+    struct WorkerCounters {
+        std::atomic<uint64_t> wait_buckets[PRIORITY_LEVELS][TaskHistogram::BUCKETS];
+        std::atomic<uint64_t> exec_buckets[PRIORITY_LEVELS][TaskHistogram::BUCKETS];
+        std::atomic<uint64_t> wait_ns[PRIORITY_LEVELS];
+        std::atomic<uint64_t> exec_ns[PRIORITY_LEVELS];
+        std::atomic<uint64_t> executed[PRIORITY_LEVELS];
+        std::atomic<uint64_t> failed;
+        std::atomic<uint64_t> busy_ns;
+        std::atomic<int64_t> started_ns;    // Start of the current thread, for utilization
+        
+        WorkerCounters();
+    };
+    
+    struct Worker {
+        WorkStealingDeque<Task*> lanes[PRIORITY_LEVELS];
+        std::thread thread;
+        uint64_t steal_seed;
+        std::atomic<bool> retired;    // Thread exited on idle timeout; slot may be reused
+        size_t node;                  // NUMA node index; 0 without an affinity
+        int cpu;                      // Pinned core under Affinity::CORE, else -1
+        WorkerCounters counters;
+        
+        Worker(uint64_t seed, size_t node_index, int cpu_index);
+    };
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> thread_count_;
+    std::mutex workers_mutex_;
+    
+    // Tasks submitted from outside the pool, one FIFO per priority
+    std::deque<Task*> injection_[PRIORITY_LEVELS];
+    std::mutex injection_mutex_;
+    std::atomic<size_t> injected_tasks_;
+    
+    // Tasks routed to a NUMA node, one FIFO per priority; empty without an affinity
+    struct NodeQueue {
+        std::deque<Task*> lanes[PRIORITY_LEVELS];
+        std::mutex mutex;
+        std::atomic<size_t> tasks{0};
+    };
+    std::vector<std::unique_ptr<NodeQueue>> node_queues_;
+    Affinity affinity_;
+    
+    // Idle workers and wait_for_all_tasks sleep on sleep_mutex_
+    std::mutex sleep_mutex_;
     std::condition_variable condition_;
+    std::condition_variable idle_condition_;
+    std::atomic<size_t> idle_workers_;
+    std::atomic<size_t> queued_tasks_;
+    
     std::atomic<bool> stop_;
     std::atomic<size_t> active_tasks_;
     
     // Thread pool configuration
     size_t max_threads_;
     size_t min_threads_;
-    std::chrono::seconds thread_timeout_;
+    std::atomic<std::chrono::seconds> thread_timeout_;
+    bool work_stealing_;
+    std::chrono::milliseconds grow_latency_threshold_;
     
-    // Statistics
-    std::atomic<uint64_t> total_tasks_executed_;
+    // Scaling signals: smoothed queue wait (microseconds) and the time the
+    // last task started, which exposes stalls when every worker is busy
+    std::atomic<int64_t> queue_wait_ewma_us_;
+    std::atomic<int64_t> last_dispatch_ns_;
+    std::atomic<uint64_t> threads_started_;
+    std::atomic<uint64_t> threads_retired_;
+    
+    // Growth monitor, started only when max_threads_ > min_threads_; it
+    // parks while nothing is queued and submit() wakes it
+    std::thread monitor_;
+    std::mutex monitor_mutex_;
+    std::condition_variable monitor_condition_;
+    std::atomic<bool> monitor_parked_;
+    
+    // Fair queuing state per lane: queued tasks, virtual time, and the last
+    // time the lane dispatched a task or became non-empty
+    std::array<uint32_t, PRIORITY_LEVELS> lane_weights_;
+    std::chrono::nanoseconds max_lane_wait_;
+    std::atomic<size_t> lane_queued_[PRIORITY_LEVELS];
+    std::atomic<uint64_t> lane_virtual_time_[PRIORITY_LEVELS];
+    std::atomic<int64_t> lane_progress_ns_[PRIORITY_LEVELS];
+    std::atomic<uint64_t> virtual_time_;
+    
+    // Statistics; executed counts live in WorkerCounters
     std::atomic<uint64_t> total_tasks_queued_;
     std::chrono::steady_clock::time_point start_time_;
-
+    
 public:
     ThreadPool(size_t min_threads = 2, size_t max_threads = std::thread::hardware_concurrency());
+    explicit ThreadPool(const ThreadPoolConfig& config);
     ~ThreadPool();
     
     // Enqueue task with priority
@@ -71,6 +233,24 @@ public:
     // Enqueue task without return value
     void enqueue(std::function<void()> task, Priority priority = Priority::NORMAL);
     
+    // Submit a task with no future; exceptions it throws are logged and dropped
+    template<typename F>
+    void post(F&& f, Priority priority = Priority::NORMAL);
+    
+    // Submit a task for the workers of one NUMA node (index into
+    // CpuTopology::get_nodes()); other nodes run it only if that node's
+    // workers cannot. Without an affinity this is post()
+    template<typename F>
+    void post_on_node(size_t node, F&& f, Priority priority = Priority::NORMAL);
+    
+    // Submit a task for the node whose memory holds a buffer, such as an
+    // I/O completion or block cache fill touching that buffer
+    template<typename F>
+    void post_near(const void* buffer, F&& f, Priority priority = Priority::NORMAL);
+    
+    // Number of NUMA nodes workers are spread over; 1 without an affinity
+    size_t get_node_count() const;
+    
     // Get current queue size
     size_t get_queue_size() const;
     
@@ -89,6 +269,9 @@ public:
     // Check if thread pool is running
     bool is_running() const;
     
+    // Check if the calling thread is one of this pool's workers
+    bool is_worker_thread() const;
+    
     // Get thread pool statistics
     struct ThreadPoolStats {
         size_t total_threads;
@@ -96,20 +279,65 @@ public:
         size_t queued_tasks;
         uint64_t total_tasks_executed;
         uint64_t total_tasks_queued;
+        uint64_t total_tasks_failed;
         std::chrono::milliseconds uptime;
-        double average_task_duration;
+        double average_task_duration;     // Mean execution time in milliseconds
+        double average_queue_wait;        // Mean queue wait in milliseconds
+        
+        // Signals used to grow and shrink the pool
+        size_t idle_threads;
+        std::chrono::microseconds queue_latency;
+        uint64_t threads_started;
+        uint64_t threads_retired;
     };
     ThreadPoolStats get_stats() const;
     
+    // Per-priority queue wait and execution histograms, merged across workers
+    std::array<PriorityTimings, PRIORITY_LEVELS> get_task_timings() const;
+    
+    // Busy fraction and task count of every worker slot
+    std::vector<WorkerUtilization> get_worker_utilization() const;
+    
     // Set thread timeout
     void set_thread_timeout(std::chrono::seconds timeout);
     
     // Get thread timeout
     std::chrono::seconds get_thread_timeout() const;
-
+    
 private:
-    void worker_thread();
+    void worker_thread(size_t index);
+    void monitor_thread();
     void adjust_thread_count();
+    
+    // Start a worker in a free or retired slot (caller holds workers_mutex_)
+    void start_worker_locked();
+    
+    // Give up an idle worker's thread if more than min_threads_ are running
+    bool try_retire_worker();
+    
+    // Current queue wait: the smoothed wait, or the time since the last task
+    // started if work is queued and nothing has started since
+    std::chrono::microseconds queue_latency() const;
+    
+    // Queue a task on the caller's deque, a node queue, or the injection queue
+    void submit(std::unique_ptr<Task> task, int node = -1);
+    void wake_worker();
+    
+    // Order lanes for the next dispatch: overdue lanes first, then by virtual time
+    size_t order_lanes(size_t order[PRIORITY_LEVELS]) const;
+    
+    // Find the next task for a worker, trying lanes in fair-queuing order
+    Task* find_task(size_t index);
+    Task* take_injected(size_t lane);
+    Task* take_routed(size_t node, size_t lane);
+    Task* steal_task(size_t index, size_t lane);
+    Task* steal_remote_routed(size_t index, size_t lane);
+    
+    void run_task(Task* task, size_t index);
+    
+    // Run a callable and store its result or exception in a promise
+    template<typename R, typename F>
+    static void fulfil(std::promise<R>& promise, F& function);
 };
 
 // Template implementation
@@ -119,25 +347,59 @@ auto ThreadPool::enqueue(F&& f, Args&&... args, Priority priority)
     
     using return_type = typename std::result_of<F(Args...)>::type;
     
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
+    // The shared state is allocated through the pool, and the promise is
+    // moved into the task instead of being wrapped in a shared packaged_task
+    std::promise<return_type> promise(std::allocator_arg, PoolAllocator<return_type>());
+    std::future<return_type> result = promise.get_future();
     
-    std::future<return_type> result = task->get_future();
-    
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        
-        if (stop_) {
-            throw std::runtime_error("ThreadPool is stopped");
+    // The task runs once, so the callable and its arguments are moved into
+    // the call, as std::async does
+    submit(std::make_unique<Task>(
+        [promise = std::move(promise), function = std::forward<F>(f),
+         arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            auto call = [&function, &arguments]() -> return_type {
+                return std::apply([&function](auto&... values) -> return_type {
+                    return std::invoke(std::move(function), std::move(values)...);
+                }, arguments);
+            };
+            fulfil(promise, call);
+        },
+        priority));
+    adjust_thread_count();
+    return result;
+}
+
+template<typename F>
+void ThreadPool::post(F&& f, Priority priority) {
+    submit(std::make_unique<Task>(InlineTask(std::forward<F>(f)), priority));
+    adjust_thread_count();
+}
+
+template<typename F>
+void ThreadPool::post_on_node(size_t node, F&& f, Priority priority) {
+    submit(std::make_unique<Task>(InlineTask(std::forward<F>(f)), priority), static_cast<int>(node));
+    adjust_thread_count();
+}
+
+template<typename F>
+void ThreadPool::post_near(const void* buffer, F&& f, Priority priority) {
+    int node = node_queues_.empty() ? -1 : CpuTopology::get_instance().node_of_address(buffer);
+    submit(std::make_unique<Task>(InlineTask(std::forward<F>(f)), priority), node);
+    adjust_thread_count();
+}
+
+template<typename R, typename F>
+void ThreadPool::fulfil(std::promise<R>& promise, F& function) {
+    try {
+        if constexpr (std::is_void<R>::value) {
+            function();
+            promise.set_value();
+        } else {
+            promise.set_value(function());
         }
-        
-        tasks_.emplace([task]() { (*task)(); }, priority);
-        total_tasks_queued_++;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
     }
-    
-    condition_.notify_one();
-    return result;
 }
 
 } // namespace utils
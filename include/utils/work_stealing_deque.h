@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace dfs {
+namespace utils {
+
+/**
+ * WorkStealingDeque - Chase-Lev lock-free work-stealing deque
+ * The owning thread pushes and pops at the bottom (LIFO); any other thread
+ * steals from the top (FIFO). The ring grows on demand; replaced rings are
+ * kept until the deque is destroyed since a thief may still be reading one.
+ * Memory orderings follow Le et al., "Correct and Efficient Work-Stealing
+ * for Weak Memory Models" (PPoPP 2013).
+ */
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque holds trivially copyable values");
+    
+public:
+    explicit WorkStealingDeque(size_t initial_capacity = 64)
+        : top_(0), bottom_(0) {
+        size_t capacity = 1;
+        while (capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+        rings_.push_back(std::make_unique<Ring>(capacity));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+    
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    
+    // Owner only: add an item at the bottom
+    void push(T item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        
+        if (bottom - top > static_cast<int64_t>(ring->capacity) - 1) {
+            ring = grow(ring, top, bottom);
+        }
+        
+        ring->put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    
+    // Owner only: take the most recently pushed item
+    bool pop(T& item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        
+        if (top > bottom) {
+            // Empty
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        item = ring->get(bottom);
+        if (top == bottom) {
+            // Last item: race thieves for it
+            bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+    
+    // Any thread: take the oldest item; fails if empty or another thread won it
+    bool steal(T& item) {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        
+        if (top >= bottom) {
+            return false;
+        }
+        
+        Ring* ring = ring_.load(std::memory_order_acquire);
+        item = ring->get(top);
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+    
+    // Approximate number of items; exact only when called by the owner
+    size_t size() const {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+    
+    bool empty() const {
+        return size() == 0;
+    }
+    
+private:
+    struct Ring {
+        size_t capacity;
+        std::unique_ptr<std::atomic<T>[]> slots;
+        
+        explicit Ring(size_t ring_capacity)
+            : capacity(ring_capacity), slots(new std::atomic<T>[ring_capacity]) {}
+        
+        T get(int64_t index) const {
+            return slots[static_cast<size_t>(index) & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+        
+        void put(int64_t index, T item) {
+            slots[static_cast<size_t>(index) & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+    
+    // Keep top and bottom on separate cache lines; thieves write top, the owner bottom
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Ring*> ring_;
+    
+    // Every ring ever used, owned here so thieves never read freed memory
+    std::vector<std::unique_ptr<Ring>> rings_;
+    
+    Ring* grow(Ring* ring, int64_t top, int64_t bottom) {
+        auto larger = std::make_unique<Ring>(ring->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            larger->put(i, ring->get(i));
+        }
+        
+        Ring* result = larger.get();
+        rings_.push_back(std::move(larger));
+        ring_.store(result, std::memory_order_release);
+        return result;
+    }
+};
+
+} // namespace utils
+} // namespace dfs
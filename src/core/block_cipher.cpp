@@ -0,0 +1,178 @@
+#include "core/block_cipher.h"
+#include "utils/logger.h"
+#include "utils/exceptions.h"
+#include <openssl/evp.h>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+namespace dfs {
+namespace core {
+
+namespace {
+
+// Copy a keyed context, or free both and return null
+EVP_CIPHER_CTX* copy_context(const EVP_CIPHER_CTX* keyed) {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx && EVP_CIPHER_CTX_copy(ctx, keyed) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = nullptr;
+    }
+    return ctx;
+}
+
+} // namespace
+
+BlockCipher::XtsKey::XtsKey(const uint8_t* key, size_t key_size) {
+    const EVP_CIPHER* cipher = key_size == XTS_AES128_KEY_SIZE ? EVP_aes_128_xts() : EVP_aes_256_xts();
+    
+    keyed.encrypt = EVP_CIPHER_CTX_new();
+    keyed.decrypt = EVP_CIPHER_CTX_new();
+    if (!keyed.encrypt || !keyed.decrypt ||
+        EVP_EncryptInit_ex(keyed.encrypt, cipher, nullptr, key, nullptr) != 1 ||
+        EVP_DecryptInit_ex(keyed.decrypt, cipher, nullptr, key, nullptr) != 1) {
+        EVP_CIPHER_CTX_free(keyed.encrypt);
+        EVP_CIPHER_CTX_free(keyed.decrypt);
+        throw dfs::utils::FileSystemException("libcrypto AES-XTS initialization failed");
+    }
+}
+
+BlockCipher::XtsKey::~XtsKey() {
+    // Freeing a context clears its key schedule
+    for (const XtsContexts& contexts : idle) {
+        EVP_CIPHER_CTX_free(contexts.encrypt);
+        EVP_CIPHER_CTX_free(contexts.decrypt);
+    }
+    EVP_CIPHER_CTX_free(keyed.encrypt);
+    EVP_CIPHER_CTX_free(keyed.decrypt);
+}
+
+BlockCipher::XtsContexts BlockCipher::XtsKey::acquire() const {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    if (!idle.empty()) {
+        XtsContexts contexts = idle.back();
+        idle.pop_back();
+        return contexts;
+    }
+    
+    // The template is never used for data, so copying it here is safe
+    XtsContexts contexts{copy_context(keyed.encrypt), copy_context(keyed.decrypt)};
+    if (!contexts.encrypt || !contexts.decrypt) {
+        EVP_CIPHER_CTX_free(contexts.encrypt);
+        EVP_CIPHER_CTX_free(contexts.decrypt);
+        throw dfs::utils::FileSystemException("libcrypto AES-XTS context copy failed");
+    }
+    return contexts;
+}
+
+void BlockCipher::XtsKey::release(XtsContexts contexts) const {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    idle.push_back(contexts);
+}
+
+BlockCipher::BlockCipher() {
+    LOG_INFO("Creating BlockCipher (AES-XTS)");
+}
+
+void BlockCipher::set_key(uint32_t key_id, const std::vector<uint8_t>& key) {
+    if (key.size() != XTS_AES128_KEY_SIZE && key.size() != XTS_AES256_KEY_SIZE) {
+        throw dfs::utils::ConfigurationException("encryption_key_size", std::to_string(key.size()));
+    }
+    
+    // IEEE 1619 requires distinct data and tweak keys
+    size_t half = key.size() / 2;
+    if (std::memcmp(key.data(), key.data() + half, half) == 0) {
+        throw dfs::utils::ConfigurationException("encryption_key", "data and tweak keys must differ");
+    }
+    
+    auto xts_key = std::make_shared<const XtsKey>(key.data(), key.size());
+    
+    std::unique_lock<std::shared_mutex> lock(keys_mutex_);
+    keys_[key_id] = std::move(xts_key);
+    
+    LOG_INFO("Registered encryption key " + std::to_string(key_id));
+}
+
+void BlockCipher::load_key_file(uint32_t key_id, const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw dfs::utils::ConfigurationException("encryption_key_file", path);
+    }
+    
+    std::vector<uint8_t> key((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    try {
+        set_key(key_id, key);
+    } catch (...) {
+        wipe_key(key);
+        throw;
+    }
+    wipe_key(key);
+}
+
+void BlockCipher::remove_key(uint32_t key_id) {
+    std::unique_lock<std::shared_mutex> lock(keys_mutex_);
+    keys_.erase(key_id);
+}
+
+bool BlockCipher::has_key(uint32_t key_id) const {
+    std::shared_lock<std::shared_mutex> lock(keys_mutex_);
+    return keys_.count(key_id) > 0;
+}
+
+void BlockCipher::encrypt(uint32_t key_id, uint64_t sector, uint8_t* data, size_t size) const {
+    process(*get_key(key_id), sector, data, size, true);
+}
+
+void BlockCipher::decrypt(uint32_t key_id, uint64_t sector, uint8_t* data, size_t size) const {
+    process(*get_key(key_id), sector, data, size, false);
+}
+
+void BlockCipher::wipe_key(std::vector<uint8_t>& key) {
+    volatile uint8_t* bytes = key.data();
+    for (size_t i = 0; i < key.size(); ++i) {
+        bytes[i] = 0;
+    }
+}
+
+std::shared_ptr<const BlockCipher::XtsKey> BlockCipher::get_key(uint32_t key_id) const {
+    std::shared_lock<std::shared_mutex> lock(keys_mutex_);
+    
+    auto it = keys_.find(key_id);
+    if (it == keys_.end()) {
+        throw dfs::utils::ConfigurationException("encryption_key_id", std::to_string(key_id));
+    }
+    return it->second;
+}
+
+void BlockCipher::process(const XtsKey& key, uint64_t sector, uint8_t* data, size_t size, bool encrypt) {
+    if (size < MIN_UNIT_SIZE) {
+        throw dfs::utils::FileSystemException("XTS data unit shorter than one AES block: " +
+                                             std::to_string(size));
+    }
+    if (size > INT_MAX) {
+        throw dfs::utils::FileSystemException("XTS data unit too large: " + std::to_string(size));
+    }
+    
+    // The tweak is the little-endian sector number (IEEE 1619)
+    uint8_t tweak[MIN_UNIT_SIZE] = {};
+    for (int i = 0; i < 8; ++i) {
+        tweak[i] = static_cast<uint8_t>(sector >> (8 * i));
+    }
+    
+    XtsContexts contexts = key.acquire();
+    EVP_CIPHER_CTX* ctx = encrypt ? contexts.encrypt : contexts.decrypt;
+    int written = 0;
+    bool ok = EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, tweak, -1) == 1 &&
+              EVP_CipherUpdate(ctx, data, &written, data, static_cast<int>(size)) == 1 &&
+              static_cast<size_t>(written) == size;
+    key.release(contexts);
+    
+    if (!ok) {
+        throw dfs::utils::FileSystemException("libcrypto AES-XTS operation failed");
+    }
+}
+
+} // namespace core
+} // namespace dfs
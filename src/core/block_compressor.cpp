@@ -0,0 +1,266 @@
+#include "core/block_compressor.h"
+#include "utils/checksum.h"
+#include "utils/lz4.h"
+#include "utils/logger.h"
+#include "utils/exceptions.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dfs {
+namespace core {
+
+static_assert(sizeof(BlockCompressor::ExtentHeader) == 20, "ExtentHeader layout changed");
+
+// CompressionConfig implementation
+BlockCompressor::CompressionConfig::CompressionConfig(Algorithm algorithm, uint32_t group_blocks,
+                                                      uint32_t sample_size, double min_savings,
+                                                      size_t cache_bytes)
+    : algorithm(algorithm), group_blocks(group_blocks), sample_size(sample_size),
+      min_savings(min_savings), cache_bytes(cache_bytes) {}
+
+// BlockCompressor implementation
+BlockCompressor::BlockCompressor(uint32_t block_size, const CompressionConfig& config)
+    : block_size_(block_size), config_(config), cached_bytes_(0), stats_() {
+    
+    if (block_size == 0 || config.group_blocks == 0) {
+        throw dfs::utils::ConfigurationException("compression_group_blocks", std::to_string(config.group_blocks));
+    }
+    
+    LOG_INFO("Creating BlockCompressor with " + std::to_string(config.group_blocks) +
+             "-block groups");
+}
+
+BlockCompressor::EncodedExtent BlockCompressor::encode_extent(const uint8_t* data, size_t size) {
+    EncodedExtent extent;
+    extent.raw = true;
+    bool bypassed = false;
+    size_t limit = compressed_limit(size);
+    
+    if (config_.algorithm == Algorithm::LZ4 && limit > 0) {
+        if (!sample_compresses(data, size)) {
+            bypassed = true;
+        } else {
+            extent.bytes.resize(sizeof(ExtentHeader) + limit);
+            
+            size_t compressed = dfs::utils::Lz4::compress(data, size, extent.bytes.data() + sizeof(ExtentHeader),
+                                                          limit);
+            if (compressed > 0) {
+                extent.bytes.resize(sizeof(ExtentHeader) + compressed);
+                extent.raw = false;
+                
+                ExtentHeader header{};
+                header.magic = EXTENT_MAGIC;
+                header.algorithm = static_cast<uint8_t>(Algorithm::LZ4);
+                header.raw_length = static_cast<uint32_t>(size);
+                header.stored_length = static_cast<uint32_t>(compressed);
+                header.checksum = dfs::utils::Checksum::crc32c(data, size);
+                std::memcpy(extent.bytes.data(), &header, sizeof(header));
+            }
+        }
+    }
+    
+    if (extent.raw) {
+        extent.bytes.assign(data, data + size);
+    }
+    
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.raw_bytes += size;
+    
+    if (extent.raw) {
+        if (bypassed) {
+            stats_.extents_bypassed++;
+        }
+        stats_.extents_stored_raw++;
+    } else {
+        stats_.extents_compressed++;
+    }
+    
+    stats_.stored_bytes += extent.bytes.size();
+    return extent;
+}
+
+std::vector<uint8_t> BlockCompressor::decode_extent(const uint8_t* stored, size_t size, bool raw) const {
+    if (!raw) {
+        return decode_compressed(stored, size);
+    }
+    
+    if (size > get_group_bytes()) {
+        throw dfs::utils::FileSystemCorruptedException("Raw extent larger than a group");
+    }
+    return std::vector<uint8_t>(stored, stored + size);
+}
+
+std::vector<uint8_t> BlockCompressor::decode_compressed(const uint8_t* stored, size_t size) const {
+    ExtentHeader header;
+    if (size < sizeof(header)) {
+        throw dfs::utils::FileSystemCorruptedException("Extent shorter than its header");
+    }
+    std::memcpy(&header, stored, sizeof(header));
+    
+    // Bound the allocation before the checksum can vouch for raw_length
+    if (header.magic != EXTENT_MAGIC || header.stored_length > size - sizeof(header) ||
+        header.raw_length > get_group_bytes()) {
+        throw dfs::utils::FileSystemCorruptedException("Invalid extent header");
+    }
+    
+    const uint8_t* payload = stored + sizeof(header);
+    std::vector<uint8_t> data(header.raw_length);
+    
+    switch (static_cast<Algorithm>(header.algorithm)) {
+        case Algorithm::NONE:
+            if (header.stored_length != header.raw_length) {
+                throw dfs::utils::FileSystemCorruptedException("Raw extent length mismatch");
+            }
+            if (header.raw_length > 0) {
+                std::memcpy(data.data(), payload, header.raw_length);
+            }
+            break;
+        case Algorithm::LZ4:
+            if (dfs::utils::Lz4::decompress(payload, header.stored_length, data.data(), data.size()) !=
+                header.raw_length) {
+                throw dfs::utils::FileSystemCorruptedException("Compressed extent length mismatch");
+            }
+            break;
+        default:
+            throw dfs::utils::FileSystemCorruptedException("Unknown extent compression algorithm " +
+                                                           std::to_string(header.algorithm));
+    }
+    
+    if (dfs::utils::Checksum::crc32c(data.data(), data.size()) != header.checksum) {
+        throw dfs::utils::FileSystemCorruptedException("Extent checksum mismatch");
+    }
+    
+    return data;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> BlockCompressor::read_extent(uint32_t first_block, bool raw,
+                                                                         const ExtentReader& reader) {
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        
+        auto it = cache_index_.find(first_block);
+        if (it != cache_index_.end()) {
+            cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second);
+            
+            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+            stats_.cache_hits++;
+            return it->second->second;
+        }
+        
+        PendingLoad& load = pending_loads_[first_block];
+        load.readers++;
+        generation = load.generation;
+    }
+    
+    // Read and decode without holding the cache lock
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    try {
+        std::vector<uint8_t> stored = reader(first_block);
+        data = std::make_shared<const std::vector<uint8_t>>(decode_extent(stored.data(), stored.size(), raw));
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        finish_load(first_block, generation);
+        throw;
+    }
+    
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        stats_.cache_misses++;
+    }
+    
+    // Skip caching if the extent was invalidated during the read, or
+    // another reader filled it meanwhile
+    bool current = finish_load(first_block, generation);
+    if (current && cache_index_.count(first_block) == 0 && data->size() <= config_.cache_bytes) {
+        cache_lru_.emplace_front(first_block, data);
+        cache_index_[first_block] = cache_lru_.begin();
+        cached_bytes_ += data->size();
+        evict_extents();
+    }
+    
+    return data;
+}
+
+void BlockCompressor::invalidate_extent(uint32_t first_block) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    
+    auto load = pending_loads_.find(first_block);
+    if (load != pending_loads_.end()) {
+        load->second.generation++;
+    }
+    
+    auto it = cache_index_.find(first_block);
+    if (it == cache_index_.end()) {
+        return;
+    }
+    
+    cached_bytes_ -= it->second->second->size();
+    cache_lru_.erase(it->second);
+    cache_index_.erase(it);
+}
+
+uint32_t BlockCompressor::blocks_for(size_t stored_size) const {
+    return static_cast<uint32_t>((stored_size + block_size_ - 1) / block_size_);
+}
+
+size_t BlockCompressor::get_group_bytes() const {
+    return static_cast<size_t>(config_.group_blocks) * block_size_;
+}
+
+BlockCompressor::CompressionStats BlockCompressor::get_stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+bool BlockCompressor::sample_compresses(const uint8_t* data, size_t size) const {
+    // Small groups are cheap enough to just try
+    if (size <= static_cast<size_t>(config_.sample_size) * 2) {
+        return true;
+    }
+    
+    // Sample the middle of the group, headers at the start are often atypical
+    const uint8_t* sample = data + (size - config_.sample_size) / 2;
+    std::vector<uint8_t> scratch(dfs::utils::Lz4::compress_bound(config_.sample_size));
+    size_t compressed = dfs::utils::Lz4::compress(sample, config_.sample_size, scratch.data(), scratch.size());
+    
+    return compressed > 0 &&
+           compressed <= static_cast<size_t>(config_.sample_size * (1.0 - config_.min_savings));
+}
+
+size_t BlockCompressor::compressed_limit(size_t size) const {
+    // The header and payload must fit in at least one block fewer than the raw group
+    uint32_t raw_blocks = blocks_for(size);
+    if (raw_blocks <= 1) {
+        return 0;
+    }
+    size_t block_limit = static_cast<size_t>(raw_blocks - 1) * block_size_;
+    if (block_limit <= sizeof(ExtentHeader)) {
+        return 0;
+    }
+    
+    // Keep the compressed form only when it also saves at least min_savings
+    size_t savings_limit = static_cast<size_t>(size * (1.0 - config_.min_savings));
+    return std::min(block_limit - sizeof(ExtentHeader), savings_limit);
+}
+
+bool BlockCompressor::finish_load(uint32_t first_block, uint64_t generation) {
+    auto it = pending_loads_.find(first_block);
+    bool current = it->second.generation == generation;
+    if (--it->second.readers == 0) {
+        pending_loads_.erase(it);
+    }
+    return current;
+}
+
+void BlockCompressor::evict_extents() {
+    while (cached_bytes_ > config_.cache_bytes && !cache_lru_.empty()) {
+        cached_bytes_ -= cache_lru_.back().second->size();
+        cache_index_.erase(cache_lru_.back().first);
+        cache_lru_.pop_back();
+    }
+}
+
+} // namespace core
+} // namespace dfs
@@ -1,4 +1,5 @@
 #include "core/block_manager.h"
+#include "core/superblock.h"
 #include "utils/logger.h"
 #include "utils/exceptions.h"
 #include <algorithm>
@@ -12,7 +13,8 @@ namespace core {
 
 // BlockManager implementation
 BlockManager::BlockManager(uint32_t total_blocks, uint32_t block_size)
-    : total_blocks_(total_blocks), block_size_(block_size), next_free_block_(0) {
+    : total_blocks_(total_blocks), block_size_(block_size), next_free_block_(0),
+      unloaded_pages_(0), backing_offset_(0), counters_(nullptr) {
     
     LOG_INFO("Creating BlockManager with " + std::to_string(total_blocks) + 
              " blocks of size " + std::to_string(block_size));
@@ -20,15 +22,27 @@ BlockManager::BlockManager(uint32_t total_blocks, uint32_t block_size)
     // Initialize block bitmap (all blocks start as free)
     block_bitmap_.resize(total_blocks, true);
     
-    // Reserve block 0 for superblock
+    // Reserve the blocks holding the primary and backup superblocks
+    for (uint32_t block_id : SuperBlock::copy_block_numbers(total_blocks, block_size)) {
+        block_bitmap_[block_id] = false;
+    }
     if (total_blocks > 0) {
-        block_bitmap_[0] = false;
         next_free_block_ = 1;
     }
     
     LOG_INFO("BlockManager created successfully");
 }
 
+void BlockManager::set_counters(SuperBlockCounters* counters) {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    counters_ = counters;
+}
+
+void BlockManager::set_indirect_reader(IndirectReader reader) {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    indirect_reader_ = std::move(reader);
+}
+
 uint32_t BlockManager::allocate_block() {
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
     
@@ -37,14 +51,18 @@ uint32_t BlockManager::allocate_block() {
     
     if (block_id == UINT32_MAX) {
         LOG_ERROR("No free blocks available");
-        throw dfs::utils::InsufficientSpaceException(1, get_free_block_count());
+        throw dfs::utils::InsufficientSpaceException(1, 0);
     }
     
     // Mark block as used
     block_bitmap_[block_id] = false;
     next_free_block_ = (block_id + 1) % total_blocks_;
     
-    LOG_DEBUG("Allocated block " + std::to_string(block_id));
+    if (counters_) {
+        counters_->block_allocated();
+    }
+    
+    LOG_DEBUGF("Allocated block {}", block_id);
     return block_id;
 }
 
@@ -64,6 +82,7 @@ std::vector<uint32_t> BlockManager::allocate_blocks(uint32_t count) {
     
     // Try to find consecutive blocks first
     for (uint32_t i = 0; i < total_blocks_; ++i) {
+        ensure_page(current_block);
         if (block_bitmap_[current_block]) {
             consecutive_count++;
             if (consecutive_count == count) {
@@ -75,6 +94,10 @@ std::vector<uint32_t> BlockManager::allocate_blocks(uint32_t count) {
                 }
                 next_free_block_ = (start_block + count) % total_blocks_;
                 
+                if (counters_) {
+                    counters_->block_allocated(count);
+                }
+                
                 LOG_DEBUG("Allocated " + std::to_string(count) + " consecutive blocks starting at " + 
                          std::to_string(start_block));
                 return allocated_blocks;
@@ -96,7 +119,7 @@ std::vector<uint32_t> BlockManager::allocate_blocks(uint32_t count) {
             for (uint32_t allocated_block : allocated_blocks) {
                 block_bitmap_[allocated_block] = true;
             }
-            throw dfs::utils::InsufficientSpaceException(count, get_free_block_count());
+            throw dfs::utils::InsufficientSpaceException(count, count_free_blocks());
         }
         
         block_bitmap_[block_id] = false;
@@ -104,6 +127,10 @@ std::vector<uint32_t> BlockManager::allocate_blocks(uint32_t count) {
         next_free_block_ = (block_id + 1) % total_blocks_;
     }
     
+    if (counters_) {
+        counters_->block_allocated(count);
+    }
+    
     LOG_DEBUG("Allocated " + std::to_string(count) + " individual blocks");
     return allocated_blocks;
 }
@@ -116,14 +143,23 @@ void BlockManager::deallocate_block(uint32_t block_id) {
     
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
     
+    ensure_page(block_id);
     if (block_bitmap_[block_id]) {
         LOG_WARN("Attempting to deallocate already free block: " + std::to_string(block_id));
         return;
     }
     
+    if (drop_shared_ref(block_id)) {
+        return;
+    }
+    
     block_bitmap_[block_id] = true;
     
-    LOG_DEBUG("Deallocated block " + std::to_string(block_id));
+    if (counters_) {
+        counters_->block_freed();
+    }
+    
+    LOG_DEBUGF("Deallocated block {}", block_id);
 }
 
 void BlockManager::deallocate_blocks(const std::vector<uint32_t>& block_ids) {
@@ -135,8 +171,15 @@ void BlockManager::deallocate_blocks(const std::vector<uint32_t>& block_ids) {
             continue;
         }
         
+        ensure_page(block_id);
         if (!block_bitmap_[block_id]) {
+            if (drop_shared_ref(block_id)) {
+                continue;
+            }
             block_bitmap_[block_id] = true;
+            if (counters_) {
+                counters_->block_freed();
+            }
             LOG_DEBUG("Deallocated block " + std::to_string(block_id));
         } else {
             LOG_WARN("Attempting to deallocate already free block: " + std::to_string(block_id));
@@ -144,11 +187,199 @@ void BlockManager::deallocate_blocks(const std::vector<uint32_t>& block_ids) {
     }
 }
 
+void BlockManager::deallocate_tree(uint32_t block_id, uint32_t depth) {
+    if (block_id >= total_blocks_) {
+        LOG_ERROR("Invalid block ID: " + std::to_string(block_id));
+        throw dfs::utils::BlockNotFoundException(block_id);
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    if (depth > 0 && !indirect_reader_) {
+        throw dfs::utils::FileSystemException("Cannot deallocate indirect block " + std::to_string(block_id) +
+                                             ": no indirect reader set");
+    }
+    
+    uint32_t freed = 0;
+    release_tree(block_id, depth, block_bitmap_, extra_refs_, freed);
+    
+    if (counters_ && freed > 0) {
+        counters_->block_freed(freed);
+    }
+}
+
+void BlockManager::release_tree(uint32_t block_id, uint32_t depth, std::vector<bool>& bitmap,
+                                std::unordered_map<uint32_t, uint32_t>& refs, uint32_t& freed) const {
+    if (block_id >= total_blocks_) {
+        LOG_ERROR("Invalid block ID: " + std::to_string(block_id));
+        return;
+    }
+    
+    ensure_page(block_id);
+    if (bitmap[block_id]) {
+        LOG_WARN("Attempting to deallocate already free block: " + std::to_string(block_id));
+        return;
+    }
+    
+    // Other holders keep the block, and through it the children
+    auto it = refs.find(block_id);
+    if (it != refs.end()) {
+        if (--it->second == 0) {
+            refs.erase(it);
+        }
+        return;
+    }
+    
+    if (depth > 0) {
+        for (uint32_t child : read_children(block_id)) {
+            release_tree(child, depth - 1, bitmap, refs, freed);
+        }
+    }
+    
+    bitmap[block_id] = true;
+    freed++;
+}
+
+std::vector<uint32_t> BlockManager::read_children(uint32_t block_id) const {
+    if (!indirect_reader_) {
+        throw dfs::utils::FileSystemException("Cannot read indirect block " + std::to_string(block_id) +
+                                             ": no indirect reader set");
+    }
+    
+    std::vector<uint32_t> children = indirect_reader_(block_id);
+    children.erase(std::remove(children.begin(), children.end(), 0u), children.end());
+    return children;
+}
+
+void BlockManager::add_block_ref(uint32_t block_id) {
+    if (block_id >= total_blocks_) {
+        LOG_ERROR("Invalid block ID: " + std::to_string(block_id));
+        throw dfs::utils::BlockNotFoundException(block_id);
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    ensure_page(block_id);
+    if (block_bitmap_[block_id]) {
+        LOG_ERROR("Cannot share free block: " + std::to_string(block_id));
+        throw dfs::utils::BlockNotFoundException(block_id);
+    }
+    
+    extra_refs_[block_id]++;
+}
+
+void BlockManager::share_blocks(const std::vector<uint32_t>& block_ids) {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    for (uint32_t block_id : block_ids) {
+        if (block_id >= total_blocks_) {
+            LOG_ERROR("Invalid block ID: " + std::to_string(block_id));
+            throw dfs::utils::BlockNotFoundException(block_id);
+        }
+        
+        ensure_page(block_id);
+        if (block_bitmap_[block_id]) {
+            LOG_ERROR("Cannot share free block: " + std::to_string(block_id));
+            throw dfs::utils::BlockNotFoundException(block_id);
+        }
+    }
+    
+    for (uint32_t block_id : block_ids) {
+        extra_refs_[block_id]++;
+    }
+    
+    LOG_DEBUG("Shared " + std::to_string(block_ids.size()) + " blocks");
+}
+
+uint32_t BlockManager::get_block_ref_count(uint32_t block_id) const {
+    if (block_id >= total_blocks_) {
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    ensure_page(block_id);
+    if (block_bitmap_[block_id]) {
+        return 0;
+    }
+    
+    auto it = extra_refs_.find(block_id);
+    return it == extra_refs_.end() ? 1 : it->second + 1;
+}
+
+uint32_t BlockManager::cow_block(uint32_t block_id, uint32_t depth) {
+    if (block_id >= total_blocks_) {
+        LOG_ERROR("Invalid block ID: " + std::to_string(block_id));
+        throw dfs::utils::BlockNotFoundException(block_id);
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    if (extra_refs_.find(block_id) == extra_refs_.end()) {
+        return block_id;
+    }
+    
+    // The copy points at the same children, so each gains a reference
+    std::vector<uint32_t> children;
+    if (depth > 0) {
+        children = read_children(block_id);
+        for (uint32_t child : children) {
+            if (child >= total_blocks_) {
+                LOG_ERROR("Invalid block ID: " + std::to_string(child));
+                throw dfs::utils::BlockNotFoundException(child);
+            }
+            ensure_page(child);
+            if (block_bitmap_[child]) {
+                LOG_ERROR("Indirect block " + std::to_string(block_id) + " points at free block " +
+                          std::to_string(child));
+                throw dfs::utils::BlockNotFoundException(child);
+            }
+        }
+    }
+    
+    uint32_t new_block = find_next_free_block(next_free_block_);
+    if (new_block == UINT32_MAX) {
+        LOG_ERROR("No free blocks available for copy-on-write of block " + std::to_string(block_id));
+        throw dfs::utils::InsufficientSpaceException(1, 0);
+    }
+    
+    block_bitmap_[new_block] = false;
+    next_free_block_ = (new_block + 1) % total_blocks_;
+    drop_shared_ref(block_id);
+    
+    for (uint32_t child : children) {
+        extra_refs_[child]++;
+    }
+    
+    if (counters_) {
+        counters_->block_allocated();
+    }
+    
+    LOG_DEBUG("Copy-on-write of shared block " + std::to_string(block_id) + " to " + std::to_string(new_block));
+    return new_block;
+}
+
+bool BlockManager::drop_shared_ref(uint32_t block_id) {
+    auto it = extra_refs_.find(block_id);
+    if (it == extra_refs_.end()) {
+        return false;
+    }
+    
+    if (--it->second == 0) {
+        extra_refs_.erase(it);
+    }
+    
+    LOG_DEBUG("Dropped reference to shared block " + std::to_string(block_id));
+    return true;
+}
+
 bool BlockManager::is_block_free(uint32_t block_id) const {
     if (block_id >= total_blocks_) {
         return false;
     }
     
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    ensure_page(block_id);
     return block_bitmap_[block_id];
 }
 
@@ -159,6 +390,10 @@ void BlockManager::mark_block_used(uint32_t block_id) {
     }
     
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    ensure_page(block_id);
+    if (block_bitmap_[block_id] && counters_) {
+        counters_->block_allocated();
+    }
     block_bitmap_[block_id] = false;
     
     LOG_DEBUG("Marked block " + std::to_string(block_id) + " as used");
@@ -171,13 +406,23 @@ void BlockManager::mark_block_free(uint32_t block_id) {
     }
     
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    ensure_page(block_id);
+    if (!block_bitmap_[block_id] && counters_) {
+        counters_->block_freed();
+    }
     block_bitmap_[block_id] = true;
+    extra_refs_.erase(block_id);
     
     LOG_DEBUG("Marked block " + std::to_string(block_id) + " as free");
 }
 
 uint32_t BlockManager::get_free_block_count() const {
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    return count_free_blocks();
+}
+
+uint32_t BlockManager::count_free_blocks() const {
+    load_all_pages();
     
     uint32_t count = 0;
     for (bool is_free : block_bitmap_) {
@@ -197,18 +442,19 @@ uint32_t BlockManager::get_block_size() const {
     return block_size_;
 }
 
+std::vector<bool> BlockManager::copy_bitmap() const {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    load_all_pages();
+    return block_bitmap_;
+}
+
 BlockManager::BlockStats BlockManager::get_block_stats() const {
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
     
     BlockStats stats;
     stats.total_blocks = total_blocks_;
-    stats.free_blocks = 0;
-    
-    for (bool is_free : block_bitmap_) {
-        if (is_free) {
-            stats.free_blocks++;
-        }
-    }
+    stats.free_blocks = count_free_blocks();
     
     stats.used_blocks = stats.total_blocks - stats.free_blocks;
     stats.usage_percentage = (stats.total_blocks > 0) ? 
@@ -217,19 +463,31 @@ BlockManager::BlockStats BlockManager::get_block_stats() const {
     return stats;
 }
 
-void BlockManager::serialize_bitmap(std::ofstream& file) const {
+void BlockManager::serialize_bitmap(std::ofstream& file, const std::vector<BlockTree>& released) const {
     if (!file.is_open()) {
         throw dfs::utils::FileSystemException("Cannot serialize block bitmap: file not open");
     }
     
     LOG_DEBUG("Serializing block bitmap to file");
     
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    // Every page is written, so fault in the ones still on disk
+    load_all_pages();
+    
+    std::vector<bool> bitmap;
+    std::unordered_map<uint32_t, uint32_t> refs;
+    if (!released.empty()) {
+        image_without(released, bitmap, refs);
+    }
+    const std::vector<bool>& image = released.empty() ? block_bitmap_ : bitmap;
+    
     // Write bitmap size
-    uint32_t bitmap_size = static_cast<uint32_t>(block_bitmap_.size());
+    uint32_t bitmap_size = static_cast<uint32_t>(image.size());
     file.write(reinterpret_cast<const char*>(&bitmap_size), sizeof(bitmap_size));
     
     // Write bitmap data
-    for (bool is_free : block_bitmap_) {
+    for (bool is_free : image) {
         file.write(reinterpret_cast<const char*>(&is_free), sizeof(bool));
     }
     
@@ -247,6 +505,8 @@ void BlockManager::deserialize_bitmap(std::ifstream& file) {
     
     LOG_DEBUG("Deserializing block bitmap from file");
     
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
     // Read bitmap size
     uint32_t bitmap_size;
     file.read(reinterpret_cast<char*>(&bitmap_size), sizeof(bitmap_size));
@@ -260,22 +520,184 @@ void BlockManager::deserialize_bitmap(std::ifstream& file) {
     }
     
     // Resize and read bitmap data
+    backing_file_.close();
+    page_loaded_.clear();
+    unloaded_pages_ = 0;
     block_bitmap_.resize(bitmap_size);
-    for (auto& is_free : block_bitmap_) {
+    for (uint32_t i = 0; i < bitmap_size; ++i) {
+        bool is_free;
         file.read(reinterpret_cast<char*>(&is_free), sizeof(bool));
         if (file.fail() || file.gcount() != sizeof(bool)) {
             throw dfs::utils::FileSystemException("Failed to deserialize block bitmap data");
         }
+        block_bitmap_[i] = is_free;
     }
     
     LOG_DEBUG("Block bitmap deserialized successfully");
 }
 
+void BlockManager::serialize_block_refs(std::ofstream& file, const std::vector<BlockTree>& released) const {
+    if (!file.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot serialize block references: file not open");
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    std::vector<bool> bitmap;
+    std::unordered_map<uint32_t, uint32_t> refs;
+    if (!released.empty()) {
+        load_all_pages();
+        image_without(released, bitmap, refs);
+    }
+    const std::unordered_map<uint32_t, uint32_t>& image = released.empty() ? extra_refs_ : refs;
+    
+    // Write entry count, then (block, extra references) pairs
+    uint32_t entry_count = static_cast<uint32_t>(image.size());
+    file.write(reinterpret_cast<const char*>(&entry_count), sizeof(entry_count));
+    
+    for (const auto& entry : image) {
+        file.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+        file.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+    }
+    
+    if (file.fail()) {
+        throw dfs::utils::FileSystemException("Failed to serialize block references");
+    }
+}
+
+void BlockManager::image_without(const std::vector<BlockTree>& released, std::vector<bool>& bitmap,
+                                 std::unordered_map<uint32_t, uint32_t>& refs) const {
+    bitmap = block_bitmap_;
+    refs = extra_refs_;
+    
+    // Same rule as deallocate_tree, applied to the copies
+    uint32_t freed = 0;
+    for (const BlockTree& tree : released) {
+        release_tree(tree.block_id, tree.depth, bitmap, refs, freed);
+    }
+}
+
+void BlockManager::deserialize_block_refs(std::ifstream& file) {
+    if (!file.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot deserialize block references: file not open");
+    }
+    
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    uint32_t entry_count;
+    file.read(reinterpret_cast<char*>(&entry_count), sizeof(entry_count));
+    
+    if (file.fail() || file.gcount() != sizeof(entry_count)) {
+        throw dfs::utils::FileSystemException("Failed to deserialize block reference count");
+    }
+    
+    extra_refs_.clear();
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        uint32_t block_id;
+        uint32_t refs;
+        file.read(reinterpret_cast<char*>(&block_id), sizeof(block_id));
+        file.read(reinterpret_cast<char*>(&refs), sizeof(refs));
+        
+        if (file.fail() || block_id >= total_blocks_) {
+            throw dfs::utils::FileSystemException("Failed to deserialize block reference entry");
+        }
+        extra_refs_[block_id] = refs;
+    }
+}
+
+void BlockManager::attach_bitmap(const std::string& image_path, std::streamoff offset) {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    LOG_DEBUG("Attaching block bitmap to " + image_path + " at offset " + std::to_string(offset));
+    
+    backing_file_.close();
+    backing_file_.clear();
+    backing_file_.open(image_path, std::ios::binary);
+    if (!backing_file_.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot attach block bitmap: failed to open " + image_path);
+    }
+    
+    // Only the size header is read now
+    uint32_t bitmap_size;
+    backing_file_.seekg(offset);
+    backing_file_.read(reinterpret_cast<char*>(&bitmap_size), sizeof(bitmap_size));
+    
+    if (backing_file_.fail() || backing_file_.gcount() != sizeof(bitmap_size)) {
+        throw dfs::utils::FileSystemException("Failed to read block bitmap size");
+    }
+    
+    if (bitmap_size != total_blocks_) {
+        throw dfs::utils::FileSystemException("Block bitmap size mismatch");
+    }
+    
+    backing_offset_ = offset;
+    page_loaded_.assign((total_blocks_ + BITMAP_PAGE_SIZE - 1) / BITMAP_PAGE_SIZE, false);
+    unloaded_pages_ = static_cast<uint32_t>(page_loaded_.size());
+    
+    if (unloaded_pages_ == 0) {
+        backing_file_.close();
+    }
+    
+    LOG_INFO("Block bitmap attached with " + std::to_string(unloaded_pages_) + " pages");
+}
+
+uint32_t BlockManager::get_loaded_page_count() const {
+    std::lock_guard<std::mutex> lock(bitmap_mutex_);
+    
+    if (page_loaded_.empty()) {
+        return (total_blocks_ + BITMAP_PAGE_SIZE - 1) / BITMAP_PAGE_SIZE;
+    }
+    return static_cast<uint32_t>(page_loaded_.size()) - unloaded_pages_;
+}
+
+void BlockManager::ensure_page(uint32_t block_id) const {
+    if (unloaded_pages_ > 0 && !page_loaded_[block_id / BITMAP_PAGE_SIZE]) {
+        load_page(block_id / BITMAP_PAGE_SIZE);
+    }
+}
+
+void BlockManager::load_page(uint32_t page_index) const {
+    uint32_t first_block = page_index * BITMAP_PAGE_SIZE;
+    uint32_t page_blocks = std::min(BITMAP_PAGE_SIZE, total_blocks_ - first_block);
+    
+    // Entries are one bool each, after the 4-byte size header
+    std::vector<char> free_flags(page_blocks);
+    backing_file_.clear();
+    backing_file_.seekg(backing_offset_ + sizeof(uint32_t) + first_block);
+    backing_file_.read(free_flags.data(), page_blocks);
+    
+    if (backing_file_.fail()) {
+        throw dfs::utils::FileSystemException("Failed to load block bitmap page " +
+                                             std::to_string(page_index));
+    }
+    
+    for (uint32_t i = 0; i < page_blocks; ++i) {
+        block_bitmap_[first_block + i] = free_flags[i] != 0;
+    }
+    
+    page_loaded_[page_index] = true;
+    if (--unloaded_pages_ == 0) {
+        backing_file_.close();
+    }
+    
+    LOG_DEBUG("Faulted in bitmap page " + std::to_string(page_index));
+}
+
+void BlockManager::load_all_pages() const {
+    for (uint32_t i = 0; unloaded_pages_ > 0 && i < page_loaded_.size(); ++i) {
+        if (!page_loaded_[i]) {
+            load_page(i);
+        }
+    }
+}
+
 void BlockManager::defragment_blocks() {
     std::lock_guard<std::mutex> lock(bitmap_mutex_);
     
     LOG_INFO("Starting block defragmentation");
     
+    load_all_pages();
+    
     // Simple defragmentation: move used blocks to the beginning
     std::vector<bool> new_bitmap(total_blocks_, true);
     uint32_t used_count = 0;
@@ -308,6 +730,7 @@ bool BlockManager::is_valid() const {
     }
     
     // Check that block 0 is reserved (not free)
+    ensure_page(0);
     if (total_blocks_ > 0 && block_bitmap_[0]) {
         LOG_ERROR("Block 0 should be reserved but is marked as free");
         return false;
@@ -319,6 +742,7 @@ bool BlockManager::is_valid() const {
 uint32_t BlockManager::find_next_free_block(uint32_t start_index) const {
     // Search from start_index to end
     for (uint32_t i = start_index; i < total_blocks_; ++i) {
+        ensure_page(i);
         if (block_bitmap_[i]) {
             return i;
         }
@@ -326,6 +750,7 @@ uint32_t BlockManager::find_next_free_block(uint32_t start_index) const {
     
     // Wrap around and search from beginning to start_index
     for (uint32_t i = 0; i < start_index; ++i) {
+        ensure_page(i);
         if (block_bitmap_[i]) {
             return i;
         }
@@ -361,8 +786,7 @@ std::vector<uint8_t> DataBlock::read_data(uint32_t offset, uint32_t size) const
     
     std::vector<uint8_t> result(data_.begin() + offset, data_.begin() + offset + size);
     
-    LOG_DEBUG("Read " + std::to_string(size) + " bytes from block " + std::to_string(block_id_) + 
-             " at offset " + std::to_string(offset));
+    LOG_DEBUGF("Read {} bytes from block {} at offset {}", size, block_id_, offset);
     
     return result;
 }
@@ -383,8 +807,7 @@ bool DataBlock::write_data(const std::vector<uint8_t>& data, uint32_t offset) {
     // Copy data to block
     std::copy(data.begin(), data.end(), data_.begin() + offset);
     
-    LOG_DEBUG("Wrote " + std::to_string(data.size()) + " bytes to block " + std::to_string(block_id_) + 
-             " at offset " + std::to_string(offset));
+    LOG_DEBUGF("Wrote {} bytes to block {} at offset {}", data.size(), block_id_, offset);
     
     return true;
 }
@@ -0,0 +1,267 @@
+#include "core/dedup_engine.h"
+#include "utils/checksum.h"
+#include "utils/logger.h"
+#include "utils/exceptions.h"
+
+namespace dfs {
+namespace core {
+
+// DedupConfig implementation
+DedupEngine::DedupConfig::DedupConfig(Mode mode, bool verify_matches, size_t max_index_entries)
+    : mode(mode), verify_matches(verify_matches), max_index_entries(max_index_entries) {}
+
+// DedupEngine implementation
+DedupEngine::DedupEngine(BlockManager& block_manager, const DedupConfig& config)
+    : block_manager_(block_manager), config_(config), blocks_written_(0),
+      duplicate_blocks_(0), bytes_saved_(0), verify_mismatches_(0) {
+    
+    LOG_INFO("Creating DedupEngine in " +
+             std::string(config.mode == Mode::INLINE ? "inline" : "post-process") + " mode");
+}
+
+DedupEngine::Fingerprint DedupEngine::fingerprint(const void* data, size_t size) {
+    // One pass over the block for both halves
+    dfs::utils::Checksum::Hash128 hash = dfs::utils::Checksum::xxh3_128(data, size);
+    
+    Fingerprint result;
+    result.high = hash.high;
+    result.low = hash.low;
+    return result;
+}
+
+uint32_t DedupEngine::write_block(const std::vector<uint8_t>& data, bool& is_duplicate,
+                                  const BlockReader& reader) {
+    is_duplicate = false;
+    
+    if (config_.mode == Mode::POST_PROCESS) {
+        uint32_t block_id = block_manager_.allocate_block();
+        record_written_block(block_id);
+        
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        blocks_written_++;
+        return block_id;
+    }
+    
+    if (config_.verify_matches && !reader) {
+        throw dfs::utils::ConfigurationException("dedup_reader", "verified inline dedup needs a reader");
+    }
+    
+    // Hash outside the lock, it is the expensive part
+    Fingerprint block_fingerprint = fingerprint(data.data(), data.size());
+    uint32_t candidate = 0;
+    bool found = false;
+    
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        blocks_written_++;
+        
+        // Pin the indexed block so it cannot be freed while it is compared
+        auto it = index_.find(block_fingerprint);
+        if (it != index_.end()) {
+            candidate = it->second;
+            block_manager_.add_block_ref(candidate);
+            found = true;
+        }
+    }
+    
+    if (found) {
+        bool same = matches(candidate, data, reader);
+        
+        std::unique_lock<std::mutex> lock(index_mutex_);
+        // An overwrite unindexes the block first, so a block still indexed
+        // under this fingerprint has not changed since it was read
+        if (same && still_indexed(block_fingerprint, candidate)) {
+            duplicate_blocks_++;
+            bytes_saved_ += block_manager_.get_block_size();
+            is_duplicate = true;
+            
+            LOG_DEBUG("Deduplicated write into block " + std::to_string(candidate));
+            return candidate;
+        }
+        lock.unlock();
+        
+        release_block(candidate);
+    }
+    
+    uint32_t block_id = block_manager_.allocate_block();
+    if (!found) {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        uncommitted_blocks_[block_id] = block_fingerprint;
+    }
+    
+    return block_id;
+}
+
+void DedupEngine::commit_block(uint32_t block_id) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    
+    auto it = uncommitted_blocks_.find(block_id);
+    if (it == uncommitted_blocks_.end()) {
+        return;
+    }
+    
+    // Another writer may have committed the same content first
+    if (index_.count(it->second) == 0) {
+        index_block(it->second, block_id);
+    }
+    uncommitted_blocks_.erase(it);
+}
+
+void DedupEngine::record_written_block(uint32_t block_id) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_blocks_.push_back(block_id);
+}
+
+size_t DedupEngine::process_pending(const BlockReader& reader, const RemapCallback& remap,
+                                    size_t max_blocks) {
+    if (!reader || !remap) {
+        throw dfs::utils::ConfigurationException("dedup_reader", "post-process needs a reader and remap callback");
+    }
+    
+    std::vector<uint32_t> batch;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        while (!pending_blocks_.empty() && batch.size() < max_blocks) {
+            batch.push_back(pending_blocks_.front());
+            pending_blocks_.pop_front();
+        }
+    }
+    
+    size_t freed = 0;
+    
+    for (uint32_t block_id : batch) {
+        // Freed or rewritten since it was recorded
+        if (block_manager_.get_block_ref_count(block_id) == 0) {
+            continue;
+        }
+        
+        std::vector<uint8_t> data = reader(block_id);
+        Fingerprint block_fingerprint = fingerprint(data.data(), data.size());
+        uint32_t canonical = 0;
+        
+        {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            
+            if (block_fingerprints_.count(block_id) > 0) {
+                continue;
+            }
+            
+            auto it = index_.find(block_fingerprint);
+            if (it == index_.end()) {
+                index_block(block_fingerprint, block_id);
+                continue;
+            }
+            
+            // Pin the indexed block while it is compared and the owner repointed
+            canonical = it->second;
+            block_manager_.add_block_ref(canonical);
+        }
+        
+        bool same = matches(canonical, data, reader);
+        if (same) {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            same = still_indexed(block_fingerprint, canonical);
+        }
+        
+        if (same && remap(block_id, canonical)) {
+            release_block(block_id);
+            freed++;
+            
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            duplicate_blocks_++;
+            bytes_saved_ += block_manager_.get_block_size();
+        } else {
+            release_block(canonical);
+        }
+    }
+    
+    if (freed > 0) {
+        LOG_INFO("Post-process dedup folded " + std::to_string(freed) + " of " +
+                 std::to_string(batch.size()) + " blocks");
+    }
+    
+    return freed;
+}
+
+void DedupEngine::prepare_overwrite(uint32_t block_id) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    unindex_block(block_id);
+    uncommitted_blocks_.erase(block_id);
+}
+
+void DedupEngine::release_block(uint32_t block_id) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    
+    block_manager_.deallocate_block(block_id);
+    if (block_manager_.get_block_ref_count(block_id) == 0) {
+        unindex_block(block_id);
+        uncommitted_blocks_.erase(block_id);
+    }
+}
+
+DedupEngine::DedupStats DedupEngine::get_stats() const {
+    DedupStats stats;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        stats.blocks_written = blocks_written_;
+        stats.duplicate_blocks = duplicate_blocks_;
+        stats.bytes_saved = bytes_saved_;
+        stats.verify_mismatches = verify_mismatches_;
+        stats.index_entries = index_.size();
+    }
+    
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    stats.pending_blocks = pending_blocks_.size();
+    
+    return stats;
+}
+
+DedupEngine::Mode DedupEngine::get_mode() const {
+    return config_.mode;
+}
+
+void DedupEngine::index_block(const Fingerprint& block_fingerprint, uint32_t block_id) {
+    if (index_.size() >= config_.max_index_entries) {
+        return;
+    }
+    
+    index_[block_fingerprint] = block_id;
+    block_fingerprints_[block_id] = block_fingerprint;
+}
+
+void DedupEngine::unindex_block(uint32_t block_id) {
+    auto it = block_fingerprints_.find(block_id);
+    if (it == block_fingerprints_.end()) {
+        return;
+    }
+    
+    auto index_it = index_.find(it->second);
+    if (index_it != index_.end() && index_it->second == block_id) {
+        index_.erase(index_it);
+    }
+    block_fingerprints_.erase(it);
+}
+
+bool DedupEngine::matches(uint32_t block_id, const std::vector<uint8_t>& data, const BlockReader& reader) {
+    // With verification off the 128-bit fingerprint is trusted
+    if (!config_.verify_matches) {
+        return true;
+    }
+    
+    if (reader(block_id) == data) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    verify_mismatches_++;
+    LOG_WARN("Fingerprint collision on block " + std::to_string(block_id));
+    return false;
+}
+
+bool DedupEngine::still_indexed(const Fingerprint& block_fingerprint, uint32_t block_id) const {
+    auto it = index_.find(block_fingerprint);
+    return it != index_.end() && it->second == block_id;
+}
+
+} // namespace core
+} // namespace dfs
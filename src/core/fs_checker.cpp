@@ -0,0 +1,457 @@
+#include "core/fs_checker.h"
+#include "core/superblock.h"
+#include "utils/thread_pool.h"
+#include "utils/parallel.h"
+#include "utils/logger.h"
+#include "utils/exceptions.h"
+#include <algorithm>
+#include <sstream>
+#include <exception>
+
+namespace dfs {
+namespace core {
+
+// CheckOptions implementation
+FileSystemChecker::CheckOptions::CheckOptions(bool repair, uint32_t partition_size)
+    : repair(repair), partition_size(partition_size) {}
+
+// CheckReport implementation
+FileSystemChecker::CheckReport::CheckReport()
+    : inodes_checked(0), blocks_checked(0), root_valid(false), connectivity_checked(false),
+      repaired(0), duration(0) {}
+
+bool FileSystemChecker::CheckReport::is_clean() const {
+    return root_valid && invalid_inodes.empty() && out_of_range_pointers.empty() &&
+           duplicate_blocks.empty() && unmarked_blocks.empty() && leaked_blocks.empty() &&
+           unreachable_inodes.empty() && link_count_mismatches.empty();
+}
+
+std::string FileSystemChecker::CheckReport::to_string() const {
+    std::ostringstream oss;
+    
+    oss << "File System Check Report:\n";
+    oss << "  Inodes Checked: " << inodes_checked << "\n";
+    oss << "  Blocks Checked: " << blocks_checked << "\n";
+    oss << "  Root Directory: " << (root_valid ? "ok" : "invalid") << "\n";
+    oss << "  Invalid Inodes: " << invalid_inodes.size() << "\n";
+    oss << "  Out-of-range Pointers: " << out_of_range_pointers.size() << "\n";
+    oss << "  Duplicate Blocks: " << duplicate_blocks.size() << "\n";
+    oss << "  Used Blocks Marked Free: " << unmarked_blocks.size() << "\n";
+    oss << "  Leaked Blocks: " << leaked_blocks.size() << "\n";
+    if (connectivity_checked) {
+        oss << "  Unreachable Inodes: " << unreachable_inodes.size() << "\n";
+        oss << "  Link Count Mismatches: " << link_count_mismatches.size() << "\n";
+    } else {
+        oss << "  Connectivity: not checked\n";
+    }
+    oss << "  Repaired: " << repaired << "\n";
+    oss << "  Duration: " << duration.count() << "ms\n";
+    
+    return oss.str();
+}
+
+// FileSystemChecker implementation
+FileSystemChecker::FileSystemChecker(InodeTable& inode_table, BlockManager& block_manager,
+                                     utils::ThreadPool& thread_pool)
+    : inode_table_(inode_table), block_manager_(block_manager), view_(nullptr),
+      thread_pool_(thread_pool), unresolved_indirect_(false) {}
+
+void FileSystemChecker::add_snapshot(std::shared_ptr<const InodeTable> snapshot) {
+    snapshots_.push_back(std::move(snapshot));
+}
+
+FileSystemChecker::CheckReport FileSystemChecker::run(const CheckOptions& options) {
+    if (options.partition_size == 0) {
+        throw dfs::utils::ConfigurationException("partition_size", "0");
+    }
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    LOG_INFO("Starting file system check (" + std::string(options.repair ? "repair" : "read-only") + ")");
+    
+    CheckReport report;
+    
+    // Read-only checks see one point-in-time table, so cross-partition
+    // checks cannot race with writers; repair edits the live table instead
+    std::shared_ptr<const InodeTable> view;
+    if (!options.repair) {
+        view = inode_table_.view();
+        view_ = view.get();
+    } else {
+        view_ = &inode_table_;
+    }
+    std::vector<bool> bitmap = block_manager_.copy_bitmap();
+    
+    uint32_t total_blocks = block_manager_.get_total_block_count();
+    uint32_t total_inodes = view_->get_total_inode_count();
+    
+    block_owner_ = std::vector<std::atomic<uint32_t>>(total_blocks);
+    references_ = std::vector<std::atomic<uint32_t>>(total_inodes);
+    unresolved_indirect_ = false;
+    
+    // Superblock copies belong to the file system itself
+    for (uint32_t block_id : SuperBlock::copy_block_numbers(total_blocks, block_manager_.get_block_size())) {
+        block_owner_[block_id].store(METADATA_OWNER, std::memory_order_relaxed);
+    }
+    
+    try {
+        check_inodes(options, report);
+        claim_snapshot_blocks(options);
+        check_blocks(options, bitmap, report);
+        check_connectivity(options, report);
+    } catch (...) {
+        view_ = nullptr;
+        throw;
+    }
+    
+    // Keep the report stable regardless of partition completion order
+    for (auto* issues : {&report.invalid_inodes, &report.out_of_range_pointers, &report.duplicate_blocks,
+                         &report.unmarked_blocks, &report.leaked_blocks, &report.unreachable_inodes,
+                         &report.link_count_mismatches}) {
+        std::sort(issues->begin(), issues->end());
+    }
+    
+    block_owner_.clear();
+    references_.clear();
+    
+    view_ = nullptr;
+    
+    report.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    
+    LOG_INFO("File system check completed in " + std::to_string(report.duration.count()) + "ms: " +
+             (report.is_clean() ? "clean" : "issues found"));
+    
+    return report;
+}
+
+void FileSystemChecker::check_inodes(const CheckOptions& options, CheckReport& report) {
+    uint32_t total_inodes = view_->get_total_inode_count();
+    
+    run_partitioned(Phase::INODES, total_inodes, options.partition_size, options,
+                    [this, &options, &report](uint64_t first, uint64_t count) {
+        std::vector<Inode> inodes;
+        std::vector<bool> free_flags;
+        view_->copy_range(static_cast<uint32_t>(first), static_cast<uint32_t>(count),
+                                inodes, free_flags);
+        
+        uint32_t checked = 0;
+        std::vector<uint32_t> invalid;
+        std::vector<uint32_t> out_of_range;
+        std::vector<uint32_t> duplicates;
+        
+        for (size_t i = 0; i < inodes.size(); ++i) {
+            uint32_t inode_num = static_cast<uint32_t>(first + i);
+            if (inode_num == 0 || free_flags[i]) {
+                continue;
+            }
+            
+            checked++;
+            const Inode& inode = inodes[i];
+            
+            if (!inode.is_valid()) {
+                invalid.push_back(inode_num);
+            }
+            
+            bool bad_pointer = false;
+            
+            walk_blocks(inode, options, [&](uint32_t block_id, bool via_shared) {
+                ClaimResult result = claim_block(block_id, inode_num, via_shared);
+                if (result == ClaimResult::OUT_OF_RANGE) {
+                    bad_pointer = true;
+                    return false;
+                }
+                if (result == ClaimResult::DUPLICATE) {
+                    duplicates.push_back(block_id);
+                    return false;
+                }
+                return true;
+            });
+            
+            if (bad_pointer) {
+                out_of_range.push_back(inode_num);
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(report_mutex_);
+        report.inodes_checked += checked;
+        report.invalid_inodes.insert(report.invalid_inodes.end(), invalid.begin(), invalid.end());
+        report.out_of_range_pointers.insert(report.out_of_range_pointers.end(),
+                                            out_of_range.begin(), out_of_range.end());
+        report.duplicate_blocks.insert(report.duplicate_blocks.end(), duplicates.begin(), duplicates.end());
+    });
+    
+    if (options.repair) {
+        uint32_t total_blocks = block_manager_.get_total_block_count();
+        
+        for (uint32_t inode_num : report.out_of_range_pointers) {
+            Inode* inode = inode_table_.get_inode(inode_num);
+            
+            for (uint32_t& block_id : inode->direct_blocks) {
+                if (block_id >= total_blocks) {
+                    block_id = 0;
+                }
+            }
+            for (uint32_t* block_id : {&inode->indirect_block, &inode->double_indirect, &inode->triple_indirect}) {
+                if (*block_id >= total_blocks) {
+                    *block_id = 0;
+                }
+            }
+            
+            inode->update_checksum();
+            report.repaired++;
+            LOG_WARN("Cleared out-of-range block pointers in inode " + std::to_string(inode_num));
+        }
+    }
+}
+
+void FileSystemChecker::claim_snapshot_blocks(const CheckOptions& options) {
+    for (const auto& snapshot : snapshots_) {
+        run_partitioned(Phase::BLOCKS, snapshot->get_total_inode_count(), options.partition_size, options,
+                        [this, &options, &snapshot](uint64_t first, uint64_t count) {
+            std::vector<Inode> inodes;
+            std::vector<bool> free_flags;
+            snapshot->copy_range(static_cast<uint32_t>(first), static_cast<uint32_t>(count),
+                                 inodes, free_flags);
+            
+            // Only fills in blocks no live inode owns, so nothing is reported here.
+            // A block someone already owns had its indirect children claimed
+            // with it, so the walk only descends through newly claimed blocks.
+            for (size_t i = 0; i < inodes.size(); ++i) {
+                if (first + i == 0 || free_flags[i]) {
+                    continue;
+                }
+                walk_blocks(inodes[i], options, [this](uint32_t block_id, bool) {
+                    if (block_id >= block_owner_.size()) {
+                        return false;
+                    }
+                    uint32_t expected = 0;
+                    return block_owner_[block_id].compare_exchange_strong(expected, SNAPSHOT_OWNER,
+                                                                          std::memory_order_relaxed);
+                });
+            }
+        });
+    }
+}
+
+void FileSystemChecker::check_blocks(const CheckOptions& options, const std::vector<bool>& bitmap,
+                                     CheckReport& report) {
+    run_partitioned(Phase::BLOCKS, bitmap.size(), options.partition_size, options,
+                    [this, &bitmap, &report](uint64_t first, uint64_t count) {
+        std::vector<uint32_t> unmarked;
+        std::vector<uint32_t> leaked;
+        
+        for (uint64_t block_id = first; block_id < first + count; ++block_id) {
+            bool owned = block_owner_[block_id].load(std::memory_order_relaxed) != 0;
+            bool is_free = bitmap[block_id];
+            
+            if (owned && is_free) {
+                unmarked.push_back(static_cast<uint32_t>(block_id));
+            } else if (!owned && !is_free) {
+                leaked.push_back(static_cast<uint32_t>(block_id));
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(report_mutex_);
+        report.blocks_checked += static_cast<uint32_t>(count);
+        report.unmarked_blocks.insert(report.unmarked_blocks.end(), unmarked.begin(), unmarked.end());
+        report.leaked_blocks.insert(report.leaked_blocks.end(), leaked.begin(), leaked.end());
+    });
+    
+    if (options.repair) {
+        for (uint32_t block_id : report.unmarked_blocks) {
+            block_manager_.mark_block_used(block_id);
+            report.repaired++;
+        }
+        
+        if (unresolved_indirect_) {
+            LOG_WARN("Not freeing " + std::to_string(report.leaked_blocks.size()) +
+                     " leaked blocks: indirect blocks could not be expanded");
+        } else {
+            for (uint32_t block_id : report.leaked_blocks) {
+                block_manager_.mark_block_free(block_id);
+                report.repaired++;
+            }
+        }
+    }
+}
+
+void FileSystemChecker::check_connectivity(const CheckOptions& options, CheckReport& report) {
+    const uint32_t root_inode = 1;
+    
+    std::vector<Inode> root;
+    std::vector<bool> root_free;
+    view_->copy_range(root_inode, 1, root, root_free);
+    report.root_valid = !root.empty() && !root_free[0] && root[0].is_directory();
+    
+    if (!report.root_valid) {
+        LOG_ERROR("Root inode is missing or not a directory");
+        return;
+    }
+    
+    if (!options.directory_reader) {
+        LOG_DEBUG("Skipping connectivity phase: no directory reader supplied");
+        return;
+    }
+    
+    report.connectivity_checked = true;
+    
+    // Level-synchronous walk from the root, each level split across the pool
+    std::vector<uint32_t> frontier = {root_inode};
+    references_[root_inode].store(1, std::memory_order_relaxed);
+    
+    while (!frontier.empty()) {
+        std::vector<uint32_t> next_frontier;
+        std::mutex frontier_mutex;
+        uint32_t directories_per_task = std::max<uint32_t>(1, options.partition_size / 64);
+        
+        run_partitioned(Phase::CONNECTIVITY, frontier.size(), directories_per_task, options,
+                        [this, &options, &frontier, &next_frontier, &frontier_mutex](uint64_t first, uint64_t count) {
+            std::vector<uint32_t> discovered;
+            
+            for (uint64_t i = first; i < first + count; ++i) {
+                for (uint32_t child : options.directory_reader(frontier[i])) {
+                    if (child == 0 || child >= references_.size()) {
+                        continue;
+                    }
+                    
+                    // Only the first reference descends, so each directory is expanded once
+                    if (references_[child].fetch_add(1, std::memory_order_relaxed) != 0) {
+                        continue;
+                    }
+                    
+                    std::vector<Inode> inode;
+                    std::vector<bool> is_free;
+                    view_->copy_range(child, 1, inode, is_free);
+                    if (!inode.empty() && !is_free[0] && inode[0].is_directory()) {
+                        discovered.push_back(child);
+                    }
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock(frontier_mutex);
+            next_frontier.insert(next_frontier.end(), discovered.begin(), discovered.end());
+        });
+        
+        frontier = std::move(next_frontier);
+    }
+    
+    uint32_t total_inodes = view_->get_total_inode_count();
+    
+    run_partitioned(Phase::CONNECTIVITY, total_inodes, options.partition_size, options,
+                    [this, &report, root_inode](uint64_t first, uint64_t count) {
+        std::vector<Inode> inodes;
+        std::vector<bool> free_flags;
+        view_->copy_range(static_cast<uint32_t>(first), static_cast<uint32_t>(count),
+                                inodes, free_flags);
+        
+        std::vector<uint32_t> unreachable;
+        std::vector<uint32_t> mismatched;
+        
+        for (size_t i = 0; i < inodes.size(); ++i) {
+            uint32_t inode_num = static_cast<uint32_t>(first + i);
+            if (inode_num == 0 || inode_num == root_inode || free_flags[i]) {
+                continue;
+            }
+            
+            uint32_t refs = references_[inode_num].load(std::memory_order_relaxed);
+            if (refs == 0) {
+                unreachable.push_back(inode_num);
+            } else if (!inodes[i].is_directory() && refs != inodes[i].link_count) {
+                mismatched.push_back(inode_num);
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(report_mutex_);
+        report.unreachable_inodes.insert(report.unreachable_inodes.end(), unreachable.begin(), unreachable.end());
+        report.link_count_mismatches.insert(report.link_count_mismatches.end(), mismatched.begin(), mismatched.end());
+    });
+}
+
+void FileSystemChecker::walk_blocks(const Inode& inode, const CheckOptions& options,
+                                    const std::function<bool(uint32_t, bool)>& visit) {
+    // Fast symlinks keep their target in the pointer fields
+    if (inode.is_fast_symlink()) {
+        return;
+    }
+    
+    // Visit a block and, for indirect blocks, the blocks it points to. The
+    // children of a shared indirect block are shared with it, whatever their
+    // own reference counts (see BlockManager::cow_block)
+    std::function<void(uint32_t, int, bool)> walk_tree = [&](uint32_t block_id, int depth, bool via_shared) {
+        if (!visit(block_id, via_shared) || depth == 0) {
+            return;
+        }
+        if (!options.indirect_reader) {
+            unresolved_indirect_ = true;
+            return;
+        }
+        bool shared = via_shared || block_manager_.get_block_ref_count(block_id) > 1;
+        for (uint32_t child : options.indirect_reader(block_id)) {
+            if (child != 0) {
+                walk_tree(child, depth - 1, shared);
+            }
+        }
+    };
+    
+    for (uint32_t block_id : inode.direct_blocks) {
+        if (block_id != 0) {
+            walk_tree(block_id, 0, false);
+        }
+    }
+    if (inode.indirect_block != 0) {
+        walk_tree(inode.indirect_block, 1, false);
+    }
+    if (inode.double_indirect != 0) {
+        walk_tree(inode.double_indirect, 2, false);
+    }
+    if (inode.triple_indirect != 0) {
+        walk_tree(inode.triple_indirect, 3, false);
+    }
+}
+
+FileSystemChecker::ClaimResult FileSystemChecker::claim_block(uint32_t block_id, uint32_t inode_num,
+                                                              bool via_shared) {
+    if (block_id >= block_owner_.size()) {
+        return ClaimResult::OUT_OF_RANGE;
+    }
+    
+    uint32_t expected = 0;
+    if (block_owner_[block_id].compare_exchange_strong(expected, inode_num, std::memory_order_relaxed)) {
+        return ClaimResult::CLAIMED;
+    }
+    
+    // Shared with a snapshot or a clone, directly or through an indirect block
+    if (expected != METADATA_OWNER && (via_shared || block_manager_.get_block_ref_count(block_id) > 1)) {
+        return ClaimResult::CLAIMED;
+    }
+    
+    return ClaimResult::DUPLICATE;
+}
+
+void FileSystemChecker::run_partitioned(Phase phase, uint64_t total, uint32_t partition_size,
+                                        const CheckOptions& options,
+                                        const std::function<void(uint64_t, uint64_t)>& fn) {
+    std::atomic<uint64_t> completed(0);
+    
+    // The calling thread checks partitions alongside the pool's workers
+    utils::parallel_for<uint64_t>(thread_pool_, 0, total, partition_size,
+                                  [this, &fn, &options, &completed, phase, total](uint64_t first, uint64_t last) {
+        fn(first, last - first);
+        uint64_t done = completed.fetch_add(last - first) + (last - first);
+        report_progress(options, phase, done, total);
+    });
+}
+
+void FileSystemChecker::report_progress(const CheckOptions& options, Phase phase,
+                                        uint64_t completed, uint64_t total) {
+    if (!options.progress_callback) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    options.progress_callback(CheckProgress{phase, completed, total});
+}
+
+} // namespace core
+} // namespace dfs
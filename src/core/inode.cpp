@@ -1,4 +1,6 @@
 #include "core/inode.h"
+#include "core/superblock.h"
+#include "core/block_manager.h"
 #include "utils/logger.h"
 #include "utils/exceptions.h"
 #include <cstring>
@@ -6,10 +8,35 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <unordered_set>
 
 namespace dfs {
 namespace core {
 
+namespace {
+
+// Root blocks of an inode with the indirect levels below each
+void append_block_trees(const Inode& inode, std::vector<BlockTree>& trees) {
+    if (inode.is_fast_symlink()) {
+        return;
+    }
+    
+    for (uint32_t block_id : inode.direct_blocks) {
+        if (block_id != 0) {
+            trees.push_back({block_id, 0});
+        }
+    }
+    
+    const uint32_t roots[] = {inode.indirect_block, inode.double_indirect, inode.triple_indirect};
+    for (uint32_t level = 0; level < 3; ++level) {
+        if (roots[level] != 0) {
+            trees.push_back({roots[level], level + 1});
+        }
+    }
+}
+
+} // namespace
+
 Inode::Inode() {
     // Initialize with default values
     mode = 0;
@@ -81,6 +108,62 @@ bool Inode::is_symlink() const {
     return (mode & S_IFMT) == S_IFLNK;
 }
 
+bool Inode::is_fast_symlink() const {
+    return is_symlink() && blocks == 0;
+}
+
+bool Inode::set_fast_symlink_target(const std::string& target) {
+    if (target.size() > FAST_SYMLINK_MAX) {
+        return false;
+    }
+    
+    // The target spans the direct pointers and the three indirect roots
+    uint8_t buffer[FAST_SYMLINK_MAX] = {};
+    std::memcpy(buffer, target.data(), target.size());
+    std::memcpy(direct_blocks, buffer, sizeof(direct_blocks));
+    std::memcpy(&indirect_block, buffer + sizeof(direct_blocks), sizeof(uint32_t));
+    std::memcpy(&double_indirect, buffer + sizeof(direct_blocks) + sizeof(uint32_t), sizeof(uint32_t));
+    std::memcpy(&triple_indirect, buffer + sizeof(direct_blocks) + 2 * sizeof(uint32_t), sizeof(uint32_t));
+    
+    size = target.size();
+    blocks = 0;
+    return true;
+}
+
+std::string Inode::get_fast_symlink_target() const {
+    uint8_t buffer[FAST_SYMLINK_MAX];
+    std::memcpy(buffer, direct_blocks, sizeof(direct_blocks));
+    std::memcpy(buffer + sizeof(direct_blocks), &indirect_block, sizeof(uint32_t));
+    std::memcpy(buffer + sizeof(direct_blocks) + sizeof(uint32_t), &double_indirect, sizeof(uint32_t));
+    std::memcpy(buffer + sizeof(direct_blocks) + 2 * sizeof(uint32_t), &triple_indirect, sizeof(uint32_t));
+    
+    size_t length = std::min<size_t>(size, FAST_SYMLINK_MAX);
+    return std::string(reinterpret_cast<const char*>(buffer), length);
+}
+
+std::vector<uint32_t> Inode::get_block_pointers() const {
+    std::vector<uint32_t> pointers;
+    
+    // Fast symlink targets occupy the pointer fields
+    if (is_fast_symlink()) {
+        return pointers;
+    }
+    
+    for (uint32_t block : direct_blocks) {
+        if (block != 0) {
+            pointers.push_back(block);
+        }
+    }
+    
+    for (uint32_t block : {indirect_block, double_indirect, triple_indirect}) {
+        if (block != 0) {
+            pointers.push_back(block);
+        }
+    }
+    
+    return pointers;
+}
+
 std::string Inode::get_permissions_string() const {
     std::string perms(10, '-');
     
@@ -216,6 +299,11 @@ std::string Inode::to_string() const {
     oss << "  Change Time: " << ctime << "\n";
     oss << "  Checksum: 0x" << std::hex << std::setw(8) << std::setfill('0') << checksum << std::dec << "\n";
     
+    if (is_fast_symlink()) {
+        oss << "  Symlink Target: " << get_fast_symlink_target() << "\n";
+        return oss.str();
+    }
+    
     // Show block pointers
     oss << "  Direct Blocks: ";
     for (int i = 0; i < 12; ++i) {
@@ -240,35 +328,201 @@ std::string Inode::to_string() const {
 
 // InodeTable implementation
 InodeTable::InodeTable(uint32_t max_inodes) 
-    : next_free_inode_(1) {
+    : inode_count_(0), next_free_inode_(1), counters_(nullptr), block_manager_(nullptr) {
     
     LOG_INFO("Creating InodeTable with " + std::to_string(max_inodes) + " inodes");
     
-    // Initialize inode array
-    inodes_.resize(max_inodes);
-    
-    // Initialize free inode bitmap
-    free_inodes_.resize(max_inodes, true);
+    // Initialize resident inode chunks, all inodes start free
+    reset_chunks(max_inodes);
     
     // Reserve inode 0 (invalid) and inode 1 (root)
     if (max_inodes > 0) {
-        free_inodes_[0] = false; // Inode 0 is invalid
+        chunks_[0]->free_inodes[0] = false; // Inode 0 is invalid
     }
     if (max_inodes > 1) {
-        free_inodes_[1] = false; // Inode 1 is reserved for root
+        chunks_[0]->free_inodes[1] = false; // Inode 1 is reserved for root
     }
     
     LOG_INFO("InodeTable created successfully");
 }
 
-uint32_t InodeTable::allocate_inode() {
+void InodeTable::set_counters(SuperBlockCounters* counters) {
     std::lock_guard<std::mutex> lock(table_mutex_);
+    counters_ = counters;
+}
+
+void InodeTable::set_block_manager(BlockManager* block_manager) {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    block_manager_ = block_manager;
+}
+
+void InodeTable::reset_chunks(uint32_t inode_count) {
+    inode_count_ = inode_count;
+    backing_.reset();
+    
+    uint32_t chunk_count = (inode_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks_.clear();
+    chunks_.resize(chunk_count);
+    
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        uint32_t chunk_inodes = std::min(CHUNK_SIZE, inode_count - i * CHUNK_SIZE);
+        chunks_[i] = std::make_shared<InodeChunk>();
+        chunks_[i]->inodes.resize(chunk_inodes);
+        chunks_[i]->free_inodes.resize(chunk_inodes, true);
+    }
+}
+
+InodeTable::InodeChunk& InodeTable::chunk_for(uint32_t inode_num) const {
+    uint32_t chunk_index = inode_num / CHUNK_SIZE;
+    InodeChunk& chunk = *chunks_[chunk_index];
+    if (!chunk.loaded.load(std::memory_order_acquire)) {
+        load_chunk(chunk, chunk_index);
+    }
+    return chunk;
+}
+
+InodeTable::InodeChunk& InodeTable::writable_chunk(uint32_t inode_num) {
+    uint32_t chunk_index = inode_num / CHUNK_SIZE;
+    InodeChunk& current = chunk_for(inode_num);
     
+    // Only this table holds the chunk, so it can be changed in place
+    if (chunks_[chunk_index].use_count() == 1) {
+        return current;
+    }
+    
+    auto copy = std::make_shared<InodeChunk>();
+    copy->inodes = current.inodes;
+    copy->free_inodes = current.free_inodes;
+    
+    // While a snapshot still owns the old chunk both point at the same
+    // blocks. Otherwise only read-only views hold it, and the copy takes
+    // over this table's references.
+    if (current.owners.fetch_sub(1, std::memory_order_acq_rel) > 1) {
+        try {
+            add_chunk_block_refs(*copy);
+        } catch (...) {
+            current.owners.fetch_add(1, std::memory_order_relaxed);
+            throw;
+        }
+    }
+    chunks_[chunk_index] = std::move(copy);
+    
+    LOG_DEBUG("Copied shared inode chunk " + std::to_string(chunk_index));
+    return *chunks_[chunk_index];
+}
+
+void InodeTable::add_chunk_block_refs(const InodeChunk& chunk) {
+    if (!block_manager_) {
+        throw dfs::utils::FileSystemException("Cannot copy shared inode chunk: no block manager set");
+    }
+    
+    std::vector<uint32_t> block_ids;
+    for (size_t i = 0; i < chunk.inodes.size(); ++i) {
+        if (chunk.free_inodes[i]) {
+            continue;
+        }
+        std::vector<uint32_t> inode_blocks = chunk.inodes[i].get_block_pointers();
+        block_ids.insert(block_ids.end(), inode_blocks.begin(), inode_blocks.end());
+    }
+    
+    block_manager_->share_blocks(block_ids);
+}
+
+void InodeTable::release_chunk_blocks(const InodeChunk& chunk) {
+    std::vector<BlockTree> trees;
+    for (size_t i = 0; i < chunk.inodes.size(); ++i) {
+        if (!chunk.free_inodes[i]) {
+            append_block_trees(chunk.inodes[i], trees);
+        }
+    }
+    
+    for (const BlockTree& tree : trees) {
+        block_manager_->deallocate_tree(tree.block_id, tree.depth);
+    }
+}
+
+void InodeTable::load_chunk(InodeChunk& chunk, uint32_t chunk_index) const {
+    std::lock_guard<std::mutex> lock(backing_->mutex);
+    
+    // Another table sharing the chunk may have read it first
+    if (chunk.loaded.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    std::ifstream& file = backing_->file;
+    if (!file.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot load inode chunk: no backing image attached");
+    }
+    
+    uint32_t first_inode = chunk_index * CHUNK_SIZE;
+    uint32_t chunk_inodes = std::min(CHUNK_SIZE, inode_count_ - first_inode);
+    
+    std::vector<Inode> inodes(chunk_inodes);
+    
+    // Inodes follow the 4-byte count header
+    std::streamoff inode_offset = backing_->offset + sizeof(uint32_t) +
+        static_cast<std::streamoff>(first_inode) * sizeof(Inode);
+    file.clear();
+    file.seekg(inode_offset);
+    file.read(reinterpret_cast<char*>(inodes.data()),
+              static_cast<std::streamsize>(chunk_inodes) * sizeof(Inode));
+    
+    if (file.fail()) {
+        throw dfs::utils::FileSystemException("Failed to load InodeTable chunk " +
+                                             std::to_string(chunk_index));
+    }
+    
+    // The free bitmap (one bool per inode) follows all inodes
+    std::vector<char> free_flags(chunk_inodes);
+    std::streamoff bitmap_offset = backing_->offset + sizeof(uint32_t) +
+        static_cast<std::streamoff>(inode_count_) * sizeof(Inode) + first_inode;
+    file.seekg(bitmap_offset);
+    file.read(free_flags.data(), chunk_inodes);
+    
+    if (file.fail()) {
+        throw dfs::utils::FileSystemException("Failed to load InodeTable bitmap chunk " +
+                                             std::to_string(chunk_index));
+    }
+    
+    chunk.inodes = std::move(inodes);
+    chunk.free_inodes.resize(chunk_inodes);
+    for (uint32_t i = 0; i < chunk_inodes; ++i) {
+        chunk.free_inodes[i] = free_flags[i] != 0;
+    }
+    chunk.loaded.store(true, std::memory_order_release);
+    
+    if (--backing_->unloaded_chunks == 0) {
+        file.close();
+    }
+    
+    LOG_DEBUG("Faulted in inode chunk " + std::to_string(chunk_index));
+}
+
+void InodeTable::load_all_chunks() const {
+    if (!backing_) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < chunks_.size(); ++i) {
+        chunk_for(i * CHUNK_SIZE);
+    }
+}
+
+uint32_t InodeTable::allocate_inode() {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    return allocate_inode_locked();
+}
+
+uint32_t InodeTable::allocate_inode_locked() {
     // Find next free inode
-    for (uint32_t i = next_free_inode_; i < free_inodes_.size(); ++i) {
-        if (free_inodes_[i]) {
-            free_inodes_[i] = false;
-            next_free_inode_ = (i + 1) % free_inodes_.size();
+    for (uint32_t i = next_free_inode_; i < inode_count_; ++i) {
+        if (chunk_for(i).free_inodes[i % CHUNK_SIZE]) {
+            writable_chunk(i).free_inodes[i % CHUNK_SIZE] = false;
+            next_free_inode_ = (i + 1) % inode_count_;
+            
+            if (counters_) {
+                counters_->inode_allocated();
+            }
             
             LOG_DEBUG("Allocated inode " + std::to_string(i));
             return i;
@@ -277,9 +531,13 @@ uint32_t InodeTable::allocate_inode() {
     
     // Wrap around and search from beginning
     for (uint32_t i = 1; i < next_free_inode_; ++i) {
-        if (free_inodes_[i]) {
-            free_inodes_[i] = false;
-            next_free_inode_ = (i + 1) % free_inodes_.size();
+        if (chunk_for(i).free_inodes[i % CHUNK_SIZE]) {
+            writable_chunk(i).free_inodes[i % CHUNK_SIZE] = false;
+            next_free_inode_ = (i + 1) % inode_count_;
+            
+            if (counters_) {
+                counters_->inode_allocated();
+            }
             
             LOG_DEBUG("Allocated inode " + std::to_string(i));
             return i;
@@ -287,59 +545,197 @@ uint32_t InodeTable::allocate_inode() {
     }
     
     LOG_ERROR("No free inodes available");
-    throw dfs::utils::InsufficientSpaceException(1, get_free_inode_count());
+    throw dfs::utils::InsufficientSpaceException(1, 0);
+}
+
+uint32_t InodeTable::clone_inode(uint32_t source_inode) {
+    if (source_inode >= inode_count_) {
+        LOG_ERROR("Invalid inode number: " + std::to_string(source_inode));
+        throw dfs::utils::InodeNotFoundException(source_inode);
+    }
+    
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    if (!block_manager_) {
+        throw dfs::utils::FileSystemException("Cannot clone inode: no block manager set");
+    }
+    
+    const InodeChunk& source_chunk = chunk_for(source_inode);
+    if (source_chunk.free_inodes[source_inode % CHUNK_SIZE]) {
+        LOG_ERROR("Cloning free inode: " + std::to_string(source_inode));
+        throw dfs::utils::InodeNotFoundException(source_inode);
+    }
+    
+    Inode clone = source_chunk.inodes[source_inode % CHUNK_SIZE];
+    if (clone.is_directory()) {
+        throw dfs::utils::FileSystemException("Cannot clone directory inode " + std::to_string(source_inode));
+    }
+    
+    // Share the blocks first so a failed allocation can simply drop the references
+    std::vector<uint32_t> block_ids = clone.get_block_pointers();
+    block_manager_->share_blocks(block_ids);
+    
+    uint32_t inode_num;
+    try {
+        inode_num = allocate_inode_locked();
+    } catch (...) {
+        block_manager_->deallocate_blocks(block_ids);
+        throw;
+    }
+    
+    clone.link_count = 1;
+    clone.update_atime();
+    clone.update_ctime();
+    clone.update_checksum();
+    writable_chunk(inode_num).inodes[inode_num % CHUNK_SIZE] = clone;
+    
+    LOG_DEBUG("Cloned inode " + std::to_string(source_inode) + " to " + std::to_string(inode_num) +
+              " sharing " + std::to_string(block_ids.size()) + " blocks");
+    return inode_num;
 }
 
 void InodeTable::deallocate_inode(uint32_t inode_num) {
-    if (inode_num >= free_inodes_.size()) {
+    if (inode_num >= inode_count_) {
         LOG_ERROR("Invalid inode number: " + std::to_string(inode_num));
         throw dfs::utils::InodeNotFoundException(inode_num);
     }
     
     std::lock_guard<std::mutex> lock(table_mutex_);
     
-    if (free_inodes_[inode_num]) {
+    uint32_t slot = inode_num % CHUNK_SIZE;
+    
+    if (chunk_for(inode_num).free_inodes[slot]) {
         LOG_WARN("Attempting to deallocate already free inode: " + std::to_string(inode_num));
         return;
     }
     
-    free_inodes_[inode_num] = true;
+    InodeChunk& chunk = writable_chunk(inode_num);
+    chunk.free_inodes[slot] = true;
     
     // Clear the inode data
-    inodes_[inode_num] = Inode();
+    chunk.inodes[slot] = Inode();
+    
+    if (counters_) {
+        counters_->inode_freed();
+    }
     
     LOG_DEBUG("Deallocated inode " + std::to_string(inode_num));
 }
 
+uint32_t InodeTable::link_inode(uint32_t inode_num) {
+    if (inode_num >= inode_count_) {
+        LOG_ERROR("Invalid inode number: " + std::to_string(inode_num));
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    uint32_t slot = inode_num % CHUNK_SIZE;
+    const InodeChunk& current = chunk_for(inode_num);
+    if (current.free_inodes[slot]) {
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    if (current.inodes[slot].is_directory()) {
+        throw dfs::utils::FileSystemException("Cannot hard link directory inode " + std::to_string(inode_num));
+    }
+    if (current.inodes[slot].link_count >= Inode::MAX_LINK_COUNT) {
+        throw dfs::utils::FileSystemException("Too many links to inode " + std::to_string(inode_num));
+    }
+    
+    Inode& inode = writable_chunk(inode_num).inodes[slot];
+    inode.link_count++;
+    inode.update_ctime();
+    inode.update_checksum();
+    
+    LOG_DEBUG("Linked inode " + std::to_string(inode_num) + ", links: " + std::to_string(inode.link_count));
+    return inode.link_count;
+}
+
+uint32_t InodeTable::unlink_inode(uint32_t inode_num) {
+    if (inode_num >= inode_count_) {
+        LOG_ERROR("Invalid inode number: " + std::to_string(inode_num));
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    uint32_t slot = inode_num % CHUNK_SIZE;
+    const InodeChunk& current = chunk_for(inode_num);
+    if (current.free_inodes[slot]) {
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    if (current.inodes[slot].link_count == 0) {
+        LOG_WARN("Unlinking inode with no links: " + std::to_string(inode_num));
+        return 0;
+    }
+    
+    Inode& inode = writable_chunk(inode_num).inodes[slot];
+    inode.link_count--;
+    inode.update_ctime();
+    inode.update_checksum();
+    
+    LOG_DEBUG("Unlinked inode " + std::to_string(inode_num) + ", links: " + std::to_string(inode.link_count));
+    return inode.link_count;
+}
+
 Inode* InodeTable::get_inode(uint32_t inode_num) {
-    if (inode_num >= inodes_.size()) {
+    if (inode_num >= inode_count_) {
         LOG_ERROR("Invalid inode number: " + std::to_string(inode_num));
         throw dfs::utils::InodeNotFoundException(inode_num);
     }
     
-    if (free_inodes_[inode_num]) {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    uint32_t slot = inode_num % CHUNK_SIZE;
+    
+    if (chunk_for(inode_num).free_inodes[slot]) {
+        LOG_ERROR("Accessing free inode: " + std::to_string(inode_num));
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    
+    // Callers may modify the inode, so it must not be shared with a snapshot
+    return &writable_chunk(inode_num).inodes[slot];
+}
+
+const Inode* InodeTable::get_inode(uint32_t inode_num) const {
+    if (inode_num >= inode_count_) {
+        LOG_ERROR("Invalid inode number: " + std::to_string(inode_num));
+        throw dfs::utils::InodeNotFoundException(inode_num);
+    }
+    
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    const InodeChunk& chunk = chunk_for(inode_num);
+    uint32_t slot = inode_num % CHUNK_SIZE;
+    
+    if (chunk.free_inodes[slot]) {
         LOG_ERROR("Accessing free inode: " + std::to_string(inode_num));
         throw dfs::utils::InodeNotFoundException(inode_num);
     }
     
-    return &inodes_[inode_num];
+    return &chunk.inodes[slot];
 }
 
 bool InodeTable::is_inode_free(uint32_t inode_num) const {
-    if (inode_num >= free_inodes_.size()) {
+    if (inode_num >= inode_count_) {
         return false;
     }
     
-    return free_inodes_[inode_num];
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    return chunk_for(inode_num).free_inodes[inode_num % CHUNK_SIZE];
 }
 
 uint32_t InodeTable::get_free_inode_count() const {
     std::lock_guard<std::mutex> lock(table_mutex_);
     
+    load_all_chunks();
+    
     uint32_t count = 0;
-    for (bool is_free : free_inodes_) {
-        if (is_free) {
-            count++;
+    for (const auto& chunk : chunks_) {
+        for (bool is_free : chunk->free_inodes) {
+            if (is_free) {
+                count++;
+            }
         }
     }
     
@@ -347,7 +743,41 @@ uint32_t InodeTable::get_free_inode_count() const {
 }
 
 uint32_t InodeTable::get_total_inode_count() const {
-    return static_cast<uint32_t>(inodes_.size());
+    return inode_count_;
+}
+
+uint32_t InodeTable::get_loaded_chunk_count() const {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    uint32_t count = 0;
+    for (const auto& chunk : chunks_) {
+        if (chunk->loaded.load(std::memory_order_acquire)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void InodeTable::copy_range(uint32_t first_inode, uint32_t count, std::vector<Inode>& inodes,
+                            std::vector<bool>& free_flags) const {
+    inodes.clear();
+    free_flags.clear();
+    
+    if (first_inode >= inode_count_) {
+        return;
+    }
+    
+    count = std::min(count, inode_count_ - first_inode);
+    inodes.reserve(count);
+    free_flags.reserve(count);
+    
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    for (uint32_t i = first_inode; i < first_inode + count; ++i) {
+        const InodeChunk& chunk = chunk_for(i);
+        inodes.push_back(chunk.inodes[i % CHUNK_SIZE]);
+        free_flags.push_back(chunk.free_inodes[i % CHUNK_SIZE]);
+    }
 }
 
 void InodeTable::serialize(std::ofstream& file) const {
@@ -357,18 +787,25 @@ void InodeTable::serialize(std::ofstream& file) const {
     
     LOG_DEBUG("Serializing InodeTable to file");
     
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    // Every chunk is written, so fault in the ones still on disk
+    load_all_chunks();
+    
     // Write inode count
-    uint32_t inode_count = static_cast<uint32_t>(inodes_.size());
-    file.write(reinterpret_cast<const char*>(&inode_count), sizeof(inode_count));
+    file.write(reinterpret_cast<const char*>(&inode_count_), sizeof(inode_count_));
     
     // Write all inodes
-    for (const auto& inode : inodes_) {
-        file.write(reinterpret_cast<const char*>(&inode), sizeof(Inode));
+    for (const auto& chunk : chunks_) {
+        file.write(reinterpret_cast<const char*>(chunk->inodes.data()),
+                   static_cast<std::streamsize>(chunk->inodes.size()) * sizeof(Inode));
     }
     
     // Write free inode bitmap
-    for (bool is_free : free_inodes_) {
-        file.write(reinterpret_cast<const char*>(&is_free), sizeof(bool));
+    for (const auto& chunk : chunks_) {
+        for (bool is_free : chunk->free_inodes) {
+            file.write(reinterpret_cast<const char*>(&is_free), sizeof(bool));
+        }
     }
     
     if (file.fail()) {
@@ -385,6 +822,8 @@ void InodeTable::deserialize(std::ifstream& file) {
     
     LOG_DEBUG("Deserializing InodeTable from file");
     
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
     // Read inode count
     uint32_t inode_count;
     file.read(reinterpret_cast<char*>(&inode_count), sizeof(inode_count));
@@ -394,27 +833,171 @@ void InodeTable::deserialize(std::ifstream& file) {
     }
     
     // Resize arrays
-    inodes_.resize(inode_count);
-    free_inodes_.resize(inode_count);
+    reset_chunks(inode_count);
     
     // Read all inodes
-    for (auto& inode : inodes_) {
-        file.read(reinterpret_cast<char*>(&inode), sizeof(Inode));
-        if (file.fail() || file.gcount() != sizeof(Inode)) {
+    for (auto& chunk : chunks_) {
+        std::streamsize bytes = static_cast<std::streamsize>(chunk->inodes.size()) * sizeof(Inode);
+        file.read(reinterpret_cast<char*>(chunk->inodes.data()), bytes);
+        if (file.fail() || file.gcount() != bytes) {
             throw dfs::utils::FileSystemException("Failed to deserialize InodeTable inode");
         }
     }
     
     // Read free inode bitmap
-    for (auto& is_free : free_inodes_) {
-        file.read(reinterpret_cast<char*>(&is_free), sizeof(bool));
-        if (file.fail() || file.gcount() != sizeof(bool)) {
-            throw dfs::utils::FileSystemException("Failed to deserialize InodeTable bitmap");
+    for (auto& chunk : chunks_) {
+        for (size_t i = 0; i < chunk->free_inodes.size(); ++i) {
+            bool is_free;
+            file.read(reinterpret_cast<char*>(&is_free), sizeof(bool));
+            if (file.fail() || file.gcount() != sizeof(bool)) {
+                throw dfs::utils::FileSystemException("Failed to deserialize InodeTable bitmap");
+            }
+            chunk->free_inodes[i] = is_free;
         }
     }
     
     LOG_DEBUG("InodeTable deserialized successfully");
 }
 
+void InodeTable::attach(const std::string& image_path, std::streamoff offset) {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    LOG_DEBUG("Attaching InodeTable to " + image_path + " at offset " + std::to_string(offset));
+    
+    auto backing = std::make_shared<BackingImage>();
+    backing->file.open(image_path, std::ios::binary);
+    if (!backing->file.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot attach InodeTable: failed to open " + image_path);
+    }
+    
+    // Only the count header is read now
+    uint32_t inode_count;
+    backing->file.seekg(offset);
+    backing->file.read(reinterpret_cast<char*>(&inode_count), sizeof(inode_count));
+    
+    if (backing->file.fail() || backing->file.gcount() != sizeof(inode_count)) {
+        throw dfs::utils::FileSystemException("Failed to read InodeTable inode count");
+    }
+    
+    inode_count_ = inode_count;
+    next_free_inode_ = 1;
+    
+    chunks_.clear();
+    chunks_.resize((inode_count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (auto& chunk : chunks_) {
+        chunk = std::make_shared<InodeChunk>();
+        chunk->loaded.store(false, std::memory_order_relaxed);
+    }
+    
+    backing->offset = offset;
+    backing->unloaded_chunks = static_cast<uint32_t>(chunks_.size());
+    if (backing->unloaded_chunks == 0) {
+        backing->file.close();
+    }
+    backing_ = std::move(backing);
+    
+    LOG_INFO("InodeTable attached with " + std::to_string(inode_count) + " inodes in " +
+             std::to_string(chunks_.size()) + " chunks");
+}
+
+std::shared_ptr<InodeTable> InodeTable::share_chunks() const {
+    auto shared = std::make_shared<InodeTable>(0);
+    shared->chunks_ = chunks_;
+    shared->inode_count_ = inode_count_;
+    shared->next_free_inode_ = next_free_inode_;
+    shared->backing_ = backing_;
+    return shared;
+}
+
+std::shared_ptr<InodeTable> InodeTable::snapshot() const {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    if (!block_manager_) {
+        throw dfs::utils::FileSystemException("Cannot snapshot InodeTable: no block manager set");
+    }
+    
+    // Chunks still on disk are shared unread and faulted in by whichever
+    // table touches them first
+    std::shared_ptr<InodeTable> snapshot = share_chunks();
+    snapshot->block_manager_ = block_manager_;
+    for (const auto& chunk : chunks_) {
+        chunk->owners.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Forget snapshots that have been dropped since the last one
+    snapshots_.erase(std::remove_if(snapshots_.begin(), snapshots_.end(),
+                                    [](const std::weak_ptr<InodeTable>& taken) { return taken.expired(); }),
+                     snapshots_.end());
+    snapshots_.push_back(snapshot);
+    
+    LOG_INFO("Created InodeTable snapshot sharing " + std::to_string(chunks_.size()) + " chunks");
+    return snapshot;
+}
+
+std::shared_ptr<const InodeTable> InodeTable::view() const {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    // Owner counts are left alone, so the view holds no block references
+    return share_chunks();
+}
+
+void InodeTable::release_snapshot(InodeTable& snapshot) {
+    // Hold both tables so no chunk is copied while ownership is decided
+    std::lock(table_mutex_, snapshot.table_mutex_);
+    std::lock_guard<std::mutex> lock(table_mutex_, std::adopt_lock);
+    std::lock_guard<std::mutex> snapshot_lock(snapshot.table_mutex_, std::adopt_lock);
+    
+    uint32_t released_chunks = 0;
+    for (uint32_t i = 0; i < snapshot.chunks_.size(); ++i) {
+        // Chunks still owned elsewhere keep their blocks through the other owners
+        InodeChunk& chunk = *snapshot.chunks_[i];
+        if (chunk.owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            snapshot.chunk_for(i * CHUNK_SIZE);
+            release_chunk_blocks(chunk);
+            released_chunks++;
+        }
+    }
+    
+    snapshot.chunks_.clear();
+    snapshot.inode_count_ = 0;
+    snapshot.backing_.reset();
+    
+    LOG_INFO("Released InodeTable snapshot, " + std::to_string(released_chunks) + " chunks freed");
+}
+
+std::vector<BlockTree> InodeTable::snapshot_only_blocks() const {
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    
+    std::unordered_set<const InodeChunk*> counted;
+    for (const auto& chunk : chunks_) {
+        counted.insert(chunk.get());
+    }
+    
+    // Each chunk object holds one reference to the root blocks of its
+    // inodes; chunks shared by several snapshots are counted once. A chunk
+    // this table no longer holds was read before it was copied.
+    std::vector<BlockTree> trees;
+    for (const auto& taken : snapshots_) {
+        std::shared_ptr<InodeTable> snapshot = taken.lock();
+        if (!snapshot) {
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> snapshot_lock(snapshot->table_mutex_);
+        for (const auto& chunk : snapshot->chunks_) {
+            if (!counted.insert(chunk.get()).second) {
+                continue;
+            }
+            for (size_t i = 0; i < chunk->inodes.size(); ++i) {
+                if (!chunk->free_inodes[i]) {
+                    append_block_trees(chunk->inodes[i], trees);
+                }
+            }
+        }
+    }
+    
+    return trees;
+}
+
 } // namespace core
 } // namespace dfs
@@ -1,10 +1,18 @@
 #include "core/superblock.h"
 #include "utils/logger.h"
 #include "utils/exceptions.h"
+#include "utils/checksum.h"
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <future>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 namespace dfs {
 namespace core {
@@ -18,10 +26,14 @@ SuperBlock::SuperBlock() {
     inode_count = 0;
     free_inodes = 0;
     root_inode = 0;
+    reserved1 = 0;
     last_mount_time = 0;
     last_write_time = 0;
     version = 1;
     checksum = 0;
+    state = STATE_DIRTY;
+    reserved2 = 0;
+    generation = 0;
     
     // Clear padding
     std::memset(padding, 0, sizeof(padding));
@@ -35,11 +47,14 @@ void SuperBlock::initialize(uint32_t total_blocks, uint32_t block_size) {
     this->magic_number = MAGIC_NUMBER;
     this->block_size = block_size;
     this->total_blocks = total_blocks;
-    this->free_blocks = total_blocks - 1; // Reserve one block for superblock
+    // Every block holding a superblock copy is reserved, as in BlockManager
+    this->free_blocks = total_blocks - static_cast<uint32_t>(copy_block_numbers(total_blocks, block_size).size());
     this->inode_count = total_blocks / 4; // 1 inode per 4 blocks (configurable)
     this->free_inodes = this->inode_count - 1; // Reserve one for root
     this->root_inode = 1; // Root inode is always 1
     this->version = 1;
+    this->state = STATE_CLEAN; // A freshly formatted volume has nothing to replay
+    this->generation = 0;
     
     // Set timestamps
     auto now = std::chrono::system_clock::now();
@@ -48,11 +63,10 @@ void SuperBlock::initialize(uint32_t total_blocks, uint32_t block_size) {
     this->last_write_time = this->last_mount_time;
     
     // Clear padding
+    this->reserved1 = 0;
+    this->reserved2 = 0;
     std::memset(padding, 0, sizeof(padding));
     
-    // Calculate and set checksum
-    update_checksum();
-    
     LOG_INFO("SuperBlock initialized successfully");
 }
 
@@ -108,10 +122,14 @@ bool SuperBlock::is_valid() const {
         return false;
     }
     
+    // Check mount state
+    if (state != STATE_CLEAN && state != STATE_DIRTY) {
+        LOG_ERROR("Invalid mount state: " + std::to_string(state));
+        return false;
+    }
+    
     // Verify checksum
-    SuperBlock temp = *this;
-    temp.checksum = 0;
-    uint32_t calculated_checksum = calculate_checksum(&temp, sizeof(SuperBlock));
+    uint32_t calculated_checksum = compute_checksum();
     
     if (checksum != calculated_checksum) {
         LOG_ERROR("Checksum mismatch: stored=" + std::to_string(checksum) + 
@@ -123,16 +141,20 @@ bool SuperBlock::is_valid() const {
 }
 
 void SuperBlock::update_checksum() {
-    // Zero out the checksum field before calculating
-    uint32_t old_checksum = checksum;
-    checksum = 0;
-    
-    // Calculate new checksum
-    checksum = calculate_checksum(this, sizeof(SuperBlock));
+    checksum = compute_checksum();
     
     LOG_DEBUG("Updated SuperBlock checksum: " + std::to_string(checksum));
 }
 
+SuperBlock SuperBlock::make_image() const {
+    // Stamp the write time and compute the checksum once, on the copy written out
+    SuperBlock image = *this;
+    image.last_write_time = 
+        static_cast<uint64_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    image.update_checksum();
+    return image;
+}
+
 void SuperBlock::serialize(std::ofstream& file) const {
     if (!file.is_open()) {
         throw dfs::utils::FileSystemException("Cannot serialize SuperBlock: file not open");
@@ -140,17 +162,15 @@ void SuperBlock::serialize(std::ofstream& file) const {
     
     LOG_DEBUG("Serializing SuperBlock to file");
     
+    SuperBlock image = make_image();
+    
     // Write the entire SuperBlock structure
-    file.write(reinterpret_cast<const char*>(this), sizeof(SuperBlock));
+    file.write(reinterpret_cast<const char*>(&image), sizeof(SuperBlock));
     
     if (file.fail()) {
         throw dfs::utils::FileSystemException("Failed to serialize SuperBlock");
     }
     
-    // Update last write time
-    const_cast<SuperBlock*>(this)->last_write_time = 
-        static_cast<uint64_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    
     LOG_DEBUG("SuperBlock serialized successfully");
 }
 
@@ -177,18 +197,137 @@ void SuperBlock::deserialize(std::ifstream& file) {
 }
 
 uint32_t SuperBlock::calculate_checksum(const void* data, size_t size) {
-    const uint8_t* bytes = static_cast<const uint8_t*>(data);
-    uint32_t checksum = 0;
-    
-    // Simple checksum algorithm (CRC32-like)
-    for (size_t i = 0; i < size; ++i) {
-        checksum = (checksum << 1) ^ bytes[i];
-        if (checksum & 0x80000000) {
-            checksum ^= 0x04C11DB7; // CRC32 polynomial
+    return dfs::utils::Checksum::crc32c(data, size);
+}
+
+uint32_t SuperBlock::compute_checksum() const {
+    // Checksum the bytes as they are on disk, with the checksum field zeroed
+    uint8_t image[sizeof(SuperBlock)];
+    std::memcpy(image, this, sizeof(SuperBlock));
+    std::memset(image + offsetof(SuperBlock, checksum), 0, sizeof(checksum));
+    return calculate_checksum(image, sizeof(image));
+}
+
+void SuperBlock::write_copies(const std::string& device_path) {
+    generation++;
+    SuperBlock image = make_image();
+    
+    std::fstream device(device_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!device.is_open()) {
+        // Device image does not exist yet
+        device.open(device_path, std::ios::out | std::ios::binary);
+    }
+    if (!device.is_open()) {
+        throw dfs::utils::FileSystemException("Cannot write SuperBlock copies: failed to open " + device_path);
+    }
+    
+    uint64_t device_bytes = static_cast<uint64_t>(total_blocks) * block_size;
+    
+    // Backups first, so a torn primary write always leaves a valid newer-or-equal backup
+    for (uint32_t i = COPY_COUNT; i-- > 0;) {
+        if (i > 0 && COPY_OFFSETS[i] + sizeof(SuperBlock) > device_bytes) {
+            continue;
+        }
+        
+        device.seekp(static_cast<std::streamoff>(COPY_OFFSETS[i]));
+        device.write(reinterpret_cast<const char*>(&image), sizeof(SuperBlock));
+        device.flush();
+        
+        if (device.fail()) {
+            throw dfs::utils::FileSystemException("Failed to write SuperBlock copy " + std::to_string(i));
+        }
+    }
+    
+    last_write_time = image.last_write_time;
+    checksum = image.checksum;
+    
+    LOG_DEBUG("Wrote SuperBlock copies, generation " + std::to_string(generation));
+}
+
+SuperBlock SuperBlock::read_newest_copy(const std::string& device_path,
+                                        std::vector<uint32_t>* stale_copies) {
+    LOG_DEBUG("Reading SuperBlock copies from " + device_path);
+    
+    // Each copy is read and validated on its own thread
+    std::vector<std::future<std::unique_ptr<SuperBlock>>> reads;
+    reads.reserve(COPY_COUNT);
+    
+    for (uint32_t i = 0; i < COPY_COUNT; ++i) {
+        reads.push_back(std::async(std::launch::async, [&device_path, i]() -> std::unique_ptr<SuperBlock> {
+            std::ifstream device(device_path, std::ios::binary);
+            if (!device.is_open()) {
+                return nullptr;
+            }
+            
+            auto copy = std::make_unique<SuperBlock>();
+            device.seekg(static_cast<std::streamoff>(COPY_OFFSETS[i]));
+            device.read(reinterpret_cast<char*>(copy.get()), sizeof(SuperBlock));
+            
+            if (device.fail() || device.gcount() != sizeof(SuperBlock)) {
+                return nullptr;
+            }
+            
+            // Copies past the end of a small device are simply absent
+            if (copy->magic_number != MAGIC_NUMBER || !copy->is_valid()) {
+                return nullptr;
+            }
+            
+            return copy;
+        }));
+    }
+    
+    std::vector<std::unique_ptr<SuperBlock>> copies;
+    copies.reserve(COPY_COUNT);
+    for (auto& read : reads) {
+        copies.push_back(read.get());
+    }
+    
+    int newest = -1;
+    for (uint32_t i = 0; i < COPY_COUNT; ++i) {
+        if (copies[i] && (newest < 0 || copies[i]->generation > copies[newest]->generation)) {
+            newest = static_cast<int>(i);
+        }
+    }
+    
+    if (newest < 0) {
+        LOG_ERROR("No valid SuperBlock copy found on " + device_path);
+        throw dfs::utils::FileSystemCorruptedException("No valid SuperBlock copy found");
+    }
+    
+    uint64_t device_bytes = static_cast<uint64_t>(copies[newest]->total_blocks) * copies[newest]->block_size;
+    
+    for (uint32_t i = 0; i < COPY_COUNT; ++i) {
+        bool on_device = i == 0 || COPY_OFFSETS[i] + sizeof(SuperBlock) <= device_bytes;
+        bool stale = !copies[i] || copies[i]->generation != copies[newest]->generation;
+        
+        if (on_device && stale) {
+            LOG_WARN("SuperBlock copy " + std::to_string(i) + " is invalid or stale");
+            if (stale_copies) {
+                stale_copies->push_back(i);
+            }
+        }
+    }
+    
+    LOG_INFO("Selected SuperBlock copy " + std::to_string(newest) + 
+             " (generation " + std::to_string(copies[newest]->generation) + ")");
+    return *copies[newest];
+}
+
+std::vector<uint32_t> SuperBlock::copy_block_numbers(uint32_t total_blocks, uint32_t block_size) {
+    std::vector<uint32_t> blocks;
+    
+    if (block_size == 0) {
+        return blocks;
+    }
+    
+    for (uint64_t offset : COPY_OFFSETS) {
+        uint64_t block = offset / block_size;
+        if (block < total_blocks) {
+            blocks.push_back(static_cast<uint32_t>(block));
         }
     }
     
-    return checksum;
+    return blocks;
 }
 
 std::string SuperBlock::to_string() const {
@@ -203,6 +342,8 @@ std::string SuperBlock::to_string() const {
     oss << "  Free Inodes: " << free_inodes << "\n";
     oss << "  Root Inode: " << root_inode << "\n";
     oss << "  Version: " << version << "\n";
+    oss << "  State: " << (state == STATE_CLEAN ? "clean" : "dirty") << "\n";
+    oss << "  Generation: " << generation << "\n";
     oss << "  Last Mount Time: " << last_mount_time << "\n";
     oss << "  Last Write Time: " << last_write_time << "\n";
     oss << "  Checksum: 0x" << std::hex << std::setw(8) << std::setfill('0') << checksum << std::dec << "\n";
@@ -224,9 +365,6 @@ bool SuperBlock::allocate_block() {
     }
     
     free_blocks--;
-    last_write_time = static_cast<uint64_t>(
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    update_checksum();
     
     LOG_DEBUG("Allocated block, " + std::to_string(free_blocks) + " blocks remaining");
     return true;
@@ -239,9 +377,6 @@ bool SuperBlock::deallocate_block() {
     }
     
     free_blocks++;
-    last_write_time = static_cast<uint64_t>(
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    update_checksum();
     
     LOG_DEBUG("Deallocated block, " + std::to_string(free_blocks) + " blocks available");
     return true;
@@ -254,9 +389,6 @@ bool SuperBlock::allocate_inode() {
     }
     
     free_inodes--;
-    last_write_time = static_cast<uint64_t>(
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    update_checksum();
     
     LOG_DEBUG("Allocated inode, " + std::to_string(free_inodes) + " inodes remaining");
     return true;
@@ -269,18 +401,30 @@ bool SuperBlock::deallocate_inode() {
     }
     
     free_inodes++;
-    last_write_time = static_cast<uint64_t>(
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    update_checksum();
     
     LOG_DEBUG("Deallocated inode, " + std::to_string(free_inodes) + " inodes available");
     return true;
 }
 
+void SuperBlock::mark_dirty() {
+    state = STATE_DIRTY;
+    
+    LOG_DEBUG("SuperBlock marked dirty");
+}
+
+void SuperBlock::mark_clean() {
+    state = STATE_CLEAN;
+    
+    LOG_DEBUG("SuperBlock marked clean");
+}
+
+bool SuperBlock::was_cleanly_unmounted() const {
+    return state == STATE_CLEAN;
+}
+
 void SuperBlock::update_mount_time() {
     last_mount_time = static_cast<uint64_t>(
         std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-    update_checksum();
     
     LOG_DEBUG("Updated mount time");
 }
@@ -303,5 +447,90 @@ uint32_t SuperBlock::get_inode_usage_percentage() const {
     return ((inode_count - free_inodes) * 100) / inode_count;
 }
 
+// SuperBlockCounters implementation
+SuperBlockCounters::SuperBlockCounters(SuperBlock& superblock)
+    : superblock_(superblock) {}
+
+size_t SuperBlockCounters::current_slot() {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return static_cast<size_t>(cpu) % SLOT_COUNT;
+    }
+#endif
+    static thread_local size_t slot = 
+        std::hash<std::thread::id>{}(std::this_thread::get_id()) % SLOT_COUNT;
+    return slot;
+}
+
+void SuperBlockCounters::block_allocated(uint32_t count) {
+    slots_[current_slot()].block_delta.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void SuperBlockCounters::block_freed(uint32_t count) {
+    slots_[current_slot()].block_delta.fetch_add(count, std::memory_order_relaxed);
+}
+
+void SuperBlockCounters::inode_allocated(uint32_t count) {
+    slots_[current_slot()].inode_delta.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void SuperBlockCounters::inode_freed(uint32_t count) {
+    slots_[current_slot()].inode_delta.fetch_add(count, std::memory_order_relaxed);
+}
+
+int64_t SuperBlockCounters::pending_block_delta() const {
+    int64_t delta = 0;
+    for (const Slot& slot : slots_) {
+        delta += slot.block_delta.load(std::memory_order_relaxed);
+    }
+    return delta;
+}
+
+int64_t SuperBlockCounters::pending_inode_delta() const {
+    int64_t delta = 0;
+    for (const Slot& slot : slots_) {
+        delta += slot.inode_delta.load(std::memory_order_relaxed);
+    }
+    return delta;
+}
+
+uint32_t SuperBlockCounters::get_free_blocks() const {
+    int64_t free_blocks = static_cast<int64_t>(superblock_.free_blocks) + pending_block_delta();
+    return static_cast<uint32_t>(std::clamp<int64_t>(free_blocks, 0, superblock_.total_blocks));
+}
+
+uint32_t SuperBlockCounters::get_free_inodes() const {
+    int64_t free_inodes = static_cast<int64_t>(superblock_.free_inodes) + pending_inode_delta();
+    return static_cast<uint32_t>(std::clamp<int64_t>(free_inodes, 0, superblock_.inode_count));
+}
+
+void SuperBlockCounters::fold() {
+    // Drain each slot atomically so deltas recorded concurrently are kept for the next fold
+    int64_t block_delta = 0;
+    int64_t inode_delta = 0;
+    for (Slot& slot : slots_) {
+        block_delta += slot.block_delta.exchange(0, std::memory_order_relaxed);
+        inode_delta += slot.inode_delta.exchange(0, std::memory_order_relaxed);
+    }
+    
+    int64_t free_blocks = static_cast<int64_t>(superblock_.free_blocks) + block_delta;
+    int64_t free_inodes = static_cast<int64_t>(superblock_.free_inodes) + inode_delta;
+    
+    if (free_blocks < 0 || free_blocks > superblock_.total_blocks ||
+        free_inodes < 0 || free_inodes > superblock_.inode_count) {
+        LOG_WARN("SuperBlock counter fold out of range, clamping (blocks=" + 
+                 std::to_string(free_blocks) + ", inodes=" + std::to_string(free_inodes) + ")");
+    }
+    
+    superblock_.free_blocks = static_cast<uint32_t>(
+        std::clamp<int64_t>(free_blocks, 0, superblock_.total_blocks));
+    superblock_.free_inodes = static_cast<uint32_t>(
+        std::clamp<int64_t>(free_inodes, 0, superblock_.inode_count));
+    
+    LOG_DEBUG("Folded SuperBlock counters: " + std::to_string(superblock_.free_blocks) + 
+              " free blocks, " + std::to_string(superblock_.free_inodes) + " free inodes");
+}
+
 } // namespace core
 } // namespace dfs
@@ -1,4 +1,5 @@
 #include "core/transaction_manager.h"
+#include "core/superblock.h"
 #include "utils/logger.h"
 #include "utils/exceptions.h"
 #include <fstream>
@@ -68,9 +69,8 @@ void LogEntry::deserialize(std::ifstream& file) {
     file.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
     file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
     
-    if (file.fail() || file.gcount() != sizeof(transaction_id) + sizeof(operation_type) + 
-                      sizeof(inode_number) + sizeof(block_number) + 
-                      sizeof(timestamp) + sizeof(checksum)) {
+    // gcount() only covers the last read, so rely on the fail bit
+    if (file.fail()) {
         throw dfs::utils::FileSystemException("Failed to deserialize LogEntry header");
     }
     
@@ -238,11 +238,13 @@ bool TransactionManager::commit_transaction(uint64_t tx_id) {
         transaction->is_committed.store(true);
         transaction->is_active.store(false);
         
+        size_t entry_count = transaction->log_entries.size();
+        
         // Remove from active transactions
         active_transactions_.erase(it);
         
         LOG_DEBUG("Committed transaction " + std::to_string(tx_id) + 
-                 " with " + std::to_string(transaction->log_entries.size()) + " log entries");
+                 " with " + std::to_string(entry_count) + " log entries");
         
         return true;
         
@@ -390,6 +392,24 @@ void TransactionManager::recover() {
     }
 }
 
+uint32_t TransactionManager::recover(const SuperBlock& superblock) {
+    if (superblock.was_cleanly_unmounted()) {
+        LOG_INFO("Skipping transaction log replay after clean unmount");
+        return 0;
+    }
+    
+    LOG_INFO("Starting transaction recovery from log file");
+    
+    try {
+        uint32_t replayed_entries = replay_log_entries();
+        LOG_INFO("Transaction recovery completed successfully");
+        return replayed_entries;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Transaction recovery failed: " + std::string(e.what()));
+        throw;
+    }
+}
+
 TransactionManager::TransactionStats TransactionManager::get_transaction_stats() const {
     std::lock_guard<std::mutex> lock(transaction_mutex_);
     
@@ -435,17 +455,17 @@ void TransactionManager::write_log_entry(const LogEntry& entry) {
     log_file_.flush();
 }
 
-void TransactionManager::replay_log_entries() {
+uint32_t TransactionManager::replay_log_entries() {
     std::ifstream log_file(log_file_path_, std::ios::binary);
     if (!log_file.is_open()) {
         LOG_WARN("Cannot open log file for recovery: " + log_file_path_);
-        return;
+        return 0;
     }
     
     uint32_t replayed_entries = 0;
     
     try {
-        while (log_file.good() && !log_file.eof()) {
+        while (log_file.peek() != std::ifstream::traits_type::eof()) {
             LogEntry entry;
             entry.deserialize(log_file);
             
@@ -465,6 +485,7 @@ void TransactionManager::replay_log_entries() {
     }
     
     LOG_INFO("Replayed " + std::to_string(replayed_entries) + " log entries during recovery");
+    return replayed_entries;
 }
 
 // TransactionGuard implementation
@@ -0,0 +1,169 @@
+#include "utils/block_pool.h"
+#include "utils/cpu_topology.h"
+#include <mutex>
+#include <vector>
+
+namespace dfs {
+namespace utils {
+
+namespace {
+
+constexpr size_t CLASS_SIZES[] = {64, 128, 256};
+constexpr size_t CLASS_COUNT = sizeof(CLASS_SIZES) / sizeof(CLASS_SIZES[0]);
+
+// Blocks moved between a thread and the shared lists at a time
+constexpr size_t BATCH_SIZE = 64;
+
+// A free block; the first block of a batch on a shared list also links
+// the next batch and records its own batch's length
+struct FreeBlock {
+    FreeBlock* next;
+    FreeBlock* next_batch;
+    size_t batch_count;
+};
+
+struct Batch {
+    FreeBlock* head;
+    size_t count;
+};
+
+// Shared lists of batches, one per size class and NUMA node; never destroyed
+// so threads exiting during static destruction can still return their blocks
+struct SharedLists {
+    std::mutex mutex;
+    FreeBlock* batches[CLASS_COUNT] = {};
+    
+    void push(size_t cls, Batch batch) {
+        batch.head->next_batch = batches[cls];
+        batch.head->batch_count = batch.count;
+        batches[cls] = batch.head;
+    }
+    
+    Batch pop(size_t cls) {
+        FreeBlock* head = batches[cls];
+        if (!head) {
+            return Batch{nullptr, 0};
+        }
+        batches[cls] = head->next_batch;
+        return Batch{head, head->batch_count};
+    }
+};
+
+std::vector<SharedLists>& node_lists() {
+    static std::vector<SharedLists>* lists =
+        new std::vector<SharedLists>(CpuTopology::get_instance().get_node_count());
+    return *lists;
+}
+
+SharedLists& shared_lists(size_t node) {
+    return node_lists()[node];
+}
+
+inline int size_class(size_t size) {
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        if (size <= CLASS_SIZES[i]) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Split the first count blocks off a list
+Batch take_batch(FreeBlock*& head, size_t count) {
+    Batch batch{head, 0};
+    FreeBlock* last = nullptr;
+    while (head && batch.count < count) {
+        last = head;
+        head = head->next;
+        batch.count++;
+    }
+    if (last) {
+        last->next = nullptr;
+    }
+    return batch;
+}
+
+// Blocks freed by a thread go back to its own node's shared lists, so a
+// thread pinned to a node recycles memory first touched on that node
+struct ThreadCache {
+    FreeBlock* heads[CLASS_COUNT] = {};
+    size_t counts[CLASS_COUNT] = {};
+    size_t node = CpuTopology::get_instance().current_node();
+    
+    ~ThreadCache();
+};
+
+// Set once this thread's cache is destroyed; later frees bypass it
+thread_local bool cache_destroyed = false;
+thread_local ThreadCache cache;
+
+ThreadCache::~ThreadCache() {
+    cache_destroyed = true;
+    
+    SharedLists& lists = shared_lists(node);
+    std::lock_guard<std::mutex> lock(lists.mutex);
+    for (size_t cls = 0; cls < CLASS_COUNT; ++cls) {
+        if (heads[cls]) {
+            lists.push(cls, Batch{heads[cls], counts[cls]});
+            heads[cls] = nullptr;
+            counts[cls] = 0;
+        }
+    }
+}
+
+} // namespace
+
+void* BlockPool::allocate(size_t size) {
+    int cls = size_class(size);
+    if (cls < 0 || cache_destroyed) {
+        return ::operator new(cls < 0 ? size : CLASS_SIZES[cls]);
+    }
+    
+    ThreadCache& local = cache;
+    if (!local.heads[cls]) {
+        // Pick up a batch freed by other threads, from this node if it has one
+        std::vector<SharedLists>& lists = node_lists();
+        for (size_t i = 0; i < lists.size() && !local.heads[cls]; ++i) {
+            SharedLists& node_list = lists[(local.node + i) % lists.size()];
+            std::lock_guard<std::mutex> lock(node_list.mutex);
+            Batch batch = node_list.pop(cls);
+            local.heads[cls] = batch.head;
+            local.counts[cls] = batch.count;
+        }
+    }
+    
+    FreeBlock* block = local.heads[cls];
+    if (!block) {
+        return ::operator new(CLASS_SIZES[cls]);
+    }
+    local.heads[cls] = block->next;
+    local.counts[cls]--;
+    return block;
+}
+
+void BlockPool::deallocate(void* block, size_t size) noexcept {
+    int cls = size_class(size);
+    if (cls < 0 || cache_destroyed) {
+        ::operator delete(block);
+        return;
+    }
+    
+    ThreadCache& local = cache;
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = local.heads[cls];
+    local.heads[cls] = freed;
+    local.counts[cls]++;
+    
+    // Hand surplus blocks to threads that allocate more than they free
+    if (local.counts[cls] >= 2 * BATCH_SIZE) {
+        Batch batch = take_batch(local.heads[cls], BATCH_SIZE);
+        local.counts[cls] -= batch.count;
+        
+        SharedLists& lists = shared_lists(local.node);
+        std::lock_guard<std::mutex> lock(lists.mutex);
+        lists.push(cls, batch);
+    }
+}
+
+} // namespace utils
+} // namespace dfs
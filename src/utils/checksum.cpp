@@ -0,0 +1,463 @@
+#include "utils/checksum.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define DFS_HAVE_X86_CRC32C 1
+#endif
+
+namespace dfs {
+namespace utils {
+
+namespace {
+
+// Reflected CRC32C polynomial
+constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+std::array<uint32_t, 256> make_crc32c_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+const std::array<uint32_t, 256> CRC32C_TABLE = make_crc32c_table();
+
+// XXH64 primes
+constexpr uint64_t XXH64_PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t XXH64_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t XXH64_PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t XXH64_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t XXH64_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+// XXH32 primes
+constexpr uint32_t XXH32_PRIME1 = 0x9E3779B1U;
+constexpr uint32_t XXH32_PRIME2 = 0x85EBCA77U;
+constexpr uint32_t XXH32_PRIME3 = 0xC2B2AE3DU;
+constexpr uint32_t XXH32_PRIME4 = 0x27D4EB2FU;
+constexpr uint32_t XXH32_PRIME5 = 0x165667B1U;
+
+inline uint32_t rotl32(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t xxh32_round(uint32_t acc, uint32_t input) {
+    acc += input * XXH32_PRIME2;
+    acc = rotl32(acc, 13);
+    return acc * XXH32_PRIME1;
+}
+
+inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH64_PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * XXH64_PRIME1;
+}
+
+inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t value) {
+    acc ^= xxh64_round(0, value);
+    return acc * XXH64_PRIME1 + XXH64_PRIME4;
+}
+
+// XXH3 default secret and mixing constants
+constexpr uint8_t XXH3_SECRET[192] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+constexpr size_t XXH3_SECRET_SIZE = sizeof(XXH3_SECRET);
+constexpr size_t XXH3_STRIPE_LEN = 64;
+constexpr size_t XXH3_SECRET_CONSUME_RATE = 8;
+constexpr size_t XXH3_MIDSIZE_MAX = 240;
+constexpr uint64_t XXH3_PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+inline uint64_t xxh64_avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= XXH64_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH64_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+inline uint64_t xxh3_avalanche(uint64_t hash) {
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ULL;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Full 64x64 -> 128-bit product
+inline Checksum::Hash128 mul128(uint64_t lhs, uint64_t rhs) {
+    unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+    return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+}
+
+inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs) {
+    Checksum::Hash128 product = mul128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+inline uint64_t xxh3_mix16(const uint8_t* input, const uint8_t* secret) {
+    return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+inline void xxh3_mix32(Checksum::Hash128& acc, const uint8_t* first, const uint8_t* second,
+                       const uint8_t* secret) {
+    acc.low += xxh3_mix16(first, secret);
+    acc.low ^= read64(second) + read64(second + 8);
+    acc.high += xxh3_mix16(second, secret + 16);
+    acc.high ^= read64(first) + read64(first + 8);
+}
+
+Checksum::Hash128 xxh3_128_short(const uint8_t* p, size_t size) {
+    const uint8_t* secret = XXH3_SECRET;
+    Checksum::Hash128 hash;
+    
+    if (size > 8) {
+        uint64_t bitflip_lo = read64(secret + 32) ^ read64(secret + 40);
+        uint64_t bitflip_hi = read64(secret + 48) ^ read64(secret + 56);
+        uint64_t input_lo = read64(p);
+        uint64_t input_hi = read64(p + size - 8);
+        
+        Checksum::Hash128 m = mul128(input_lo ^ input_hi ^ bitflip_lo, XXH64_PRIME1);
+        m.low += static_cast<uint64_t>(size - 1) << 54;
+        input_hi ^= bitflip_hi;
+        m.high += input_hi + static_cast<uint64_t>(static_cast<uint32_t>(input_hi)) * (XXH32_PRIME2 - 1);
+        m.low ^= __builtin_bswap64(m.high);
+        
+        hash = mul128(m.low, XXH64_PRIME2);
+        hash.high += m.high * XXH64_PRIME2;
+        hash.low = xxh3_avalanche(hash.low);
+        hash.high = xxh3_avalanche(hash.high);
+    } else if (size >= 4) {
+        uint64_t input = read32(p) + (static_cast<uint64_t>(read32(p + size - 4)) << 32);
+        uint64_t keyed = input ^ (read64(secret + 16) ^ read64(secret + 24));
+        
+        hash = mul128(keyed, XXH64_PRIME1 + (static_cast<uint64_t>(size) << 2));
+        hash.high += hash.low << 1;
+        hash.low ^= hash.high >> 3;
+        hash.low ^= hash.low >> 35;
+        hash.low *= XXH3_PRIME_MX2;
+        hash.low ^= hash.low >> 28;
+        hash.high = xxh3_avalanche(hash.high);
+    } else if (size > 0) {
+        uint32_t combined_lo = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[size >> 1]) << 24) |
+                               p[size - 1] | (static_cast<uint32_t>(size) << 8);
+        uint32_t combined_hi = rotl32(__builtin_bswap32(combined_lo), 13);
+        hash.low = xxh64_avalanche(combined_lo ^ static_cast<uint64_t>(read32(secret) ^ read32(secret + 4)));
+        hash.high = xxh64_avalanche(combined_hi ^ static_cast<uint64_t>(read32(secret + 8) ^ read32(secret + 12)));
+    } else {
+        hash.low = xxh64_avalanche(read64(secret + 64) ^ read64(secret + 72));
+        hash.high = xxh64_avalanche(read64(secret + 80) ^ read64(secret + 88));
+    }
+    
+    return hash;
+}
+
+Checksum::Hash128 xxh3_128_medium(const uint8_t* p, size_t size) {
+    const uint8_t* secret = XXH3_SECRET;
+    Checksum::Hash128 acc = {size * XXH64_PRIME1, 0};
+    
+    if (size <= 128) {
+        // Pairs of 16-byte lanes from both ends, innermost first
+        for (size_t i = (size - 1) / 32 + 1; i-- > 0;) {
+            xxh3_mix32(acc, p + 16 * i, p + size - 16 * (i + 1), secret + 32 * i);
+        }
+    } else {
+        for (size_t i = 32; i < 160; i += 32) {
+            xxh3_mix32(acc, p + i - 32, p + i - 16, secret + i - 32);
+        }
+        acc.low = xxh3_avalanche(acc.low);
+        acc.high = xxh3_avalanche(acc.high);
+        for (size_t i = 160; i <= size; i += 32) {
+            xxh3_mix32(acc, p + i - 32, p + i - 16, secret + 3 + i - 160);
+        }
+        xxh3_mix32(acc, p + size - 16, p + size - 32, secret + 136 - 17 - 16);
+    }
+    
+    Checksum::Hash128 hash;
+    hash.low = xxh3_avalanche(acc.low + acc.high);
+    hash.high = 0 - xxh3_avalanche(acc.low * XXH64_PRIME1 + acc.high * XXH64_PRIME4 + size * XXH64_PRIME2);
+    return hash;
+}
+
+// One 64-byte stripe into the eight accumulators
+inline void xxh3_accumulate(uint64_t* acc, const uint8_t* input, const uint8_t* secret) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+        uint64_t value = read64(input + lane * 8);
+        uint64_t keyed = value ^ read64(secret + lane * 8);
+        acc[lane ^ 1] += value;
+        acc[lane] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+    }
+}
+
+inline void xxh3_scramble(uint64_t* acc, const uint8_t* secret) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+        uint64_t value = acc[lane];
+        value ^= value >> 47;
+        value ^= read64(secret + lane * 8);
+        acc[lane] = value * XXH32_PRIME1;
+    }
+}
+
+inline uint64_t xxh3_merge(const uint64_t* acc, const uint8_t* secret, uint64_t start) {
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; ++i) {
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+Checksum::Hash128 xxh3_128_long(const uint8_t* p, size_t size) {
+    const uint8_t* secret = XXH3_SECRET;
+    uint64_t acc[8] = {XXH32_PRIME3, XXH64_PRIME1, XXH64_PRIME2, XXH64_PRIME3,
+                       XXH64_PRIME4, XXH32_PRIME2, XXH64_PRIME5, XXH32_PRIME1};
+    
+    // Blocks of 16 stripes, each stripe keyed 8 bytes further into the secret
+    const size_t stripes_per_block = (XXH3_SECRET_SIZE - XXH3_STRIPE_LEN) / XXH3_SECRET_CONSUME_RATE;
+    const size_t block_len = XXH3_STRIPE_LEN * stripes_per_block;
+    const size_t blocks = (size - 1) / block_len;
+    
+    for (size_t n = 0; n < blocks; ++n) {
+        for (size_t s = 0; s < stripes_per_block; ++s) {
+            xxh3_accumulate(acc, p + n * block_len + s * XXH3_STRIPE_LEN, secret + s * XXH3_SECRET_CONSUME_RATE);
+        }
+        xxh3_scramble(acc, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN);
+    }
+    
+    const size_t stripes = ((size - 1) - block_len * blocks) / XXH3_STRIPE_LEN;
+    for (size_t s = 0; s < stripes; ++s) {
+        xxh3_accumulate(acc, p + blocks * block_len + s * XXH3_STRIPE_LEN, secret + s * XXH3_SECRET_CONSUME_RATE);
+    }
+    xxh3_accumulate(acc, p + size - XXH3_STRIPE_LEN, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - 7);
+    
+    Checksum::Hash128 hash;
+    hash.low = xxh3_merge(acc, secret + 11, size * XXH64_PRIME1);
+    hash.high = xxh3_merge(acc, secret + XXH3_SECRET_SIZE - sizeof(acc) - 11, ~(size * XXH64_PRIME2));
+    return hash;
+}
+
+} // namespace
+
+uint32_t Checksum::crc32c(const void* data, size_t size, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    
+    if (has_hardware_crc32c()) {
+        return crc32c_hardware(bytes, size, crc);
+    }
+    return crc32c_software(bytes, size, crc);
+}
+
+bool Checksum::has_hardware_crc32c() {
+#ifdef DFS_HAVE_X86_CRC32C
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint64_t Checksum::xxh64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint64_t hash;
+    
+    if (size >= 32) {
+        // Four independent lanes over 32-byte stripes
+        uint64_t v1 = seed + XXH64_PRIME1 + XXH64_PRIME2;
+        uint64_t v2 = seed + XXH64_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH64_PRIME1;
+        
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxh64_merge_round(hash, v1);
+        hash = xxh64_merge_round(hash, v2);
+        hash = xxh64_merge_round(hash, v3);
+        hash = xxh64_merge_round(hash, v4);
+    } else {
+        hash = seed + XXH64_PRIME5;
+    }
+    
+    hash += static_cast<uint64_t>(size);
+    
+    while (p + 8 <= end) {
+        hash ^= xxh64_round(0, read64(p));
+        hash = rotl64(hash, 27) * XXH64_PRIME1 + XXH64_PRIME4;
+        p += 8;
+    }
+    
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * XXH64_PRIME1;
+        hash = rotl64(hash, 23) * XXH64_PRIME2 + XXH64_PRIME3;
+        p += 4;
+    }
+    
+    while (p < end) {
+        hash ^= (*p) * XXH64_PRIME5;
+        hash = rotl64(hash, 11) * XXH64_PRIME1;
+        ++p;
+    }
+    
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= XXH64_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH64_PRIME3;
+    hash ^= hash >> 32;
+    
+    return hash;
+}
+
+uint32_t Checksum::crc32c_software(const uint8_t* data, size_t size, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC32C_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef DFS_HAVE_X86_CRC32C
+__attribute__((target("sse4.2")))
+uint32_t Checksum::crc32c_hardware(const uint8_t* data, size_t size, uint32_t crc) {
+#ifdef __x86_64__
+    uint64_t crc64 = ~crc;
+    
+    // Eight bytes per instruction, then the tail a byte at a time
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += sizeof(word);
+        size -= sizeof(word);
+    }
+    
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+#else
+    uint32_t crc32 = ~crc;
+    
+    // The 64-bit instruction only exists in long mode; four bytes at a time here
+    while (size >= sizeof(uint32_t)) {
+        uint32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc32 = _mm_crc32_u32(crc32, word);
+        data += sizeof(word);
+        size -= sizeof(word);
+    }
+#endif
+    while (size > 0) {
+        crc32 = _mm_crc32_u8(crc32, *data++);
+        --size;
+    }
+    
+    return ~crc32;
+}
+#else
+uint32_t Checksum::crc32c_hardware(const uint8_t* data, size_t size, uint32_t crc) {
+    return crc32c_software(data, size, crc);
+}
+#endif
+
+uint32_t Checksum::xxh32(const void* data, size_t size, uint32_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+    uint32_t hash;
+    
+    if (size >= 16) {
+        // Four independent lanes over 16-byte stripes
+        uint32_t v1 = seed + XXH32_PRIME1 + XXH32_PRIME2;
+        uint32_t v2 = seed + XXH32_PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH32_PRIME1;
+        
+        const uint8_t* limit = end - 16;
+        do {
+            v1 = xxh32_round(v1, read32(p));
+            v2 = xxh32_round(v2, read32(p + 4));
+            v3 = xxh32_round(v3, read32(p + 8));
+            v4 = xxh32_round(v4, read32(p + 12));
+            p += 16;
+        } while (p <= limit);
+        
+        hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        hash = seed + XXH32_PRIME5;
+    }
+    
+    hash += static_cast<uint32_t>(size);
+    
+    while (p + 4 <= end) {
+        hash += read32(p) * XXH32_PRIME3;
+        hash = rotl32(hash, 17) * XXH32_PRIME4;
+        p += 4;
+    }
+    
+    while (p < end) {
+        hash += (*p) * XXH32_PRIME5;
+        hash = rotl32(hash, 11) * XXH32_PRIME1;
+        ++p;
+    }
+    
+    // Final avalanche
+    hash ^= hash >> 15;
+    hash *= XXH32_PRIME2;
+    hash ^= hash >> 13;
+    hash *= XXH32_PRIME3;
+    hash ^= hash >> 16;
+    
+    return hash;
+}
+
+Checksum::Hash128 Checksum::xxh3_128(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    
+    if (size <= 16) {
+        return xxh3_128_short(p, size);
+    }
+    if (size <= XXH3_MIDSIZE_MAX) {
+        return xxh3_128_medium(p, size);
+    }
+    return xxh3_128_long(p, size);
+}
+
+} // namespace utils
+} // namespace dfs
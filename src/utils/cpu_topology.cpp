@@ -0,0 +1,197 @@
+#include "utils/cpu_topology.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace dfs {
+namespace utils {
+
+namespace {
+
+// CPUs the process may run on, ascending
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Kernel node ids present under /sys/devices/system/node, ascending
+std::vector<int> sysfs_node_ids() {
+    std::vector<int> ids;
+#ifdef __linux__
+    DIR* directory = opendir("/sys/devices/system/node");
+    if (!directory) {
+        return ids;
+    }
+    while (dirent* entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            ids.push_back(std::atoi(name.c_str() + 4));
+        }
+    }
+    closedir(directory);
+    std::sort(ids.begin(), ids.end());
+#endif
+    return ids;
+}
+
+} // namespace
+
+const CpuTopology& CpuTopology::get_instance() {
+    static const CpuTopology topology;
+    return topology;
+}
+
+CpuTopology::CpuTopology() {
+    std::vector<int> allowed = allowed_cpus();
+    
+    for (int id : sysfs_node_ids()) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        std::string list;
+        if (!file || !std::getline(file, list)) {
+            continue;
+        }
+        
+        // Memory-only nodes and nodes outside our affinity mask get no workers
+        Node node{id, {}};
+        for (int cpu : parse_cpu_list(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty()) {
+            nodes_.push_back(std::move(node));
+        }
+    }
+    
+    if (nodes_.empty()) {
+        nodes_.push_back(Node{0, allowed});
+    }
+    
+    for (size_t index = 0; index < nodes_.size(); ++index) {
+        const Node& node = nodes_[index];
+        if (static_cast<size_t>(node.id) >= id_to_node_.size()) {
+            id_to_node_.resize(node.id + 1, 0);
+        }
+        id_to_node_[node.id] = index;
+        
+        for (int cpu : node.cpus) {
+            if (static_cast<size_t>(cpu) >= cpu_to_node_.size()) {
+                cpu_to_node_.resize(cpu + 1, 0);
+            }
+            cpu_to_node_[cpu] = index;
+        }
+    }
+}
+
+size_t CpuTopology::node_of_cpu(int cpu) const {
+    if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_to_node_.size()) {
+        return 0;
+    }
+    return cpu_to_node_[cpu];
+}
+
+size_t CpuTopology::current_node() const {
+    if (nodes_.size() == 1) {
+        return 0;
+    }
+#ifdef __linux__
+    return node_of_cpu(sched_getcpu());
+#else
+    return 0;
+#endif
+}
+
+int CpuTopology::node_of_address(const void* address) const {
+#if defined(__linux__) && defined(SYS_move_pages)
+    if (nodes_.size() == 1) {
+        return 0;
+    }
+    
+    // move_pages with no target nodes only reports where each page lives
+    long page_size = sysconf(_SC_PAGESIZE);
+    void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(address) &
+                                         ~static_cast<uintptr_t>(page_size - 1));
+    int status = -1;
+    if (syscall(SYS_move_pages, 0, 1UL, &page, nullptr, &status, 0) != 0 || status < 0 ||
+        static_cast<size_t>(status) >= id_to_node_.size()) {
+        return -1;
+    }
+    return static_cast<int>(id_to_node_[status]);
+#else
+    (void)address;
+    return nodes_.size() == 1 ? 0 : -1;
+#endif
+}
+
+bool CpuTopology::pin_current_thread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return !cpus.empty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+std::vector<int> CpuTopology::parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t position = 0;
+    
+    while (position < list.size()) {
+        size_t end = list.find(',', position);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        
+        std::string range = list.substr(position, end - position);
+        size_t dash = range.find('-');
+        if (!range.empty() && range.find_first_not_of("0123456789-\n ") == std::string::npos) {
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        position = end + 1;
+    }
+    
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+} // namespace utils
+} // namespace dfs
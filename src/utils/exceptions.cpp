@@ -1,6 +1,7 @@
 #include "utils/exceptions.h"
 #include <sstream>
 #include <iomanip>
+#include <iostream>
 
 namespace dfs {
 namespace utils {
@@ -1,27 +1,221 @@
 #include "utils/logger.h"
+#include "utils/lz4.h"
 #include <iostream>
-#include <iomanip>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <cstddef>
+#include <time.h>
 
 namespace dfs {
 namespace utils {
 
+namespace {
+
+// Records formatted per batch; bounds the latency a batch adds
+constexpr size_t WORKER_BATCH_SIZE = 256;
+
+// Upper bound on a sleep that missed its wakeup
+constexpr std::chrono::milliseconds WORKER_IDLE_WAIT(50);
+
+// How often the worker collects records idle threads left staged
+constexpr std::chrono::milliseconds STAGING_SWEEP_INTERVAL(10);
+
+// Small sequential ids, assigned on a thread's first record, instead of
+// hashing std::thread::id every time; they also read better in the logs
+std::atomic<uint64_t> next_thread_id(1);
+
+uint64_t current_thread_id() {
+    thread_local uint64_t id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+// Coarsest tick accepted for timestamps: 4ms covers kernels built with
+// HZ=250, the common default, as well as HZ=1000
+constexpr long MAX_COARSE_RESOLUTION_NS = 4000000;
+
+// CLOCK_REALTIME_COARSE is read from the vDSO without touching the clock
+// source, but only advances once per kernel tick. Timestamps may therefore
+// lag by up to one tick; records are still written in order, so a few
+// milliseconds of precision is traded for the cheaper read
+bool coarse_clock_usable() {
+#ifdef CLOCK_REALTIME_COARSE
+    timespec resolution;
+    return clock_getres(CLOCK_REALTIME_COARSE, &resolution) == 0 &&
+           resolution.tv_sec == 0 && resolution.tv_nsec <= MAX_COARSE_RESOLUTION_NS;
+#else
+    return false;
+#endif
+}
+
+std::chrono::system_clock::time_point log_clock_now() {
+#ifdef CLOCK_REALTIME_COARSE
+    static const bool use_coarse = coarse_clock_usable();
+    if (use_coarse) {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec)));
+    }
+#endif
+    return std::chrono::system_clock::now();
+}
+
+// Formatted "date time" of one second; localtime_r and strftime dominate
+// formatting, and consecutive records almost always share the second
+struct SecondText {
+    std::time_t second = -1;
+    char text[32];
+    size_t length = 0;
+};
+
+const SecondText& format_second(std::time_t second, bool utc) {
+    thread_local SecondText local_text;
+    thread_local SecondText utc_text;
+    SecondText& cached = utc ? utc_text : local_text;
+    
+    if (cached.second != second) {
+        std::tm parts;
+        if (utc) {
+            gmtime_r(&second, &parts);
+        } else {
+            localtime_r(&second, &parts);
+        }
+        cached.length = std::strftime(cached.text, sizeof(cached.text),
+                                      utc ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S", &parts);
+        cached.second = second;
+    }
+    return cached;
+}
+
+// Append "<date time>.mmm" for a timestamp
+void append_timestamp(std::string& out, std::chrono::system_clock::time_point timestamp, bool utc) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+    std::time_t second = static_cast<std::time_t>(ms / 1000);
+    int millis = static_cast<int>(ms % 1000);
+    if (millis < 0) {
+        second -= 1;
+        millis += 1000;
+    }
+    
+    const SecondText& text = format_second(second, utc);
+    out.append(text.text, text.length);
+    
+    char fraction[4] = {'.', static_cast<char>('0' + millis / 100),
+                        static_cast<char>('0' + millis / 10 % 10), static_cast<char>('0' + millis % 10)};
+    out.append(fraction, sizeof(fraction));
+}
+
+const char* base_name(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// First bytes of a BINARY format log file
+constexpr char BINARY_LOG_MAGIC[8] = {'D', 'F', 'S', 'L', 'O', 'G', '1', '\n'};
+
+// Suffix of a rotated file waiting for the rotation thread
+const std::string PENDING_SUFFIX = ".pending";
+
+// Copy a record, skipping the unused tail of its message buffer
+void copy_entry(Logger::LogEntry& destination, const Logger::LogEntry& source) {
+    std::memcpy(static_cast<void*>(&destination), &source,
+                offsetof(Logger::LogEntry, message) + source.length);
+}
+
+template<typename T>
+void append_raw(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+void append_json_string(std::string& out, const char* text, size_t size) {
+    out += '"';
+    for (size_t i = 0; i < size; ++i) {
+        char c = text[i];
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+                break;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
 // Static instance management
 std::unique_ptr<Logger> Logger::instance_ = nullptr;
+std::atomic<Logger*> Logger::current_instance_(nullptr);
 std::mutex Logger::instance_mutex_;
+std::atomic<uint64_t> Logger::next_instance_id_(0);
+thread_local std::vector<Logger::StagingHandle> Logger::staging_handles_;
+
+// Configuration implementation
+Logger::LoggerConfig::LoggerConfig(Level min_lvl, const std::string& file_path, bool console, bool file,
+                                   bool async, size_t max_size, uint32_t max_files,
+                                   std::chrono::seconds rotation, size_t capacity, OverflowPolicy overflow,
+                                   FileFormat format, size_t buffer_size, bool compress, size_t staging)
+    : min_level(min_lvl), log_file_path(file_path), enable_console_output(console),
+      enable_file_output(file), enable_async_logging(async), max_log_file_size(max_size),
+      max_log_files(max_files), log_rotation_interval(rotation), queue_capacity(capacity),
+      overflow_policy(overflow), file_format(format), write_buffer_size(buffer_size),
+      compress_rotated(compress), staging_records(staging) {}
 
 // LogEntry implementation
-Logger::LogEntry::LogEntry(Level lvl, const std::string& msg, const std::string& file,
-                          uint32_t line, const std::string& func)
-    : level(lvl), message(msg), source_file(file), line_number(line), 
-      function_name(func), timestamp(std::chrono::system_clock::now()),
-      thread_id(std::this_thread::get_id()) {}
+Logger::LogEntry::LogEntry()
+    : level(Level::LOG_INFO), line_number(0), source_file(""), function_name(""), format(nullptr),
+      thread_id(0), length(0), truncated(false) {}
+
+void Logger::LogEntry::assign(Level lvl, const std::string& msg, const char* file, uint32_t line,
+                              const char* func) {
+    level = lvl;
+    line_number = line;
+    source_file = file ? file : "";
+    function_name = func ? func : "";
+    format = nullptr;
+    timestamp = log_clock_now();
+    thread_id = current_thread_id();
+    
+    truncated = msg.size() > MESSAGE_CAPACITY;
+    length = static_cast<uint32_t>(std::min(msg.size(), MESSAGE_CAPACITY));
+    std::memcpy(message, msg.data(), length);
+}
+
+void Logger::LogEntry::assign_format(Level lvl, const char* fmt, const char* file, uint32_t line,
+                                     const char* func) {
+    level = lvl;
+    line_number = line;
+    source_file = file ? file : "";
+    function_name = func ? func : "";
+    format = fmt;
+    timestamp = log_clock_now();
+    thread_id = current_thread_id();
+    length = 0;
+    truncated = false;
+}
 
 // Logger implementation
 Logger::Logger(const LoggerConfig& config)
-    : config_(config), current_level_(config.min_level), start_time_(std::chrono::steady_clock::now()) {
+    : config_(config), current_level_(config.min_level), file_size_(0), stop_rotation_(false),
+      worker_sleeping_(false), waiters_(0),
+      enqueued_logs_(0), written_logs_(0), stop_worker_(false), staging_capacity_(0),
+      instance_id_(++next_instance_id_), dropped_logs_(0),
+      start_time_(std::chrono::steady_clock::now()) {
     
     // Initialize statistics
     total_logs_ = 0;
@@ -33,91 +227,321 @@ Logger::Logger(const LoggerConfig& config)
     if (config_.enable_file_output && !config_.log_file_path.empty()) {
         // Create directory if it doesn't exist
         std::filesystem::path log_path(config_.log_file_path);
-        std::filesystem::create_directories(log_path.parent_path());
+        if (log_path.has_parent_path()) {
+            std::filesystem::create_directories(log_path.parent_path());
+        }
         
-        log_file_.open(config_.log_file_path, std::ios::app);
+        open_log_file();
         if (!log_file_.is_open()) {
             std::cerr << "Failed to open log file: " << config_.log_file_path << std::endl;
         }
+        
+        // Finish rotations a previous process left pending
+        std::error_code error;
+        std::string pending_prefix = log_path.filename().string() + ".";
+        std::filesystem::path log_dir = log_path.has_parent_path() ? log_path.parent_path() : ".";
+        for (const auto& file : std::filesystem::directory_iterator(log_dir, error)) {
+            std::string name = file.path().filename().string();
+            if (name.size() > pending_prefix.size() + PENDING_SUFFIX.size() &&
+                name.compare(0, pending_prefix.size(), pending_prefix) == 0 &&
+                name.compare(name.size() - PENDING_SUFFIX.size(), PENDING_SUFFIX.size(), PENDING_SUFFIX) == 0) {
+                pending_rotations_.push_back(file.path().string());
+            }
+        }
+        std::sort(pending_rotations_.begin(), pending_rotations_.end());
+        
+        rotation_thread_ = std::thread(&Logger::rotation_thread_function, this);
     }
     
     // Start worker thread if async logging is enabled
     if (config_.enable_async_logging) {
-        stop_worker_ = false;
+        ring_ = std::make_unique<MpscRing<LogEntry>>(std::max<size_t>(config_.queue_capacity, 2));
+        
+        // A staged batch must fit in the ring with room to spare
+        staging_capacity_ = std::min(config_.staging_records, ring_->capacity() / 2);
         worker_thread_ = std::thread(&Logger::worker_thread_function, this);
     }
 }
 
 Logger::~Logger() {
-    // Stop worker thread
-    if (config_.enable_async_logging) {
+    // Hand over staged records and detach the buffers from this logger
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        for (auto& buffer : staging_buffers_) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            if (buffer->count > 0) {
+                drain_staging_locked(*buffer, false);
+            }
+            buffer->owner = nullptr;
+        }
+        staging_buffers_.clear();
+    }
+    
+    // Stop worker thread; it drains the ring before exiting
+    if (worker_thread_.joinable()) {
         {
             std::lock_guard<std::mutex> lock(queue_mutex_);
             stop_worker_ = true;
         }
         queue_condition_.notify_all();
-        
-        if (worker_thread_.joinable()) {
-            worker_thread_.join();
-        }
+        space_condition_.notify_all();
+        worker_thread_.join();
     }
     
     // Close log file
     if (log_file_.is_open()) {
         log_file_.close();
     }
+    
+    // Let queued rotations finish so no .pending file is left behind
+    if (rotation_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(rotation_mutex_);
+            stop_rotation_ = true;
+        }
+        rotation_condition_.notify_all();
+        rotation_thread_.join();
+    }
 }
 
-void Logger::log(Level level, const std::string& message, const std::string& file,
-                uint32_t line, const std::string& function) {
+void Logger::log(Level level, const std::string& message, const char* file,
+                uint32_t line, const char* function) {
     
     // Check if we should log this level
-    if (level < current_level_.load()) {
+    if (!is_enabled(level)) {
         return;
     }
     
-    LogEntry entry(level, message, file, line, function);
-    
+    auto fill = [&](LogEntry& entry) {
+        entry.assign(level, message, file, line, function);
+    };
+    using Fill = decltype(fill);
+    submit(level, [](LogEntry& entry, const void* context) {
+        (*static_cast<const Fill*>(context))(entry);
+    }, &fill);
+}
+
+void Logger::submit(Level level, EntryFill fill, const void* context) {
     // Update statistics
     total_logs_++;
     logs_by_level_[static_cast<int>(level)]++;
     
-    if (config_.enable_async_logging) {
-        // Add to queue for async processing
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            log_queue_.push(entry);
-        }
-        queue_condition_.notify_one();
+    if (staging_capacity_ > 0) {
+        stage(level, fill, context);
+    } else if (ring_) {
+        enqueue(fill, context);
     } else {
         // Process synchronously
-        write_log_entry(entry);
+        LogEntry entry;
+        fill(entry, context);
+        
+        OutputBatch batch;
+        append_entry(entry, batch);
+        write_batch(batch);
+    }
+}
+
+bool Logger::enqueue(EntryFill fill, const void* context) {
+    auto fill_slot = [fill, context](LogEntry& entry) {
+        fill(entry, context);
+    };
+    
+    if (ring_->try_push(fill_slot)) {
+        enqueued_logs_++;
+        wake_worker();
+        return true;
+    }
+    
+    if (config_.overflow_policy == OverflowPolicy::DROP) {
+        dropped_logs_++;
+        return false;
+    }
+    
+    // Backpressure: wait for the worker to free slots
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    waiters_++;
+    bool pushed = false;
+    while (!(pushed = ring_->try_push(fill_slot)) && !stop_worker_) {
+        queue_condition_.notify_one();
+        space_condition_.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    waiters_--;
+    
+    if (!pushed) {
+        dropped_logs_++;
+        return false;
+    }
+    enqueued_logs_++;
+    return true;
+}
+
+Logger::StagingBuffer& Logger::staging_buffer() {
+    std::vector<StagingHandle>& handles = staging_handles_;
+    
+    // A thread usually logs to one or two loggers, so a scan beats a map
+    for (StagingHandle& handle : handles) {
+        if (handle.logger_id == instance_id_) {
+            return *handle.buffer;
+        }
+    }
+    
+    // First record from this thread to this logger; forget buffers of
+    // loggers that were destroyed meanwhile
+    handles.erase(std::remove_if(handles.begin(), handles.end(), [](StagingHandle& handle) {
+        std::lock_guard<std::mutex> lock(handle.buffer->mutex);
+        return handle.buffer->owner == nullptr;
+    }), handles.end());
+    
+    auto buffer = std::make_shared<StagingBuffer>();
+    buffer->entries.resize(staging_capacity_);
+    buffer->owner = this;
+    {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        staging_buffers_.push_back(buffer);
+    }
+    
+    handles.emplace_back();
+    handles.back().logger_id = instance_id_;
+    handles.back().buffer = std::move(buffer);
+    return *handles.back().buffer;
+}
+
+void Logger::stage(Level level, EntryFill fill, const void* context) {
+    StagingBuffer& buffer = staging_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    fill(buffer.entries[buffer.count++], context);
+    
+    // Warnings and errors go out at once, so a crash cannot strand them
+    if (buffer.count == buffer.entries.size() || level >= Level::LOG_WARN) {
+        drain_staging_locked(buffer, false);
     }
 }
 
-void Logger::debug(const std::string& message, const std::string& file,
-                  uint32_t line, const std::string& function) {
-    log(Level::DEBUG, message, file, line, function);
+void Logger::drain_staging_locked(StagingBuffer& buffer, bool from_worker) {
+    size_t count = buffer.count;
+    bool pushed = ring_->try_push_batch(count, [&buffer](LogEntry& slot, size_t i) {
+        copy_entry(slot, buffer.entries[i]);
+    });
+    
+    if (pushed) {
+        enqueued_logs_ += count;
+        buffer.count = 0;
+        if (!from_worker) {
+            wake_worker();
+        }
+        return;
+    }
+    
+    // The worker must not wait on its own ring; the owner or a later sweep retries
+    if (from_worker) {
+        return;
+    }
+    
+    // Not enough room for the batch: apply the overflow policy per record
+    for (size_t i = 0; i < count; ++i) {
+        enqueue([](LogEntry& slot, const void* staged) {
+            copy_entry(slot, *static_cast<const LogEntry*>(staged));
+        }, &buffer.entries[i]);
+    }
+    buffer.count = 0;
 }
 
-void Logger::info(const std::string& message, const std::string& file,
-                 uint32_t line, const std::string& function) {
-    log(Level::INFO, message, file, line, function);
+void Logger::sweep_staging(bool from_worker) {
+    // The worker only takes locks it can get at once: a producer may hold
+    // its buffer while waiting for the worker to free ring slots
+    std::unique_lock<std::mutex> lock(staging_mutex_, std::defer_lock);
+    if (from_worker) {
+        if (!lock.try_lock()) {
+            return;
+        }
+    } else {
+        lock.lock();
+    }
+    
+    for (auto it = staging_buffers_.begin(); it != staging_buffers_.end();) {
+        StagingBuffer& buffer = **it;
+        std::unique_lock<std::mutex> buffer_lock(buffer.mutex, std::defer_lock);
+        if (from_worker) {
+            buffer_lock.try_lock();
+        } else {
+            buffer_lock.lock();
+        }
+        
+        if (buffer_lock.owns_lock()) {
+            if (buffer.count > 0) {
+                drain_staging_locked(buffer, from_worker);
+            }
+            if (buffer.retired && buffer.count == 0) {
+                buffer_lock.unlock();
+                it = staging_buffers_.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
 }
 
-void Logger::warn(const std::string& message, const std::string& file,
-                 uint32_t line, const std::string& function) {
-    log(Level::WARN, message, file, line, function);
+Logger::StagingHandle::StagingHandle(StagingHandle&& other) noexcept
+    : logger_id(other.logger_id), buffer(std::move(other.buffer)) {}
+
+Logger::StagingHandle& Logger::StagingHandle::operator=(StagingHandle&& other) noexcept {
+    if (this != &other) {
+        release();
+        logger_id = other.logger_id;
+        buffer = std::move(other.buffer);
+    }
+    return *this;
 }
 
-void Logger::error(const std::string& message, const std::string& file,
-                  uint32_t line, const std::string& function) {
-    log(Level::ERROR, message, file, line, function);
+void Logger::StagingHandle::release() {
+    if (!buffer) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (buffer->owner && buffer->count > 0) {
+        buffer->owner->drain_staging_locked(*buffer, false);
+    }
+    buffer->retired = true;
+}
+
+Logger::StagingHandle::~StagingHandle() {
+    release();
 }
 
-void Logger::critical(const std::string& message, const std::string& file,
-                     uint32_t line, const std::string& function) {
-    log(Level::CRITICAL, message, file, line, function);
+void Logger::wake_worker() {
+    // Pairs with the fence in worker_thread_function: either the worker sees
+    // the published record, or this sees the worker asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker_sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_condition_.notify_one();
+    }
+}
+
+void Logger::debug(const std::string& message, const char* file,
+                  uint32_t line, const char* function) {
+    log(Level::LOG_DEBUG, message, file, line, function);
+}
+
+void Logger::info(const std::string& message, const char* file,
+                 uint32_t line, const char* function) {
+    log(Level::LOG_INFO, message, file, line, function);
+}
+
+void Logger::warn(const std::string& message, const char* file,
+                 uint32_t line, const char* function) {
+    log(Level::LOG_WARN, message, file, line, function);
+}
+
+void Logger::error(const std::string& message, const char* file,
+                  uint32_t line, const char* function) {
+    log(Level::LOG_ERROR, message, file, line, function);
+}
+
+void Logger::critical(const std::string& message, const char* file,
+                     uint32_t line, const char* function) {
+    log(Level::LOG_CRITICAL, message, file, line, function);
 }
 
 void Logger::log_transaction(uint64_t tx_id, const std::string& operation, const std::string& details) {
@@ -168,12 +592,54 @@ const Logger::LoggerConfig& Logger::get_config() const {
 }
 
 void Logger::flush() {
+    if (staging_capacity_ > 0) {
+        sweep_staging(false);
+    }
+    
+    // Wait until the worker has written everything queued before this call
+    if (ring_ && worker_thread_.joinable()) {
+        uint64_t target = enqueued_logs_.load();
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        waiters_++;
+        while (written_logs_.load() < target && !stop_worker_) {
+            queue_condition_.notify_one();
+            space_condition_.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        waiters_--;
+    }
+    
+    std::lock_guard<std::mutex> lock(file_mutex_);
     if (log_file_.is_open()) {
         log_file_.flush();
     }
 }
 
 void Logger::rotate_logs() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    begin_rotation_locked();
+}
+
+void Logger::open_log_file() {
+    std::ios::openmode mode = std::ios::app;
+    if (config_.file_format == FileFormat::BINARY) {
+        mode |= std::ios::binary;
+    }
+    log_file_.open(config_.log_file_path, mode);
+    
+    std::error_code error;
+    file_size_ = std::filesystem::file_size(config_.log_file_path, error);
+    if (error) {
+        file_size_ = 0;
+    }
+    file_opened_at_ = std::chrono::steady_clock::now();
+    
+    if (log_file_.is_open() && file_size_ == 0 && config_.file_format == FileFormat::BINARY) {
+        log_file_.write(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+        file_size_ = sizeof(BINARY_LOG_MAGIC);
+    }
+}
+
+void Logger::begin_rotation_locked() {
     if (!config_.enable_file_output || config_.log_file_path.empty()) {
         return;
     }
@@ -183,37 +649,95 @@ void Logger::rotate_logs() {
         log_file_.close();
     }
     
-    // Rotate existing log files
+    // Only a rename here; shifting and compression run on the rotation thread
+    uint64_t stamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::string pending = config_.log_file_path + "." + std::to_string(stamp) + PENDING_SUFFIX;
+    
+    std::error_code error;
+    std::filesystem::rename(config_.log_file_path, pending, error);
+    if (!error) {
+        std::lock_guard<std::mutex> lock(rotation_mutex_);
+        pending_rotations_.push_back(pending);
+        rotation_condition_.notify_one();
+    }
+    
+    // Open new log file
+    open_log_file();
+}
+
+void Logger::rotation_thread_function() {
+    std::unique_lock<std::mutex> lock(rotation_mutex_);
+    while (true) {
+        rotation_condition_.wait(lock, [this] {
+            return stop_rotation_ || !pending_rotations_.empty();
+        });
+        if (pending_rotations_.empty()) {
+            break;
+        }
+        
+        std::string pending = std::move(pending_rotations_.front());
+        pending_rotations_.pop_front();
+        lock.unlock();
+        
+        try {
+            finish_rotation(pending);
+        } catch (const std::exception& e) {
+            // Cannot log through ourselves here
+            std::cerr << "Log rotation of " << pending << " failed: " << e.what() << std::endl;
+        }
+        
+        lock.lock();
+    }
+}
+
+void Logger::finish_rotation(const std::string& pending_path) {
     std::filesystem::path log_path(config_.log_file_path);
     std::filesystem::path log_dir = log_path.parent_path();
     std::string log_name = log_path.stem().string();
     std::string log_ext = log_path.extension().string();
     
-    // Move existing files
-    for (int i = config_.max_log_files - 1; i > 0; --i) {
-        std::filesystem::path old_file = log_dir / (log_name + "." + std::to_string(i) + log_ext);
-        std::filesystem::path new_file = log_dir / (log_name + "." + std::to_string(i + 1) + log_ext);
-        
-        if (std::filesystem::exists(old_file)) {
-            if (i == config_.max_log_files - 1) {
-                std::filesystem::remove(old_file);
-            } else {
-                std::filesystem::rename(old_file, new_file);
+    auto rotated_file = [&](int index, const char* suffix) {
+        return log_dir / (log_name + "." + std::to_string(index) + log_ext + suffix);
+    };
+    
+    // Move existing files, compressed or not
+    for (int i = static_cast<int>(config_.max_log_files) - 1; i > 0; --i) {
+        for (const char* suffix : {"", ".lz4"}) {
+            std::filesystem::path old_file = rotated_file(i, suffix);
+            if (std::filesystem::exists(old_file)) {
+                if (i == static_cast<int>(config_.max_log_files) - 1) {
+                    std::filesystem::remove(old_file);
+                } else {
+                    std::filesystem::rename(old_file, rotated_file(i + 1, suffix));
+                }
             }
         }
     }
     
-    // Move current log to .1
-    if (std::filesystem::exists(log_path)) {
-        std::filesystem::path rotated_file = log_dir / (log_name + ".1" + log_ext);
-        std::filesystem::rename(log_path, rotated_file);
+    if (!config_.compress_rotated) {
+        std::filesystem::rename(pending_path, rotated_file(1, ""));
+        return;
     }
     
-    // Open new log file
-    log_file_.open(config_.log_file_path, std::ios::app);
+    // Compress to a temporary name so a crash never leaves a partial .lz4
+    std::filesystem::path target = rotated_file(1, ".lz4");
+    std::filesystem::path partial = target;
+    partial += ".tmp";
+    {
+        std::ifstream in(pending_path, std::ios::binary);
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!in.is_open() || !out.is_open()) {
+            throw std::runtime_error("cannot open files for compression");
+        }
+        Lz4::compress_frame(in, out);
+    }
+    std::filesystem::rename(partial, target);
+    std::filesystem::remove(pending_path);
 }
 
 void Logger::close() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
     if (log_file_.is_open()) {
         log_file_.close();
     }
@@ -229,159 +753,360 @@ Logger::LoggerStats Logger::get_stats() const {
     stats.critical_logs = logs_by_level_[4];
     stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start_time_);
-    
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        stats.queue_size = log_queue_.size();
-    }
-    
+    stats.queue_size = ring_ ? ring_->size() : 0;
+    stats.dropped_logs = dropped_logs_.load();
     stats.async_enabled = config_.enable_async_logging;
     return stats;
 }
 
 Logger* Logger::get_instance() {
+    Logger* logger = current_instance_.load(std::memory_order_acquire);
+    if (logger) {
+        return logger;
+    }
+    
     std::lock_guard<std::mutex> lock(instance_mutex_);
     if (!instance_) {
         // Create default instance
         LoggerConfig default_config;
         instance_ = std::make_unique<Logger>(default_config);
     }
+    current_instance_.store(instance_.get(), std::memory_order_release);
     return instance_.get();
 }
 
 void Logger::set_instance(std::unique_ptr<Logger> logger) {
     std::lock_guard<std::mutex> lock(instance_mutex_);
     instance_ = std::move(logger);
+    current_instance_.store(instance_.get(), std::memory_order_release);
 }
 
 void Logger::shutdown() {
     std::lock_guard<std::mutex> lock(instance_mutex_);
+    current_instance_.store(nullptr, std::memory_order_release);
     instance_.reset();
 }
 
-std::string Logger::level_to_string(Level level) const {
+const char* Logger::level_to_string(Level level) const {
     switch (level) {
-        case Level::DEBUG: return "DEBUG";
-        case Level::INFO: return "INFO";
-        case Level::WARN: return "WARN";
-        case Level::ERROR: return "ERROR";
-        case Level::CRITICAL: return "CRITICAL";
+        case Level::LOG_DEBUG: return "DEBUG";
+        case Level::LOG_INFO: return "INFO";
+        case Level::LOG_WARN: return "WARN";
+        case Level::LOG_ERROR: return "ERROR";
+        case Level::LOG_CRITICAL: return "CRITICAL";
         default: return "UNKNOWN";
     }
 }
 
-std::string Logger::format_log_entry(const LogEntry& entry) const {
-    std::ostringstream formatted;
-    
-    // Get timestamp
-    auto time_t = std::chrono::system_clock::to_time_t(entry.timestamp);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        entry.timestamp.time_since_epoch()) % 1000;
-    
-    formatted << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    formatted << "." << std::setfill('0') << std::setw(3) << ms.count();
+void Logger::format_log_entry(const LogEntry& entry, std::string& out) const {
+    // Add timestamp
+    append_timestamp(out, entry.timestamp, false);
     
     // Add level
-    formatted << " [" << level_to_string(entry.level) << "]";
+    out += " [";
+    out += level_to_string(entry.level);
+    out += "]";
     
     // Add thread ID
-    formatted << " [T" << entry.thread_id << "]";
+    out += " [T";
+    out += std::to_string(entry.thread_id);
+    out += "]";
     
     // Add source location if available
-    if (!entry.source_file.empty()) {
-        std::filesystem::path file_path(entry.source_file);
-        formatted << " [" << file_path.filename().string();
+    if (entry.source_file[0] != '\0') {
+        out += " [";
+        out += base_name(entry.source_file);
         if (entry.line_number > 0) {
-            formatted << ":" << entry.line_number;
+            out += ":";
+            out += std::to_string(entry.line_number);
         }
-        if (!entry.function_name.empty()) {
-            formatted << ":" << entry.function_name;
+        if (entry.function_name[0] != '\0') {
+            out += ":";
+            out += entry.function_name;
         }
-        formatted << "]";
+        out += "]";
     }
     
     // Add message
-    formatted << " " << entry.message;
-    
-    return formatted.str();
+    out += " ";
+    append_message(entry, out);
 }
 
-void Logger::write_to_file(const LogEntry& entry) {
-    if (!config_.enable_file_output || !log_file_.is_open()) {
-        return;
+void Logger::append_message(const LogEntry& entry, std::string& out) const {
+    if (entry.format) {
+        render_format(entry, out);
+    } else {
+        out.append(entry.message, entry.length);
     }
+    if (entry.truncated) {
+        out += "...";
+    }
+}
+
+void Logger::format_json_entry(const LogEntry& entry, std::string& out, std::string& scratch) const {
+    // RFC 3339 UTC timestamp, which Loki parses without configuration
+    out += "{\"ts\":\"";
+    append_timestamp(out, entry.timestamp, true);
+    out += "Z\",\"level\":\"";
+    out += level_to_string(entry.level);
+    out += "\",\"thread\":";
+    out += std::to_string(entry.thread_id);
     
-    std::lock_guard<std::mutex> lock(file_mutex_);
-    
-    // Check if we need to rotate logs
-    if (log_file_.tellp() > static_cast<std::streampos>(config_.max_log_file_size)) {
-        rotate_logs();
+    if (entry.source_file[0] != '\0') {
+        const char* file = base_name(entry.source_file);
+        out += ",\"file\":";
+        append_json_string(out, file, std::strlen(file));
+        out += ",\"line\":";
+        out += std::to_string(entry.line_number);
+    }
+    if (entry.function_name[0] != '\0') {
+        out += ",\"function\":";
+        append_json_string(out, entry.function_name, std::strlen(entry.function_name));
     }
     
-    log_file_ << format_log_entry(entry) << std::endl;
-    log_file_.flush();
+    scratch.clear();
+    append_message(entry, scratch);
+    out += ",\"msg\":";
+    append_json_string(out, scratch.data(), scratch.size());
+    out += "}\n";
 }
 
-void Logger::write_to_console(const LogEntry& entry) {
-    if (!config_.enable_console_output) {
-        return;
+// BINARY layout, host byte order, after the 8-byte "DFSLOG1\n" file header:
+//   uint32 size of the rest of the record
+//   uint8 level, uint8 flags (bit 0: message truncated)
+//   int64 microseconds since the Unix epoch, uint64 thread id, uint32 line
+//   uint16 length + file name, uint16 length + function, uint32 length + message
+void Logger::format_binary_entry(const LogEntry& entry, std::string& out, std::string& scratch) const {
+    const char* file = base_name(entry.source_file);
+    uint16_t file_length = static_cast<uint16_t>(std::min<size_t>(std::strlen(file), UINT16_MAX));
+    uint16_t function_length = static_cast<uint16_t>(
+        std::min<size_t>(std::strlen(entry.function_name), UINT16_MAX));
+    
+    scratch.clear();
+    append_message(entry, scratch);
+    uint32_t message_length = static_cast<uint32_t>(scratch.size());
+    
+    uint32_t record_size = 2 + 8 + 8 + 4 + 2 + file_length + 2 + function_length + 4 + message_length;
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        entry.timestamp.time_since_epoch()).count();
+    
+    append_raw(out, record_size);
+    append_raw(out, static_cast<uint8_t>(entry.level));
+    append_raw(out, static_cast<uint8_t>(entry.truncated ? 1 : 0));
+    append_raw(out, micros);
+    append_raw(out, entry.thread_id);
+    append_raw(out, entry.line_number);
+    append_raw(out, file_length);
+    out.append(file, file_length);
+    append_raw(out, function_length);
+    out.append(entry.function_name, function_length);
+    append_raw(out, message_length);
+    out.append(scratch);
+}
+
+void Logger::render_format(const LogEntry& entry, std::string& out) const {
+    using detail::LogArgType;
+    
+    const char* args = entry.message;
+    const char* args_end = entry.message + entry.length;
+    
+    // Append the next captured argument; placeholders past the last one stay empty
+    auto append_next_arg = [&]() {
+        if (args >= args_end) {
+            return;
+        }
+        LogArgType type = static_cast<LogArgType>(*args++);
+        switch (type) {
+            case LogArgType::INT: {
+                int64_t value;
+                std::memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                out += std::to_string(value);
+                break;
+            }
+            case LogArgType::UINT: {
+                uint64_t value;
+                std::memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                out += std::to_string(value);
+                break;
+            }
+            case LogArgType::DOUBLE: {
+                double value;
+                std::memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%g", value);
+                out += buffer;
+                break;
+            }
+            case LogArgType::BOOL:
+                out += *args++ ? "true" : "false";
+                break;
+            case LogArgType::CHAR:
+                out += *args++;
+                break;
+            case LogArgType::STRING: {
+                uint16_t size;
+                std::memcpy(&size, args, sizeof(size));
+                args += sizeof(size);
+                out.append(args, size);
+                args += size;
+                break;
+            }
+            case LogArgType::POINTER: {
+                uint64_t value;
+                std::memcpy(&value, args, sizeof(value));
+                args += sizeof(value);
+                char buffer[24];
+                std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(value));
+                out += buffer;
+                break;
+            }
+            default:
+                args = args_end;
+                break;
+        }
+    };
+    
+    // {} takes the next argument; {{ and }} are literal braces
+    for (const char* p = entry.format; *p != '\0'; ++p) {
+        if (p[0] == '{' && p[1] == '{') {
+            out += '{';
+            ++p;
+        } else if (p[0] == '}' && p[1] == '}') {
+            out += '}';
+            ++p;
+        } else if (p[0] == '{' && p[1] == '}') {
+            append_next_arg();
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+}
+
+void Logger::append_entry(const LogEntry& entry, OutputBatch& batch) const {
+    if (config_.enable_file_output) {
+        switch (config_.file_format) {
+            case FileFormat::JSON:
+                format_json_entry(entry, batch.file_text, batch.scratch);
+                break;
+            case FileFormat::BINARY:
+                format_binary_entry(entry, batch.file_text, batch.scratch);
+                break;
+            default:
+                format_log_entry(entry, batch.file_text);
+                batch.file_text += '\n';
+                break;
+        }
     }
     
-    std::string formatted = format_log_entry(entry);
+    if (config_.enable_console_output) {
+        // Color coding for different levels
+        bool to_stderr = entry.level >= Level::LOG_ERROR;
+        std::string& console = to_stderr ? batch.stderr_text : batch.stdout_text;
+        switch (entry.level) {
+            case Level::LOG_DEBUG: console += "\033[36m"; break;
+            case Level::LOG_INFO: console += "\033[32m"; break;
+            case Level::LOG_WARN: console += "\033[33m"; break;
+            case Level::LOG_ERROR: console += "\033[31m"; break;
+            case Level::LOG_CRITICAL: console += "\033[35m"; break;
+        }
+        format_log_entry(entry, console);
+        console += "\033[0m\n";
+    }
+    batch.count++;
+}
+
+void Logger::write_batch(OutputBatch& batch) {
+    if (!batch.file_text.empty()) {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        if (log_file_.is_open()) {
+            // Check if we need to rotate logs, by size or age
+            bool too_big = file_size_ + batch.file_text.size() > config_.max_log_file_size;
+            bool too_old = config_.log_rotation_interval.count() > 0 &&
+                std::chrono::steady_clock::now() - file_opened_at_ >= config_.log_rotation_interval;
+            if (file_size_ > 0 && (too_big || too_old)) {
+                begin_rotation_locked();
+            }
+            log_file_.write(batch.file_text.data(), static_cast<std::streamsize>(batch.file_text.size()));
+            log_file_.flush();
+            file_size_ += batch.file_text.size();
+        }
+    }
     
-    // Color coding for different levels
-    switch (entry.level) {
-        case Level::DEBUG:
-            std::cout << "\033[36m" << formatted << "\033[0m" << std::endl;
-            break;
-        case Level::INFO:
-            std::cout << "\033[32m" << formatted << "\033[0m" << std::endl;
-            break;
-        case Level::WARN:
-            std::cout << "\033[33m" << formatted << "\033[0m" << std::endl;
-            break;
-        case Level::ERROR:
-            std::cerr << "\033[31m" << formatted << "\033[0m" << std::endl;
-            break;
-        case Level::CRITICAL:
-            std::cerr << "\033[35m" << formatted << "\033[0m" << std::endl;
-            break;
-        default:
-            std::cout << formatted << std::endl;
-            break;
+    if (!batch.stdout_text.empty()) {
+        std::cout.write(batch.stdout_text.data(), static_cast<std::streamsize>(batch.stdout_text.size()));
+        std::cout.flush();
+    }
+    if (!batch.stderr_text.empty()) {
+        std::cerr.write(batch.stderr_text.data(), static_cast<std::streamsize>(batch.stderr_text.size()));
     }
+    
+    batch.file_text.clear();
+    batch.stdout_text.clear();
+    batch.stderr_text.clear();
+    batch.count = 0;
 }
 
 void Logger::worker_thread_function() {
+    OutputBatch batch;
+    batch.file_text.reserve(config_.write_buffer_size + WORKER_BATCH_SIZE * 1024);
+    auto last_sweep = std::chrono::steady_clock::now();
+    
+    // Blocked producers and flush() callers wait for progress
+    auto notify_waiters = [this]() {
+        if (waiters_.load() > 0) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            space_condition_.notify_all();
+        }
+    };
+    
     while (true) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
+        // Collect records that threads have left sitting in their buffers
+        if (staging_capacity_ > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_sweep >= STAGING_SWEEP_INTERVAL) {
+                sweep_staging(true);
+                last_sweep = now;
+            }
+        }
         
-        // Wait for work or shutdown signal
-        queue_condition_.wait(lock, [this] { 
-            return !log_queue_.empty() || stop_worker_; 
-        });
+        size_t consumed = ring_->consume([this, &batch](const LogEntry& entry) {
+            append_entry(entry, batch);
+        }, WORKER_BATCH_SIZE);
         
-        if (stop_worker_ && log_queue_.empty()) {
-            break;
+        // Keep gathering while records arrive, up to write_buffer_size
+        if (consumed > 0) {
+            notify_waiters();
+            if (batch.bytes() < config_.write_buffer_size) {
+                continue;
+            }
         }
         
-        // Process all available log entries
-        while (!log_queue_.empty()) {
-            LogEntry entry = log_queue_.front();
-            log_queue_.pop();
-            lock.unlock();
-            
-            write_log_entry(entry);
-            
-            lock.lock();
+        if (batch.count > 0) {
+            size_t count = batch.count;
+            write_batch(batch);
+            written_logs_ += count;
+            notify_waiters();
+            continue;
         }
+        
+        // Wait for work or shutdown signal
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        worker_sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ring_->ready()) {
+            if (stop_worker_) {
+                worker_sleeping_ = false;
+                break;
+            }
+            queue_condition_.wait_for(lock, staging_capacity_ > 0 ? STAGING_SWEEP_INTERVAL : WORKER_IDLE_WAIT);
+        }
+        worker_sleeping_.store(false, std::memory_order_relaxed);
     }
 }
 
-void Logger::write_log_entry(const LogEntry& entry) {
-    write_to_console(entry);
-    write_to_file(entry);
-}
-
 } // namespace utils
 } // namespace dfs
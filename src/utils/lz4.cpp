@@ -0,0 +1,257 @@
+#include "utils/lz4.h"
+#include "utils/checksum.h"
+#include "utils/exceptions.h"
+#include <cstring>
+#include <vector>
+
+namespace dfs {
+namespace utils {
+
+namespace {
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hash_sequence(uint32_t sequence, int hash_bits) {
+    return (sequence * 2654435761U) >> (32 - hash_bits);
+}
+
+// Write a length that overflowed its 4-bit token field
+inline uint8_t* write_length(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+inline void write_le32(std::ostream& out, uint32_t value) {
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)
+    };
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+} // namespace
+
+size_t Lz4::compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t Lz4::compress(const void* src, size_t size, void* dst, size_t capacity) {
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* const base = ip;
+    const uint8_t* const end = ip + size;
+    const uint8_t* anchor = ip;
+    uint8_t* op = static_cast<uint8_t*>(dst);
+    uint8_t* const op_end = op + capacity;
+    
+    // Emit a sequence of literals [anchor, literal_end) followed by an optional match
+    auto emit = [&](const uint8_t* literal_end, size_t offset, size_t match_length) -> bool {
+        size_t literal_length = static_cast<size_t>(literal_end - anchor);
+        
+        // Worst case: token, literal length bytes, literals, offset, match length bytes
+        size_t needed = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+        if (static_cast<size_t>(op_end - op) < needed) {
+            return false;
+        }
+        
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+        if (literal_length >= 15) {
+            op = write_length(op, literal_length - 15);
+        }
+        std::memcpy(op, anchor, literal_length);
+        op += literal_length;
+        
+        if (match_length > 0) {
+            *op++ = static_cast<uint8_t>(offset & 0xFF);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            
+            size_t length_code = match_length - MIN_MATCH;
+            *token |= static_cast<uint8_t>(length_code >= 15 ? 15 : length_code);
+            if (length_code >= 15) {
+                op = write_length(op, length_code - 15);
+            }
+        }
+        return true;
+    };
+    
+    if (size >= MATCH_FIND_LIMIT + 1) {
+        std::vector<uint32_t> table(1u << HASH_BITS, 0);
+        const uint8_t* const match_limit = end - MATCH_FIND_LIMIT;
+        const uint8_t* const copy_limit = end - LAST_LITERALS;
+        
+        ip++;
+        while (ip < match_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash_sequence(sequence, HASH_BITS);
+            const uint8_t* candidate = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+            
+            if (candidate >= ip || static_cast<size_t>(ip - candidate) > MAX_DISTANCE ||
+                read32(candidate) != sequence) {
+                ip++;
+                continue;
+            }
+            
+            // Extend backwards over literals, then forwards up to the last literals
+            while (ip > anchor && candidate > base && ip[-1] == candidate[-1]) {
+                ip--;
+                candidate--;
+            }
+            
+            const uint8_t* match_end = ip + MIN_MATCH;
+            const uint8_t* ref = candidate + MIN_MATCH;
+            while (match_end < copy_limit && *match_end == *ref) {
+                match_end++;
+                ref++;
+            }
+            
+            if (!emit(ip, static_cast<size_t>(ip - candidate), static_cast<size_t>(match_end - ip))) {
+                return 0;
+            }
+            
+            ip = match_end;
+            anchor = ip;
+            
+            // Index a position inside the match so runs keep matching
+            if (ip - 2 > base) {
+                table[hash_sequence(read32(ip - 2), HASH_BITS)] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+    
+    // The block always ends with a literal-only sequence
+    if (!emit(end, 0, 0)) {
+        return 0;
+    }
+    
+    return static_cast<size_t>(op - static_cast<uint8_t*>(dst));
+}
+
+size_t Lz4::decompress(const void* src, size_t size, void* dst, size_t capacity) {
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* const ip_end = ip + size;
+    uint8_t* op = static_cast<uint8_t*>(dst);
+    uint8_t* const base = op;
+    uint8_t* const op_end = op + capacity;
+    
+    auto read_length = [&](size_t length) -> size_t {
+        if (length != 15) {
+            return length;
+        }
+        uint8_t byte;
+        do {
+            if (ip >= ip_end) {
+                throw FileSystemCorruptedException("Truncated LZ4 length");
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    };
+    
+    while (ip < ip_end) {
+        uint8_t token = *ip++;
+        
+        size_t literal_length = read_length(token >> 4);
+        if (literal_length > static_cast<size_t>(ip_end - ip) ||
+            literal_length > static_cast<size_t>(op_end - op)) {
+            throw FileSystemCorruptedException("LZ4 literals overrun block");
+        }
+        // dst may be null when capacity is 0
+        if (literal_length > 0) {
+            std::memcpy(op, ip, literal_length);
+        }
+        ip += literal_length;
+        op += literal_length;
+        
+        // The last sequence has no match
+        if (ip == ip_end) {
+            break;
+        }
+        
+        if (ip_end - ip < 2) {
+            throw FileSystemCorruptedException("Truncated LZ4 match offset");
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        
+        if (offset == 0 || offset > static_cast<size_t>(op - base)) {
+            throw FileSystemCorruptedException("Invalid LZ4 match offset");
+        }
+        
+        size_t match_length = read_length(token & 0x0F) + MIN_MATCH;
+        if (match_length > static_cast<size_t>(op_end - op)) {
+            throw FileSystemCorruptedException("LZ4 match overruns output");
+        }
+        
+        // Matches may overlap their own output, so copy forwards byte by byte
+        // unless the source is far enough behind
+        const uint8_t* match = op - offset;
+        if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            for (size_t i = 0; i < match_length; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+    
+    return static_cast<size_t>(op - base);
+}
+
+uint64_t Lz4::compress_frame(std::istream& in, std::ostream& out) {
+    // FLG: version 01, independent blocks, block checksums; BD: 4MB blocks
+    uint8_t descriptor[2] = {0x70, 0x70};
+    uint8_t header_checksum = static_cast<uint8_t>(Checksum::xxh32(descriptor, sizeof(descriptor)) >> 8);
+    
+    write_le32(out, FRAME_MAGIC);
+    out.write(reinterpret_cast<const char*>(descriptor), sizeof(descriptor));
+    out.put(static_cast<char>(header_checksum));
+    
+    std::vector<uint8_t> input(FRAME_BLOCK_SIZE);
+    std::vector<uint8_t> output(compress_bound(FRAME_BLOCK_SIZE));
+    uint64_t total = 0;
+    
+    while (in) {
+        in.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(input.size()));
+        size_t size = static_cast<size_t>(in.gcount());
+        if (size == 0) {
+            break;
+        }
+        total += size;
+        
+        // Store the block raw (high bit set) when compression does not help
+        size_t compressed = compress(input.data(), size, output.data(), output.size());
+        const uint8_t* block = output.data();
+        uint32_t block_header = static_cast<uint32_t>(compressed);
+        if (compressed == 0 || compressed >= size) {
+            block = input.data();
+            compressed = size;
+            block_header = static_cast<uint32_t>(size) | 0x80000000U;
+        }
+        
+        write_le32(out, block_header);
+        out.write(reinterpret_cast<const char*>(block), static_cast<std::streamsize>(compressed));
+        write_le32(out, Checksum::xxh32(block, compressed));
+    }
+    
+    // End mark
+    write_le32(out, 0);
+    
+    if (!out) {
+        throw FileSystemException("Failed to write LZ4 frame");
+    }
+    return total;
+}
+
+} // namespace utils
+} // namespace dfs
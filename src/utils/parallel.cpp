@@ -0,0 +1,233 @@
+#include "utils/parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+namespace dfs {
+namespace utils {
+
+namespace {
+
+// Shared by the caller and its helpers; helpers that start after the last
+// chunk was claimed only touch this state, so it outlives run_chunks()
+struct ChunkState {
+    const std::function<void(size_t)>* chunk;
+    size_t chunks;
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    std::atomic<bool> failed;
+    
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+    
+    ChunkState(const std::function<void(size_t)>& chunk_fn, size_t chunk_count)
+        : chunk(&chunk_fn), chunks(chunk_count), next(0), done(0), failed(false) {}
+};
+
+// Claim and run chunks until none are left
+void drain_chunks(ChunkState& state) {
+    size_t index;
+    while ((index = state.next.fetch_add(1)) < state.chunks) {
+        if (!state.failed.load(std::memory_order_relaxed)) {
+            try {
+                (*state.chunk)(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (!state.error) {
+                    state.error = std::current_exception();
+                }
+                state.failed = true;
+            }
+        }
+        
+        if (state.done.fetch_add(1) + 1 == state.chunks) {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.finished.notify_all();
+        }
+    }
+}
+
+} // namespace
+
+void run_chunks(ThreadPool& pool, size_t chunks, const std::function<void(size_t)>& chunk,
+                ThreadPool::Priority priority) {
+    if (chunks == 0) {
+        return;
+    }
+    
+    auto state = std::make_shared<ChunkState>(chunk, chunks);
+    
+    // One helper per worker at most; the caller takes the chunks they don't
+    size_t helpers = pool.is_running() ? std::min(chunks - 1, pool.get_thread_count()) : 0;
+    for (size_t i = 0; i < helpers; ++i) {
+        try {
+            pool.post([state]() { drain_chunks(*state); }, priority);
+        } catch (const std::runtime_error&) {
+            // Pool stopped meanwhile; the caller runs the rest
+            break;
+        }
+    }
+    
+    drain_chunks(*state);
+    
+    // Wait only for chunks other threads are still running
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done.load() == state->chunks; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+// State of one TaskGraph::run(), shared with the helpers it posts
+struct TaskGraph::RunState {
+    ThreadPool* pool;
+    std::vector<Node>* tasks;
+    
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<TaskId> ready;
+    std::vector<size_t> remaining;    // Unfinished dependencies per task
+    size_t finished;
+    std::exception_ptr error;
+};
+
+TaskGraph::TaskGraph(ThreadPool& pool) : pool_(pool) {}
+
+TaskGraph::TaskId TaskGraph::add_task(std::function<void()> task, ThreadPool::Priority priority) {
+    tasks_.push_back(Node{std::move(task), priority, {}, 0});
+    return tasks_.size() - 1;
+}
+
+void TaskGraph::add_dependency(TaskId before, TaskId after) {
+    if (before >= tasks_.size() || after >= tasks_.size() || before == after) {
+        throw std::invalid_argument("Invalid TaskGraph dependency " + std::to_string(before) +
+                                    " -> " + std::to_string(after));
+    }
+    
+    tasks_[before].successors.push_back(after);
+    tasks_[after].dependencies++;
+}
+
+void TaskGraph::run() {
+    auto state = std::make_shared<RunState>();
+    state->pool = &pool_;
+    state->tasks = &tasks_;
+    state->finished = 0;
+    state->remaining.reserve(tasks_.size());
+    for (const Node& node : tasks_) {
+        state->remaining.push_back(node.dependencies);
+    }
+    
+    // Every task must be reachable from a root, otherwise run() would never finish
+    std::vector<size_t> pending = state->remaining;
+    std::vector<TaskId> order;
+    for (TaskId id = 0; id < tasks_.size(); ++id) {
+        if (pending[id] == 0) {
+            order.push_back(id);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (TaskId successor : tasks_[order[i]].successors) {
+            if (--pending[successor] == 0) {
+                order.push_back(successor);
+            }
+        }
+    }
+    if (order.size() != tasks_.size()) {
+        throw std::invalid_argument("TaskGraph has a dependency cycle");
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (TaskId id = 0; id < tasks_.size(); ++id) {
+            if (tasks_[id].dependencies == 0) {
+                state->ready.push_back(id);
+            }
+        }
+    }
+    for (TaskId id : std::vector<TaskId>(state->ready.begin(), state->ready.end())) {
+        try {
+            pool_.post([state]() { run_ready(state); }, tasks_[id].priority);
+        } catch (const std::runtime_error&) {
+            break;
+        }
+    }
+    
+    // Run ready tasks here too, sleeping only while others run the last ones
+    while (true) {
+        if (run_ready(state)) {
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->changed.wait(lock, [&] {
+            return !state->ready.empty() || state->finished == tasks_.size();
+        });
+        if (state->finished == tasks_.size()) {
+            break;
+        }
+    }
+    
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+bool TaskGraph::run_ready(const std::shared_ptr<RunState>& state) {
+    TaskId id;
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->ready.empty()) {
+            return false;
+        }
+        id = state->ready.front();
+        state->ready.pop_front();
+        skip = state->error != nullptr;
+    }
+    
+    Node& node = (*state->tasks)[id];
+    std::exception_ptr error;
+    if (!skip) {
+        try {
+            node.task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    
+    // Priorities are copied under the lock; once the last task finishes the
+    // graph may be destroyed while this helper is still posting
+    std::vector<ThreadPool::Priority> released;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (error && !state->error) {
+            state->error = error;
+        }
+        for (TaskId successor : node.successors) {
+            if (--state->remaining[successor] == 0) {
+                state->ready.push_back(successor);
+                released.push_back((*state->tasks)[successor].priority);
+            }
+        }
+        state->finished++;
+    }
+    state->changed.notify_all();
+    
+    // Offer each newly ready task to a worker; the caller may get there first
+    for (ThreadPool::Priority priority : released) {
+        try {
+            state->pool->post([state]() { run_ready(state); }, priority);
+        } catch (const std::runtime_error&) {
+            break;
+        }
+    }
+    return true;
+}
+
+} // namespace utils
+} // namespace dfs
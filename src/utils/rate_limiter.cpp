@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <thread>
 
 namespace dfs {
 namespace utils {
@@ -13,130 +14,279 @@ RateLimiter::RateLimitConfig::RateLimitConfig(uint32_t rps, uint32_t burst,
     : max_requests_per_second(rps), burst_capacity(burst), window_size(window),
       enable_per_client_limits(per_client) {}
 
+namespace {
+
+// Statistics slot for checks that have no client, spread over the shards by thread
+size_t thread_stat_slot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // anonymous namespace
+
 // TokenBucket implementation
-RateLimiter::TokenBucket::TokenBucket(uint32_t capacity)
-    : tokens(capacity), last_refill(std::chrono::steady_clock::now()) {}
+RateLimiter::TokenBucket::TokenBucket(uint64_t now_ns)
+    : state(now_ns) {}
 
 bool RateLimiter::TokenBucket::try_consume(uint32_t tokens_needed, uint32_t refill_rate,
-                                          std::chrono::seconds refill_interval) {
-    std::lock_guard<std::mutex> lock(bucket_mutex);
-    
-    // Refill tokens based on time elapsed
-    refill(refill_rate, refill_interval);
-    
-    // Check if we have enough tokens
-    if (tokens.load() >= tokens_needed) {
-        tokens -= tokens_needed;
-        return true;
+                                          uint32_t burst_capacity, uint64_t now_ns) {
+    if (refill_rate == 0) {
+        return false;
     }
     
-    return false;
+    // A token's worth of time, and how far ahead of now the arrival time
+    // may run before the bucket is empty
+    const uint64_t interval = NANOS_PER_SECOND / refill_rate;
+    const uint64_t cost = static_cast<uint64_t>(tokens_needed) * interval;
+    const uint64_t limit = now_ns + static_cast<uint64_t>(burst_capacity) * interval;
+    
+    uint64_t current = state.load(std::memory_order_relaxed);
+    while (true) {
+        // An arrival time in the past means the bucket has refilled to the cap
+        uint64_t next_arrival = std::max(current, now_ns) + cost;
+        if (next_arrival > limit) {
+            return false;
+        }
+        
+        if (state.compare_exchange_weak(current, next_arrival, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
 }
 
-void RateLimiter::TokenBucket::refill(uint32_t refill_rate, std::chrono::seconds refill_interval) {
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_refill);
-    
-    if (elapsed >= refill_interval) {
-        uint32_t tokens_to_add = static_cast<uint32_t>(elapsed.count()) * refill_rate;
-        uint32_t current_tokens = tokens.load();
-        uint32_t max_tokens = refill_rate * refill_interval.count();
-        
-        // Don't exceed the maximum capacity
-        uint32_t new_tokens = std::min(current_tokens + tokens_to_add, max_tokens);
-        tokens.store(new_tokens);
-        
-        last_refill = now;
+uint32_t RateLimiter::TokenBucket::available(uint32_t refill_rate, uint32_t burst_capacity,
+                                             uint64_t now_ns) const {
+    if (refill_rate == 0) {
+        return 0;
     }
+    
+    const uint64_t interval = NANOS_PER_SECOND / refill_rate;
+    uint64_t arrival = state.load(std::memory_order_relaxed);
+    uint64_t debt = arrival > now_ns ? (arrival - now_ns + interval - 1) / interval : 0;
+    
+    return debt >= burst_capacity ? 0 : burst_capacity - static_cast<uint32_t>(debt);
+}
+
+void RateLimiter::TokenBucket::reset(uint64_t now_ns) {
+    state.store(now_ns, std::memory_order_relaxed);
 }
 
 // ClientLimiter implementation
-RateLimiter::ClientLimiter::ClientLimiter(uint32_t capacity)
-    : bucket(std::make_unique<TokenBucket>(capacity)),
-      request_count(0), window_start(std::chrono::steady_clock::now()) {}
+RateLimiter::ClientLimiter::ClientLimiter(uint64_t now_ns)
+    : bucket(now_ns), window((now_ns / 1000000) << COUNT_BITS) {}
 
-bool RateLimiter::ClientLimiter::is_allowed(uint32_t tokens_needed, const RateLimitConfig& config) {
+bool RateLimiter::ClientLimiter::is_allowed(uint32_t tokens_needed, const RateLimitConfig& config,
+                                            uint64_t now_ns) {
     // Check token bucket
-    if (!bucket->try_consume(tokens_needed, config.max_requests_per_second, config.window_size)) {
+    if (!bucket.try_consume(tokens_needed, config.max_requests_per_second,
+                            config.burst_capacity, now_ns)) {
         return false;
     }
     
-    // Check sliding window
-    auto now = std::chrono::steady_clock::now();
-    auto window_elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - window_start);
+    // Count the request in the current window
+    const uint64_t now_ms = now_ns / 1000000;
+    const uint64_t window_ms = static_cast<uint64_t>(config.window_size.count()) * 1000;
     
-    if (window_elapsed >= config.window_size) {
-        // Reset window
-        request_count.store(0);
-        window_start = now;
+    uint64_t current = window.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t start = current >> COUNT_BITS;
+        uint64_t count = current & COUNT_MASK;
+        
+        if (now_ms > start && now_ms - start >= window_ms) {
+            // Start a new window
+            start = now_ms;
+            count = 0;
+        }
+        
+        uint64_t desired = (start << COUNT_BITS) | std::min(count + 1, COUNT_MASK);
+        if (window.compare_exchange_weak(current, desired, std::memory_order_relaxed)) {
+            return true;
+        }
     }
-    
-    // Check if we're within the rate limit
-    if (request_count.load() >= config.max_requests_per_second) {
-        return false;
+}
+
+void RateLimiter::ClientLimiter::reset_window(uint64_t now_ms) {
+    window.store(now_ms << COUNT_BITS, std::memory_order_relaxed);
+}
+
+uint32_t RateLimiter::ClientLimiter::request_count() const {
+    return static_cast<uint32_t>(window.load(std::memory_order_relaxed) & COUNT_MASK);
+}
+
+uint64_t RateLimiter::ClientLimiter::window_start_ms() const {
+    return window.load(std::memory_order_relaxed) >> COUNT_BITS;
+}
+
+RateLimiter::ClientEntry::ClientEntry(const std::string& id, size_t key_hash, uint64_t now_ns)
+    : client_id(id), hash(key_hash), limiter(now_ns), next(nullptr) {}
+
+RateLimiter::Shard::Shard()
+    : allowed_requests(0), denied_requests(0), epoch(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(nullptr, std::memory_order_relaxed);
     }
+    readers[0] = 0;
+    readers[1] = 0;
+}
+
+void RateLimiter::Shard::synchronize() {
+    // A lookup that joins the old slot after this flip sees the new epoch
+    // on its recheck and moves over, so the old slot only drains
+    uint64_t old_epoch = epoch.fetch_add(1);
+    while (readers[old_epoch & 1].load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+RateLimiter::ReadGuard::ReadGuard(Shard& shard) : shard_(shard) {
+    while (true) {
+        uint64_t epoch = shard_.epoch.load();
+        slot_ = epoch & 1;
+        shard_.readers[slot_].fetch_add(1);
+        if (shard_.epoch.load() == epoch) {
+            return;
+        }
+        shard_.readers[slot_].fetch_sub(1);
+    }
+}
+
+RateLimiter::ReadGuard::~ReadGuard() {
+    shard_.readers[slot_].fetch_sub(1);
+}
+
+// ConfigCell implementation
+RateLimiter::ConfigCell::ConfigCell(const RateLimitConfig& config)
+    : sequence(0), max_requests_per_second(config.max_requests_per_second),
+      burst_capacity(config.burst_capacity), window_seconds(config.window_size.count()),
+      enable_per_client_limits(config.enable_per_client_limits) {}
+
+RateLimiter::RateLimitConfig RateLimiter::ConfigCell::load() const {
+    RateLimitConfig config;
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        config.max_requests_per_second = max_requests_per_second.load(std::memory_order_relaxed);
+        config.burst_capacity = burst_capacity.load(std::memory_order_relaxed);
+        config.window_size = std::chrono::seconds(window_seconds.load(std::memory_order_relaxed));
+        config.enable_per_client_limits = enable_per_client_limits.load(std::memory_order_relaxed);
+        
+        // Order the field loads before the second sequence load
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
     
-    request_count++;
-    return true;
+    return config;
 }
 
-void RateLimiter::ClientLimiter::reset_window() {
-    request_count.store(0);
-    window_start = std::chrono::steady_clock::now();
+void RateLimiter::ConfigCell::store(const RateLimitConfig& config) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    
+    // An odd sequence marks the write in progress; the fence keeps the field
+    // stores after it
+    uint32_t current = sequence.load(std::memory_order_relaxed);
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    max_requests_per_second.store(config.max_requests_per_second, std::memory_order_relaxed);
+    burst_capacity.store(config.burst_capacity, std::memory_order_relaxed);
+    window_seconds.store(config.window_size.count(), std::memory_order_relaxed);
+    enable_per_client_limits.store(config.enable_per_client_limits, std::memory_order_relaxed);
+    
+    sequence.store(current + 2, std::memory_order_release);
 }
 
 // RateLimiter implementation
 RateLimiter::RateLimiter(const RateLimitConfig& config)
-    : config_(config), start_time_(std::chrono::steady_clock::now()) {
+    : config_(config), shards_(new Shard[SHARD_COUNT]), active_clients_(0),
+      start_time_(std::chrono::steady_clock::now()) {
     
     LOG_INFO("Creating RateLimiter with " + std::to_string(config.max_requests_per_second) + 
              " RPS, burst capacity " + std::to_string(config.burst_capacity));
     
-    // Initialize statistics
-    total_requests_ = 0;
-    allowed_requests_ = 0;
-    denied_requests_ = 0;
-    
     // Create global bucket if per-client limits are disabled
-    if (!config_.enable_per_client_limits) {
-        global_bucket_ = std::make_unique<TokenBucket>(config_.burst_capacity);
+    if (!config.enable_per_client_limits) {
+        global_bucket_ = std::make_unique<TokenBucket>(now_ns());
     }
     
     LOG_INFO("RateLimiter created successfully");
 }
 
 RateLimiter::~RateLimiter() {
-    // Cleanup is handled by smart pointers
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        for (auto& bucket : shard.buckets) {
+            ClientEntry* entry = bucket.load(std::memory_order_acquire);
+            while (entry) {
+                ClientEntry* next = entry->next.load(std::memory_order_relaxed);
+                delete entry;
+                entry = next;
+            }
+        }
+    }
+}
+
+uint64_t RateLimiter::now_ns() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time_).count());
+}
+
+uint64_t RateLimiter::now_ms() const {
+    return now_ns() / 1000000;
+}
+
+RateLimiter::Shard& RateLimiter::shard_for(size_t hash) const {
+    return shards_[(hash / BUCKETS_PER_SHARD) % SHARD_COUNT];
+}
+
+std::atomic<RateLimiter::ClientEntry*>& RateLimiter::bucket_for(size_t hash) const {
+    return shard_for(hash).buckets[hash % BUCKETS_PER_SHARD];
+}
+
+RateLimiter::ClientEntry* RateLimiter::find_entry(const std::string& client_id, size_t hash) const {
+    ClientEntry* entry = bucket_for(hash).load(std::memory_order_acquire);
+    while (entry) {
+        if (entry->hash == hash && entry->client_id == client_id) {
+            return entry;
+        }
+        entry = entry->next.load(std::memory_order_acquire);
+    }
+    return nullptr;
+}
+
+void RateLimiter::record(Shard& shard, bool allowed) {
+    if (allowed) {
+        shard.allowed_requests.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        shard.denied_requests.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 bool RateLimiter::is_allowed(const std::string& client_id, uint32_t tokens_needed) {
-    total_requests_++;
-    
-    if (!config_.enable_per_client_limits) {
+    RateLimitConfig config = config_.load();
+    if (!config.enable_per_client_limits) {
         // Use global rate limiting
         return is_allowed(tokens_needed);
     }
     
     // Get or create client limiter
-    ClientLimiter* limiter = get_client_limiter(client_id);
-    if (!limiter) {
-        denied_requests_++;
-        return false;
-    }
-    
-    bool allowed = limiter->is_allowed(tokens_needed, config_);
-    
-    if (allowed) {
-        allowed_requests_++;
-    } else {
-        denied_requests_++;
+    size_t hash = std::hash<std::string>{}(client_id);
+    Shard& shard = shard_for(hash);
+    bool allowed;
+    {
+        ReadGuard guard(shard);
+        ClientEntry* entry = find_or_create_entry(client_id, hash);
+        allowed = entry->limiter.is_allowed(tokens_needed, config, now_ns());
     }
+    record(shard, allowed);
     
     return allowed;
 }
 
 bool RateLimiter::is_allowed(uint32_t tokens_needed) {
-    if (config_.enable_per_client_limits) {
+    RateLimitConfig config = config_.load();
+    if (config.enable_per_client_limits) {
         LOG_ERROR("Global rate limiting called but per-client limits are enabled");
         return false;
     }
@@ -146,77 +296,120 @@ bool RateLimiter::is_allowed(uint32_t tokens_needed) {
         return false;
     }
     
-    total_requests_++;
-    
     bool allowed = global_bucket_->try_consume(tokens_needed, 
-                                             config_.max_requests_per_second, 
-                                             config_.window_size);
-    
-    if (allowed) {
-        allowed_requests_++;
-    } else {
-        denied_requests_++;
-    }
+                                             config.max_requests_per_second, 
+                                             config.burst_capacity, now_ns());
+    record(shards_[thread_stat_slot() % SHARD_COUNT], allowed);
     
     return allowed;
 }
 
-RateLimiter::ClientLimiter* RateLimiter::get_client_limiter(const std::string& client_id) {
-    std::lock_guard<std::mutex> lock(client_mutex_);
-    
-    auto it = client_limiters_.find(client_id);
-    if (it != client_limiters_.end()) {
-        return it->second.get();
+RateLimiter::ClientEntry* RateLimiter::find_or_create_entry(const std::string& client_id, size_t hash) {
+    ClientEntry* existing = find_entry(client_id, hash);
+    if (existing) {
+        return existing;
     }
     
-    // Create new client limiter
-    auto limiter = std::make_unique<ClientLimiter>(config_.burst_capacity);
-    ClientLimiter* limiter_ptr = limiter.get();
-    client_limiters_[client_id] = std::move(limiter);
+    // Create new client limiter and push it onto the chain head; if another
+    // thread moved the head first, it may have added the same client
+    std::atomic<ClientEntry*>& head = bucket_for(hash);
+    auto entry = std::make_unique<ClientEntry>(client_id, hash, now_ns());
+    ClientEntry* expected = head.load(std::memory_order_acquire);
+    
+    while (true) {
+        entry->next.store(expected, std::memory_order_relaxed);
+        if (head.compare_exchange_weak(expected, entry.get(),
+                                       std::memory_order_release, std::memory_order_acquire)) {
+            break;
+        }
+        
+        for (ClientEntry* other = expected; other; other = other->next.load(std::memory_order_acquire)) {
+            if (other->hash == hash && other->client_id == client_id) {
+                return other;
+            }
+        }
+    }
     
+    active_clients_.fetch_add(1, std::memory_order_relaxed);
     LOG_DEBUG("Created new client limiter for: " + client_id);
-    return limiter_ptr;
+    return entry.release();
+}
+
+void RateLimiter::unlink_entry_locked(ClientEntry* entry) {
+    std::atomic<ClientEntry*>& head = bucket_for(entry->hash);
+    ClientEntry* next = entry->next.load(std::memory_order_acquire);
+    
+    // Inserts only ever replace the head, and other removals hold this
+    // shard's mutex, so an entry that is not the head has a stable predecessor
+    ClientEntry* expected = entry;
+    if (!head.compare_exchange_strong(expected, next, std::memory_order_acq_rel)) {
+        ClientEntry* previous = expected;
+        while (previous->next.load(std::memory_order_acquire) != entry) {
+            previous = previous->next.load(std::memory_order_acquire);
+        }
+        previous->next.store(next, std::memory_order_release);
+    }
+    
+    // Lookups may still be walking it; its next pointer stays intact
+    active_clients_.fetch_sub(1, std::memory_order_relaxed);
 }
 
 void RateLimiter::remove_client(const std::string& client_id) {
-    std::lock_guard<std::mutex> lock(client_mutex_);
+    size_t hash = std::hash<std::string>{}(client_id);
+    Shard& shard = shard_for(hash);
     
-    auto it = client_limiters_.find(client_id);
-    if (it != client_limiters_.end()) {
-        client_limiters_.erase(it);
+    std::lock_guard<std::mutex> lock(shard.removal_mutex);
+    
+    ClientEntry* entry = find_entry(client_id, hash);
+    if (entry) {
+        unlink_entry_locked(entry);
+        shard.synchronize();
+        delete entry;
         LOG_DEBUG("Removed client limiter for: " + client_id);
     }
 }
 
 void RateLimiter::update_config(const RateLimitConfig& new_config) {
-    std::lock_guard<std::mutex> lock(client_mutex_);
-    
-    config_ = new_config;
+    config_.store(new_config);
+    uint64_t now = now_ns();
     
     // Update global bucket if it exists
     if (global_bucket_) {
-        global_bucket_ = std::make_unique<TokenBucket>(new_config.burst_capacity);
+        global_bucket_->reset(now);
     }
     
     // Update all client limiters
-    for (auto& pair : client_limiters_) {
-        pair.second = std::make_unique<ClientLimiter>(new_config.burst_capacity);
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        std::lock_guard<std::mutex> lock(shard.removal_mutex);
+        
+        for (auto& bucket : shard.buckets) {
+            for (ClientEntry* entry = bucket.load(std::memory_order_acquire); entry;
+                 entry = entry->next.load(std::memory_order_acquire)) {
+                entry->limiter.bucket.reset(now);
+                entry->limiter.reset_window(now / 1000000);
+            }
+        }
     }
     
     LOG_INFO("RateLimiter configuration updated");
 }
 
-const RateLimiter::RateLimitConfig& RateLimiter::get_config() const {
-    return config_;
+RateLimiter::RateLimitConfig RateLimiter::get_config() const {
+    return config_.load();
 }
 
 RateLimiter::RateLimiterStats RateLimiter::get_stats() const {
     RateLimiterStats stats;
     
-    stats.total_requests = total_requests_.load();
-    stats.allowed_requests = allowed_requests_.load();
-    stats.denied_requests = denied_requests_.load();
-    stats.active_clients = client_limiters_.size();
+    stats.allowed_requests = 0;
+    stats.denied_requests = 0;
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        stats.allowed_requests += shards_[s].allowed_requests.load(std::memory_order_relaxed);
+        stats.denied_requests += shards_[s].denied_requests.load(std::memory_order_relaxed);
+    }
+    stats.total_requests = stats.allowed_requests + stats.denied_requests;
+    stats.active_clients = active_clients_.load(std::memory_order_relaxed);
     stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start_time_);
     
@@ -232,19 +425,22 @@ RateLimiter::RateLimiterStats RateLimiter::get_stats() const {
 RateLimiter::ClientStats RateLimiter::get_client_stats(const std::string& client_id) const {
     ClientStats stats;
     
-    std::lock_guard<std::mutex> lock(client_mutex_);
-    
-    auto it = client_limiters_.find(client_id);
-    if (it != client_limiters_.end()) {
-        ClientLimiter* limiter = it->second.get();
-        stats.request_count = limiter->request_count.load();
-        stats.available_tokens = limiter->bucket->tokens.load();
+    size_t hash = std::hash<std::string>{}(client_id);
+    ReadGuard guard(shard_for(hash));
+    ClientEntry* entry = find_entry(client_id, hash);
+    if (entry) {
+        const ClientLimiter& limiter = entry->limiter;
+        RateLimitConfig config = config_.load();
+        uint64_t now_nanos = now_ns();
+        stats.request_count = limiter.request_count();
+        stats.available_tokens = limiter.bucket.available(config.max_requests_per_second,
+                                                          config.burst_capacity, now_nanos);
         
-        auto now = std::chrono::steady_clock::now();
-        auto window_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - limiter->window_start);
+        uint64_t now = now_nanos / 1000000;
+        uint64_t start = limiter.window_start_ms();
+        auto window_elapsed = std::chrono::milliseconds(now > start ? now - start : 0);
         stats.window_remaining = std::chrono::milliseconds(
-            config_.window_size.count() * 1000) - window_elapsed;
+            config.window_size.count() * 1000) - window_elapsed;
         
         if (stats.window_remaining.count() < 0) {
             stats.window_remaining = std::chrono::milliseconds(0);
@@ -259,123 +455,161 @@ RateLimiter::ClientStats RateLimiter::get_client_stats(const std::string& client
 }
 
 void RateLimiter::reset_all_clients() {
-    std::lock_guard<std::mutex> lock(client_mutex_);
+    uint64_t now = now_ms();
     
-    for (auto& pair : client_limiters_) {
-        pair.second->reset_window();
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        std::lock_guard<std::mutex> lock(shard.removal_mutex);
+        
+        for (auto& bucket : shard.buckets) {
+            for (ClientEntry* entry = bucket.load(std::memory_order_acquire); entry;
+                 entry = entry->next.load(std::memory_order_acquire)) {
+                entry->limiter.reset_window(now);
+            }
+        }
     }
     
     LOG_INFO("Reset all client limiters");
 }
 
 void RateLimiter::cleanup_expired_clients(std::chrono::seconds max_idle_time) {
-    std::lock_guard<std::mutex> lock(client_mutex_);
-    
-    auto now = std::chrono::steady_clock::now();
-    auto it = client_limiters_.begin();
-    
-    while (it != client_limiters_.end()) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - it->second->window_start);
+    const uint64_t now = now_ms();
+    const uint64_t max_idle_ms = static_cast<uint64_t>(max_idle_time.count()) * 1000;
+    const uint64_t window_ms = static_cast<uint64_t>(config_.load().window_size.count()) * 1000;
+    
+    for (size_t s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        std::lock_guard<std::mutex> lock(shard.removal_mutex);
+        std::vector<ClientEntry*> unlinked;
         
-        if (elapsed > max_idle_time && it->second->request_count.load() == 0) {
-            LOG_DEBUG("Removing expired client: " + it->first);
-            it = client_limiters_.erase(it);
-        } else {
-            ++it;
+        for (auto& bucket : shard.buckets) {
+            ClientEntry* entry = bucket.load(std::memory_order_acquire);
+            while (entry) {
+                // Unlinking leaves the entry's next pointer intact
+                ClientEntry* next = entry->next.load(std::memory_order_acquire);
+                
+                uint64_t start = entry->limiter.window_start_ms();
+                uint64_t elapsed = now > start ? now - start : 0;
+                
+                // A count from a window that has already ended no longer applies
+                uint32_t request_count = elapsed >= window_ms ? 0 : entry->limiter.request_count();
+                
+                if (elapsed > max_idle_ms && request_count == 0) {
+                    LOG_DEBUG("Removing expired client: " + entry->client_id);
+                    unlink_entry_locked(entry);
+                    unlinked.push_back(entry);
+                }
+                entry = next;
+            }
+        }
+        
+        // One wait covers every entry unlinked from this shard
+        if (!unlinked.empty()) {
+            shard.synchronize();
+            for (ClientEntry* entry : unlinked) {
+                delete entry;
+            }
         }
     }
 }
 
 // SlidingWindowRateLimiter implementation
 SlidingWindowRateLimiter::SlidingWindowRateLimiter(uint32_t max_requests, std::chrono::seconds window)
-    : max_requests_per_window_(max_requests), window_size_(window) {
+    : max_requests_per_window_(max_requests), window_size_(window),
+      start_time_(std::chrono::steady_clock::now()) {
     
     LOG_INFO("Creating SlidingWindowRateLimiter with " + std::to_string(max_requests) + 
              " requests per " + std::to_string(window.count()) + " second window");
 }
 
+void SlidingWindowRateLimiter::current_position(uint64_t& window_index, double& elapsed_fraction) const {
+    auto window_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(window_size_).count();
+    auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time_).count();
+    
+    if (window_ns <= 0) {
+        window_index = static_cast<uint64_t>(now_ns);
+        elapsed_fraction = 0.0;
+        return;
+    }
+    
+    window_index = static_cast<uint64_t>(now_ns / window_ns);
+    elapsed_fraction = static_cast<double>(now_ns % window_ns) / static_cast<double>(window_ns);
+}
+
 bool SlidingWindowRateLimiter::is_allowed(const std::string& client_id) {
+    uint64_t window_index;
+    double elapsed_fraction;
+    current_position(window_index, elapsed_fraction);
+    
     std::lock_guard<std::mutex> lock(client_mutex_);
     
     // Get or create request window for client
-    auto it = client_windows_.find(client_id);
-    if (it == client_windows_.end()) {
-        client_windows_[client_id] = std::make_unique<RequestWindow>();
-        it = client_windows_.find(client_id);
-    }
-    
-    RequestWindow* window = it->second.get();
-    
-    // Clean up old requests
-    window->cleanup_old_requests(window_size_);
+    RequestWindow& window = client_windows_[client_id];
+    window.advance(window_index);
     
-    // Check if we're within the limit
-    uint32_t current_requests = window->get_request_count(window_size_);
-    if (current_requests >= max_requests_per_window_) {
+    // Check if we're within the limit, counting this request
+    if (window.estimate(elapsed_fraction) + 1.0 > max_requests_per_window_) {
         return false;
     }
     
     // Add the new request
-    window->add_request();
+    window.current_count++;
     return true;
 }
 
 uint32_t SlidingWindowRateLimiter::get_request_count(const std::string& client_id) const {
+    uint64_t window_index;
+    double elapsed_fraction;
+    current_position(window_index, elapsed_fraction);
+    
     std::lock_guard<std::mutex> lock(client_mutex_);
     
     auto it = client_windows_.find(client_id);
     if (it != client_windows_.end()) {
-        return it->second->get_request_count(window_size_);
+        RequestWindow window = it->second;
+        window.advance(window_index);
+        return static_cast<uint32_t>(window.estimate(elapsed_fraction));
     }
     
     return 0;
 }
 
 void SlidingWindowRateLimiter::cleanup_old_requests() {
+    uint64_t window_index;
+    double elapsed_fraction;
+    current_position(window_index, elapsed_fraction);
+    
     std::lock_guard<std::mutex> lock(client_mutex_);
     
-    for (auto& pair : client_windows_) {
-        pair.second->cleanup_old_requests(window_size_);
+    // Forget clients with no requests in the current or previous window
+    auto it = client_windows_.begin();
+    while (it != client_windows_.end()) {
+        it->second.advance(window_index);
+        if (it->second.current_count == 0 && it->second.previous_count == 0) {
+            it = client_windows_.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
 // RequestWindow implementation
-void SlidingWindowRateLimiter::RequestWindow::add_request() {
-    std::lock_guard<std::mutex> lock(window_mutex);
-    requests.push_back(std::chrono::steady_clock::now());
-}
-
-uint32_t SlidingWindowRateLimiter::RequestWindow::get_request_count(std::chrono::seconds window_size) const {
-    std::lock_guard<std::mutex> lock(window_mutex);
-    
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - window_size;
-    
-    uint32_t count = 0;
-    for (const auto& request_time : requests) {
-        if (request_time > cutoff) {
-            count++;
-        }
+void SlidingWindowRateLimiter::RequestWindow::advance(uint64_t index) {
+    if (index == window_index) {
+        return;
     }
     
-    return count;
+    // The current window becomes the previous one only if they are adjacent
+    previous_count = index == window_index + 1 ? current_count : 0;
+    current_count = 0;
+    window_index = index;
 }
 
-void SlidingWindowRateLimiter::RequestWindow::cleanup_old_requests(std::chrono::seconds window_size) {
-    std::lock_guard<std::mutex> lock(window_mutex);
-    
-    auto now = std::chrono::steady_clock::now();
-    auto cutoff = now - window_size;
-    
-    // Remove old requests
-    requests.erase(
-        std::remove_if(requests.begin(), requests.end(),
-                      [cutoff](const auto& request_time) {
-                          return request_time <= cutoff;
-                      }),
-        requests.end()
-    );
+double SlidingWindowRateLimiter::RequestWindow::estimate(double elapsed_fraction) const {
+    // Assume the previous window's requests were spread evenly, so the part
+    // of it still inside the sliding window is proportional to what remains
+    return previous_count * (1.0 - elapsed_fraction) + current_count;
 }
 
 } // namespace utils
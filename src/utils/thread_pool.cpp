@@ -7,40 +7,170 @@
 namespace dfs {
 namespace utils {
 
+namespace {
+
+// Pool and slot of the worker running on this thread, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+inline int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Fixed-point scale for virtual time, so short tasks on heavy lanes still advance it
+constexpr uint64_t FAIR_SHARE_SCALE = 1024;
+
+// Add to a counter only its owning thread writes
+inline void add_owned(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline uint64_t next_random(uint64_t& state) {
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // namespace
+
+// Configuration implementation
+ThreadPool::ThreadPoolConfig::ThreadPoolConfig(size_t min_threads, size_t max_threads,
+                                               std::chrono::seconds timeout, bool work_stealing,
+                                               std::chrono::milliseconds grow_latency,
+                                               std::array<uint32_t, PRIORITY_LEVELS> weights,
+                                               std::chrono::milliseconds max_wait,
+                                               Affinity worker_affinity)
+    : min_threads(min_threads), max_threads(max_threads), thread_timeout(timeout),
+      enable_work_stealing(work_stealing), grow_latency_threshold(grow_latency),
+      lane_weights(weights), max_lane_wait(max_wait), affinity(worker_affinity) {}
+
 // Task implementation
-ThreadPool::Task::Task(std::function<void()> func, Priority prio)
-    : function(std::move(func)), priority(prio), 
+ThreadPool::Task::Task(InlineTask func, Priority prio)
+    : function(std::move(func)), priority(prio),
       created_time(std::chrono::steady_clock::now()) {}
 
-bool ThreadPool::Task::operator<(const Task& other) const {
-    // Higher priority tasks come first
-    if (priority != other.priority) {
-        return static_cast<int>(priority) < static_cast<int>(other.priority);
+void* ThreadPool::Task::operator new(size_t size) {
+    return BlockPool::allocate(size);
+}
+
+void ThreadPool::Task::operator delete(void* pointer, size_t size) noexcept {
+    BlockPool::deallocate(pointer, size);
+}
+
+// Histogram implementation
+ThreadPool::TaskHistogram::TaskHistogram() : count(0), total(0) {
+    buckets.fill(0);
+}
+
+std::chrono::nanoseconds ThreadPool::TaskHistogram::mean() const {
+    return count > 0 ? total / static_cast<int64_t>(count) : std::chrono::nanoseconds(0);
+}
+
+std::chrono::nanoseconds ThreadPool::TaskHistogram::percentile(double quantile) const {
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
     }
     
-    // For same priority, older tasks come first (FIFO)
-    return created_time > other.created_time;
+    uint64_t rank = static_cast<uint64_t>(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > rank || seen == count) {
+            return std::chrono::nanoseconds(i == 0 ? 1 : int64_t(1) << i);
+        }
+    }
+    return std::chrono::nanoseconds(int64_t(1) << (BUCKETS - 1));
+}
+
+size_t ThreadPool::TaskHistogram::bucket_for(uint64_t nanoseconds) {
+    if (nanoseconds == 0) {
+        return 0;
+    }
+    size_t bits = 64 - static_cast<size_t>(__builtin_clzll(nanoseconds));
+    return std::min(bits, BUCKETS - 1);
+}
+
+ThreadPool::WorkerCounters::WorkerCounters() : failed(0), busy_ns(0), started_ns(0) {
+    for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+        for (size_t i = 0; i < TaskHistogram::BUCKETS; ++i) {
+            wait_buckets[lane][i] = 0;
+            exec_buckets[lane][i] = 0;
+        }
+        wait_ns[lane] = 0;
+        exec_ns[lane] = 0;
+        executed[lane] = 0;
+    }
 }
 
+ThreadPool::Worker::Worker(uint64_t seed, size_t node_index, int cpu_index)
+    : steal_seed(seed | 1), retired(false), node(node_index), cpu(cpu_index) {}
+
 // ThreadPool implementation
 ThreadPool::ThreadPool(size_t min_threads, size_t max_threads)
-    : stop_(false), max_threads_(max_threads), min_threads_(min_threads),
-      thread_timeout_(std::chrono::seconds(300)), start_time_(std::chrono::steady_clock::now()) {
+    : ThreadPool(ThreadPoolConfig(min_threads, max_threads)) {}
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& config)
+    : thread_count_(0), injected_tasks_(0), affinity_(config.affinity), idle_workers_(0), queued_tasks_(0), stop_(false),
+      max_threads_(std::max<size_t>({config.max_threads, config.min_threads, 1})),
+      min_threads_(config.min_threads), thread_timeout_(config.thread_timeout),
+      work_stealing_(config.enable_work_stealing), grow_latency_threshold_(config.grow_latency_threshold),
+      queue_wait_ewma_us_(0), last_dispatch_ns_(steady_now_ns()), threads_started_(0), threads_retired_(0),
+      monitor_parked_(false), lane_weights_(config.lane_weights), max_lane_wait_(config.max_lane_wait), virtual_time_(0),
+      start_time_(std::chrono::steady_clock::now()) {
     
-    LOG_INFO("Creating ThreadPool with " + std::to_string(min_threads) + 
-             " min threads, " + std::to_string(max_threads) + " max threads");
+    LOG_INFO("Creating ThreadPool with " + std::to_string(min_threads_) +
+             " min threads, " + std::to_string(max_threads_) + " max threads" +
+             (work_stealing_ ? ", work stealing" : "") +
+             (affinity_ == Affinity::CORE ? ", pinned per core" :
+              affinity_ == Affinity::NODE ? ", pinned per NUMA node" : ""));
     
     // Initialize statistics
-    total_tasks_executed_ = 0;
     total_tasks_queued_ = 0;
     active_tasks_ = 0;
     
+    for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+        lane_weights_[lane] = std::max<uint32_t>(lane_weights_[lane], 1);
+        lane_queued_[lane] = 0;
+        lane_virtual_time_[lane] = 0;
+        lane_progress_ns_[lane] = 0;
+    }
+    
+    // Spread worker slots over NUMA nodes so every node gets workers as the
+    // pool grows; under CORE each slot on a node also gets its own core
+    const CpuTopology& topology = CpuTopology::get_instance();
+    size_t nodes = affinity_ == Affinity::NONE ? 1 : topology.get_node_count();
+    for (size_t node = 0; node < nodes && affinity_ != Affinity::NONE; ++node) {
+        node_queues_.push_back(std::make_unique<NodeQueue>());
+    }
+    
+    uint64_t seed = static_cast<uint64_t>(start_time_.time_since_epoch().count());
+    workers_.reserve(max_threads_);
+    for (size_t i = 0; i < max_threads_; ++i) {
+        size_t node = i % nodes;
+        int cpu = -1;
+        if (affinity_ == Affinity::CORE) {
+            const std::vector<int>& cpus = topology.get_nodes()[node].cpus;
+            cpu = cpus[(i / nodes) % cpus.size()];
+        }
+        workers_.push_back(std::make_unique<Worker>(seed + 0x9E3779B97F4A7C15ULL * (i + 1), node, cpu));
+    }
+    
     // Create initial worker threads
-    for (size_t i = 0; i < min_threads; ++i) {
-        workers_.emplace_back(&ThreadPool::worker_thread, this);
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        for (size_t i = 0; i < min_threads_; ++i) {
+            start_worker_locked();
+        }
+    }
+    
+    if (max_threads_ > min_threads_) {
+        monitor_ = std::thread(&ThreadPool::monitor_thread, this);
     }
     
-    LOG_INFO("ThreadPool created with " + std::to_string(workers_.size()) + " worker threads");
+    LOG_INFO("ThreadPool created with " + std::to_string(thread_count_.load()) + " worker threads");
 }
 
 ThreadPool::~ThreadPool() {
@@ -48,27 +178,18 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::enqueue(std::function<void()> task, Priority priority) {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        
-        if (stop_) {
-            LOG_WARN("Cannot enqueue task: ThreadPool is stopped");
-            throw std::runtime_error("ThreadPool is stopped");
-        }
-        
-        tasks_.emplace(std::move(task), priority);
-        total_tasks_queued_++;
-    }
-    
-    condition_.notify_one();
+    submit(std::make_unique<Task>(std::move(task), priority));
     
     // Adjust thread count if needed
     adjust_thread_count();
 }
 
+size_t ThreadPool::get_node_count() const {
+    return node_queues_.empty() ? 1 : node_queues_.size();
+}
+
 size_t ThreadPool::get_queue_size() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    return tasks_.size();
+    return queued_tasks_.load();
 }
 
 size_t ThreadPool::get_active_thread_count() const {
@@ -76,34 +197,77 @@ size_t ThreadPool::get_active_thread_count() const {
 }
 
 size_t ThreadPool::get_thread_count() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    return workers_.size();
+    return thread_count_.load();
 }
 
 void ThreadPool::wait_for_all_tasks() {
-    std::unique_lock<std::mutex> lock(queue_mutex_);
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
     
-    condition_.wait(lock, [this] { 
-        return tasks_.empty() && active_tasks_.load() == 0; 
+    idle_condition_.wait(lock, [this] {
+        return queued_tasks_.load() == 0 && active_tasks_.load() == 0;
     });
 }
 
 void ThreadPool::shutdown() {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
         stop_ = true;
     }
     
     condition_.notify_all();
     
-    // Join all worker threads
-    for (std::thread& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex_);
+    }
+    monitor_condition_.notify_all();
+    if (monitor_.joinable()) {
+        monitor_.join();
+    }
+    
+    // Join all worker threads outside workers_mutex_, which running tasks may
+    // need; they drain the queues before exiting
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                threads.push_back(std::move(worker->thread));
+            }
         }
     }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    thread_count_ = 0;
     
-    workers_.clear();
+    // Tasks that raced with shutdown are dropped
+    for (auto& worker : workers_) {
+        for (auto& lane : worker->lanes) {
+            Task* task = nullptr;
+            while (lane.steal(task)) {
+                delete task;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(injection_mutex_);
+        for (auto& lane : injection_) {
+            for (Task* task : lane) {
+                delete task;
+            }
+            lane.clear();
+        }
+    }
+    for (auto& node_queue : node_queues_) {
+        std::lock_guard<std::mutex> lock(node_queue->mutex);
+        for (auto& lane : node_queue->lanes) {
+            for (Task* task : lane) {
+                delete task;
+            }
+            lane.clear();
+        }
+        node_queue->tasks = 0;
+    }
     
     LOG_INFO("ThreadPool shutdown completed");
 }
@@ -112,103 +276,208 @@ bool ThreadPool::is_running() const {
     return !stop_.load();
 }
 
+bool ThreadPool::is_worker_thread() const {
+    return current_pool == this;
+}
+
 ThreadPool::ThreadPoolStats ThreadPool::get_stats() const {
     ThreadPoolStats stats;
     
-    stats.total_threads = workers_.size();
+    stats.total_threads = thread_count_.load();
     stats.active_threads = active_tasks_.load();
     stats.queued_tasks = get_queue_size();
-    stats.total_tasks_executed = total_tasks_executed_.load();
     stats.total_tasks_queued = total_tasks_queued_.load();
     stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start_time_);
     
-    // Calculate average task duration (simplified)
-    if (stats.total_tasks_executed > 0) {
-        stats.average_task_duration = std::chrono::milliseconds(
-            stats.uptime.count() / stats.total_tasks_executed);
+    // Averages come from the measured wait and execution time of every task run
+    uint64_t runs = 0;
+    uint64_t wait_ns = 0;
+    uint64_t exec_ns = 0;
+    stats.total_tasks_failed = 0;
+    for (const auto& worker : workers_) {
+        const WorkerCounters& counters = worker->counters;
+        for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+            runs += counters.executed[lane].load(std::memory_order_relaxed);
+            wait_ns += counters.wait_ns[lane].load(std::memory_order_relaxed);
+            exec_ns += counters.exec_ns[lane].load(std::memory_order_relaxed);
+        }
+        stats.total_tasks_failed += counters.failed.load(std::memory_order_relaxed);
+    }
+    stats.total_tasks_executed = runs - std::min(runs, stats.total_tasks_failed);
+    
+    if (runs > 0) {
+        stats.average_task_duration = static_cast<double>(exec_ns) / static_cast<double>(runs) / 1e6;
+        stats.average_queue_wait = static_cast<double>(wait_ns) / static_cast<double>(runs) / 1e6;
     } else {
-        stats.average_task_duration = std::chrono::milliseconds(0);
+        stats.average_task_duration = 0.0;
+        stats.average_queue_wait = 0.0;
     }
     
+    stats.idle_threads = idle_workers_.load();
+    stats.queue_latency = queue_latency();
+    stats.threads_started = threads_started_.load();
+    stats.threads_retired = threads_retired_.load();
+    
     return stats;
 }
 
+std::array<ThreadPool::PriorityTimings, ThreadPool::PRIORITY_LEVELS> ThreadPool::get_task_timings() const {
+    std::array<PriorityTimings, PRIORITY_LEVELS> timings;
+    
+    for (const auto& worker : workers_) {
+        const WorkerCounters& counters = worker->counters;
+        for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+            PriorityTimings& merged = timings[lane];
+            for (size_t i = 0; i < TaskHistogram::BUCKETS; ++i) {
+                merged.queue_wait.buckets[i] += counters.wait_buckets[lane][i].load(std::memory_order_relaxed);
+                merged.execution.buckets[i] += counters.exec_buckets[lane][i].load(std::memory_order_relaxed);
+            }
+            
+            uint64_t executed = counters.executed[lane].load(std::memory_order_relaxed);
+            merged.queue_wait.count += executed;
+            merged.execution.count += executed;
+            merged.queue_wait.total += std::chrono::nanoseconds(counters.wait_ns[lane].load(std::memory_order_relaxed));
+            merged.execution.total += std::chrono::nanoseconds(counters.exec_ns[lane].load(std::memory_order_relaxed));
+        }
+    }
+    
+    return timings;
+}
+
+std::vector<ThreadPool::WorkerUtilization> ThreadPool::get_worker_utilization() const {
+    std::vector<WorkerUtilization> result;
+    result.reserve(workers_.size());
+    int64_t now_ns = steady_now_ns();
+    
+    for (size_t index = 0; index < workers_.size(); ++index) {
+        const Worker& worker = *workers_[index];
+        const WorkerCounters& counters = worker.counters;
+        
+        WorkerUtilization entry;
+        entry.index = index;
+        entry.node = worker.node;
+        entry.cpu = worker.cpu;
+        entry.running = counters.started_ns.load() != 0 && !worker.retired.load();
+        entry.tasks_executed = 0;
+        for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+            entry.tasks_executed += counters.executed[lane].load(std::memory_order_relaxed);
+        }
+        
+        int64_t lifetime_ns = now_ns - counters.started_ns.load();
+        entry.utilization = (entry.running && lifetime_ns > 0)
+            ? std::min(1.0, static_cast<double>(counters.busy_ns.load(std::memory_order_relaxed)) /
+                            static_cast<double>(lifetime_ns))
+            : 0.0;
+        result.push_back(entry);
+    }
+    
+    return result;
+}
+
 void ThreadPool::set_thread_timeout(std::chrono::seconds timeout) {
     thread_timeout_ = timeout;
     LOG_DEBUG("Thread timeout set to " + std::to_string(timeout.count()) + " seconds");
 }
 
 std::chrono::seconds ThreadPool::get_thread_timeout() const {
-    return thread_timeout_;
+    return thread_timeout_.load();
 }
 
-void ThreadPool::worker_thread() {
-    LOG_DEBUG("Worker thread started");
+void ThreadPool::worker_thread(size_t index) {
+    current_pool = this;
+    current_worker = index;
+    
+    // Pin before the first allocation so BlockPool's cache and first-touched
+    // pages land on this worker's node
+    if (affinity_ != Affinity::NONE) {
+        const Worker& worker = *workers_[index];
+        std::vector<int> cpus = affinity_ == Affinity::CORE
+            ? std::vector<int>{worker.cpu}
+            : CpuTopology::get_instance().get_nodes()[worker.node].cpus;
+        if (!CpuTopology::pin_current_thread(cpus)) {
+            LOG_WARN("Failed to pin worker thread " + std::to_string(index) +
+                     " to NUMA node " + std::to_string(worker.node));
+        }
+    }
+    LOG_DEBUG("Worker thread " + std::to_string(index) + " started");
     
     while (true) {
-        std::function<void()> task;
-        
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            
-            // Wait for work or shutdown signal
-            condition_.wait(lock, [this] { 
-                return stop_ || !tasks_.empty(); 
-            });
-            
-            if (stop_ && tasks_.empty()) {
-                break;
-            }
+        Task* task = find_task(index);
+        if (task) {
+            run_task(task, index);
             
-            if (!tasks_.empty()) {
-                task = std::move(const_cast<Task&>(tasks_.top()).function);
-                tasks_.pop();
-                active_tasks_++;
-            }
+            // Work left behind a finished task may call for more threads
+            adjust_thread_count();
+            continue;
         }
         
-        if (task) {
-            try {
-                auto start_time = std::chrono::steady_clock::now();
-                
-                // Execute the task
-                task();
-                
-                auto end_time = std::chrono::steady_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    end_time - start_time);
-                
-                total_tasks_executed_++;
-                
-                LOG_DEBUG("Task executed in " + std::to_string(duration.count()) + "ms");
-                
-            } catch (const std::exception& e) {
-                LOG_ERROR("Task execution failed: " + std::string(e.what()));
-            } catch (...) {
-                LOG_ERROR("Task execution failed with unknown exception");
-            }
-            
-            active_tasks_--;
+        // Registering as idle before checking the queued count pairs with
+        // submit() bumping the count before checking for idle workers
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        idle_workers_++;
+        bool woken = condition_.wait_for(lock, thread_timeout_.load(), [this] {
+            return stop_ || queued_tasks_.load() > 0;
+        });
+        idle_workers_--;
+        
+        if (stop_ && queued_tasks_.load() == 0) {
+            break;
         }
         
-        // Adjust thread count periodically
-        adjust_thread_count();
+        // No longer counted as idle, so a submission either shows up here or
+        // wakes another worker
+        if (!woken && queued_tasks_.load() == 0 && try_retire_worker()) {
+            LOG_DEBUG("Worker thread " + std::to_string(index) + " retired after idle timeout");
+            current_pool = nullptr;
+            workers_[index]->retired = true;
+            return;
+        }
     }
     
-    LOG_DEBUG("Worker thread stopped");
+    current_pool = nullptr;
+    LOG_DEBUG("Worker thread " + std::to_string(index) + " stopped");
+}
+
+void ThreadPool::monitor_thread() {
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+    
+    while (!stop_) {
+        // Parking before checking the queued count pairs with submit() bumping
+        // the count before checking for a parked monitor
+        monitor_parked_ = true;
+        if (queued_tasks_.load() == 0 || thread_count_.load() >= max_threads_) {
+            monitor_condition_.wait(lock, [this] {
+                return stop_ || !monitor_parked_.load();
+            });
+            continue;
+        }
+        monitor_parked_ = false;
+        
+        // Work is queued: once the threshold passes without a dispatch, grow
+        monitor_condition_.wait_for(lock, grow_latency_threshold_, [this] {
+            return stop_.load();
+        });
+        lock.unlock();
+        adjust_thread_count();
+        lock.lock();
+    }
 }
 
 void ThreadPool::adjust_thread_count() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    // Only grow when no worker is idle, work is waiting, and it has waited too long
+    if (stop_ || thread_count_.load() >= max_threads_ || idle_workers_.load() > 0 ||
+        queued_tasks_.load() == 0 || queue_latency() < grow_latency_threshold_) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(workers_mutex_);
     
-    size_t current_threads = workers_.size();
-    size_t queue_size = tasks_.size();
-    size_t active_threads = active_tasks_.load();
+    size_t current_threads = thread_count_.load();
+    size_t queue_size = queued_tasks_.load();
     
     // Add threads if we have work and can add more
-    if (queue_size > 0 && current_threads < max_threads_ && 
-        active_threads >= current_threads * 0.8) {
+    if (!stop_ && queue_size > 0 && current_threads < max_threads_) {
         
         size_t threads_to_add = std::min(
             std::min(queue_size, max_threads_ - current_threads),
@@ -216,18 +485,307 @@ void ThreadPool::adjust_thread_count() {
         );
         
         for (size_t i = 0; i < threads_to_add; ++i) {
-            workers_.emplace_back(&ThreadPool::worker_thread, this);
-            LOG_DEBUG("Added worker thread, total: " + std::to_string(workers_.size()));
+            start_worker_locked();
+            LOG_DEBUG("Added worker thread, total: " + std::to_string(thread_count_.load()));
+        }
+    }
+}
+
+void ThreadPool::start_worker_locked() {
+    for (size_t index = 0; index < workers_.size(); ++index) {
+        Worker& worker = *workers_[index];
+        
+        // A retired thread has returned or is about to, so joining is immediate
+        if (worker.thread.joinable() && worker.retired) {
+            worker.thread.join();
+        }
+        if (!worker.thread.joinable()) {
+            // Utilization covers the new thread's lifetime only
+            worker.counters.busy_ns = 0;
+            worker.counters.started_ns = steady_now_ns();
+            worker.retired = false;
+            worker.thread = std::thread(&ThreadPool::worker_thread, this, index);
+            thread_count_++;
+            threads_started_++;
+            return;
+        }
+    }
+}
+
+bool ThreadPool::try_retire_worker() {
+    size_t count = thread_count_.load();
+    while (count > min_threads_) {
+        if (thread_count_.compare_exchange_weak(count, count - 1)) {
+            threads_retired_++;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::chrono::microseconds ThreadPool::queue_latency() const {
+    int64_t latency_us = queue_wait_ewma_us_.load(std::memory_order_relaxed);
+    
+    if (queued_tasks_.load() > 0) {
+        int64_t since_dispatch_us = (steady_now_ns() - last_dispatch_ns_.load(std::memory_order_relaxed)) / 1000;
+        latency_us = std::max(latency_us, since_dispatch_us);
+    }
+    return std::chrono::microseconds(latency_us);
+}
+
+void ThreadPool::submit(std::unique_ptr<Task> task, int node) {
+    if (stop_) {
+        LOG_WARN("Cannot enqueue task: ThreadPool is stopped");
+        throw std::runtime_error("ThreadPool is stopped");
+    }
+    
+    size_t lane = static_cast<size_t>(task->priority);
+    queued_tasks_++;
+    total_tasks_queued_++;
+    
+    // A lane that was empty starts at the current virtual time, so time it
+    // spent idle does not become credit, and its aging clock starts now
+    if (lane_queued_[lane]++ == 0) {
+        uint64_t now_virtual = virtual_time_.load(std::memory_order_relaxed);
+        if (lane_virtual_time_[lane].load(std::memory_order_relaxed) < now_virtual) {
+            lane_virtual_time_[lane].store(now_virtual, std::memory_order_relaxed);
+        }
+        lane_progress_ns_[lane].store(steady_now_ns(), std::memory_order_relaxed);
+    }
+    
+    bool routed = node >= 0 && !node_queues_.empty();
+    size_t target = routed ? static_cast<size_t>(node) % node_queues_.size() : 0;
+    
+    if (work_stealing_ && current_pool == this && (!routed || workers_[current_worker]->node == target)) {
+        // Only the owning worker pushes to its deque
+        workers_[current_worker]->lanes[lane].push(task.release());
+    } else if (routed) {
+        NodeQueue& node_queue = *node_queues_[target];
+        std::lock_guard<std::mutex> lock(node_queue.mutex);
+        node_queue.lanes[lane].push_back(task.release());
+        node_queue.tasks++;
+    } else {
+        std::lock_guard<std::mutex> lock(injection_mutex_);
+        injection_[lane].push_back(task.release());
+        injected_tasks_++;
+    }
+    
+    wake_worker();
+    
+    if (monitor_parked_.load()) {
+        {
+            std::lock_guard<std::mutex> lock(monitor_mutex_);
+            monitor_parked_ = false;
+        }
+        monitor_condition_.notify_one();
+    }
+}
+
+void ThreadPool::wake_worker() {
+    if (idle_workers_.load() == 0) {
+        return;
+    }
+    
+    // Taking the lock orders this notify after a worker that saw no work has started waiting
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    condition_.notify_one();
+}
+
+size_t ThreadPool::order_lanes(size_t order[PRIORITY_LEVELS]) const {
+    int64_t now_ns = steady_now_ns();
+    bool overdue[PRIORITY_LEVELS];
+    uint64_t keys[PRIORITY_LEVELS];
+    size_t count = 0;
+    
+    for (size_t lane = 0; lane < PRIORITY_LEVELS; ++lane) {
+        if (lane_queued_[lane].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        
+        int64_t progress_ns = lane_progress_ns_[lane].load(std::memory_order_relaxed);
+        overdue[lane] = now_ns - progress_ns > max_lane_wait_.count();
+        
+        // Overdue lanes sort by how long they have waited, the rest by virtual time
+        keys[lane] = overdue[lane] ? static_cast<uint64_t>(progress_ns)
+                                   : lane_virtual_time_[lane].load(std::memory_order_relaxed);
+        
+        // Insertion sort; ties go to the higher priority
+        size_t position = count++;
+        while (position > 0) {
+            size_t previous = order[position - 1];
+            bool before = overdue[lane] != overdue[previous] ? overdue[lane] : keys[lane] <= keys[previous];
+            if (!before) {
+                break;
+            }
+            order[position] = previous;
+            position--;
         }
+        order[position] = lane;
+    }
+    
+    return count;
+}
+
+ThreadPool::Task* ThreadPool::find_task(size_t index) {
+    if (queued_tasks_.load() == 0) {
+        return nullptr;
     }
-    // Remove threads if we have too many and little work
-    else if (current_threads > min_threads_ && queue_size == 0 && 
-             active_threads < current_threads * 0.2) {
+    
+    size_t order[PRIORITY_LEVELS];
+    size_t lanes = order_lanes(order);
+    
+    Worker& self = *workers_[index];
+    for (size_t i = 0; i < lanes; ++i) {
+        size_t lane = order[i];
+        Task* task = nullptr;
+        if (self.lanes[lane].pop(task)) {
+            return task;
+        }
+        if (!node_queues_.empty() && (task = take_routed(self.node, lane)) != nullptr) {
+            return task;
+        }
+        if ((task = take_injected(lane)) != nullptr) {
+            return task;
+        }
+        if (work_stealing_ && (task = steal_task(index, lane)) != nullptr) {
+            return task;
+        }
         
-        // Mark threads for removal (they will exit on next iteration)
-        // This is a simplified approach - in practice, you might want
-        // a more sophisticated thread management system
-        LOG_DEBUG("Thread pool has excess capacity, but keeping minimum threads");
+        // Work routed to another node runs here rather than waiting for
+        // that node's workers if they are all busy or not started
+        if (!node_queues_.empty() && (task = steal_remote_routed(index, lane)) != nullptr) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+ThreadPool::Task* ThreadPool::take_injected(size_t lane) {
+    if (injected_tasks_.load() == 0) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(injection_mutex_);
+    if (injection_[lane].empty()) {
+        return nullptr;
+    }
+    
+    Task* task = injection_[lane].front();
+    injection_[lane].pop_front();
+    injected_tasks_--;
+    return task;
+}
+
+ThreadPool::Task* ThreadPool::take_routed(size_t node, size_t lane) {
+    NodeQueue& node_queue = *node_queues_[node];
+    if (node_queue.tasks.load() == 0) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(node_queue.mutex);
+    if (node_queue.lanes[lane].empty()) {
+        return nullptr;
+    }
+    
+    Task* task = node_queue.lanes[lane].front();
+    node_queue.lanes[lane].pop_front();
+    node_queue.tasks--;
+    return task;
+}
+
+ThreadPool::Task* ThreadPool::steal_task(size_t index, size_t lane) {
+    size_t slots = workers_.size();
+    size_t start = static_cast<size_t>(next_random(workers_[index]->steal_seed) % slots);
+    size_t node = workers_[index]->node;
+    
+    // Victims on the same node first; a second pass crosses nodes
+    size_t passes = node_queues_.size() > 1 ? 2 : 1;
+    for (size_t pass = 0; pass < passes; ++pass) {
+        for (size_t i = 0; i < slots; ++i) {
+            size_t victim = (start + i) % slots;
+            if (victim == index || (passes > 1 && (workers_[victim]->node == node) != (pass == 0))) {
+                continue;
+            }
+            
+            Task* task = nullptr;
+            if (workers_[victim]->lanes[lane].steal(task)) {
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+ThreadPool::Task* ThreadPool::steal_remote_routed(size_t index, size_t lane) {
+    size_t node = workers_[index]->node;
+    for (size_t i = 1; i < node_queues_.size(); ++i) {
+        Task* task = take_routed((node + i) % node_queues_.size(), lane);
+        if (task) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::run_task(Task* task, size_t index) {
+    std::unique_ptr<Task> owned(task);
+    WorkerCounters& counters = workers_[index]->counters;
+    size_t lane = static_cast<size_t>(owned->priority);
+    
+    // Count the task as active before it stops counting as queued
+    active_tasks_++;
+    queued_tasks_--;
+    lane_queued_[lane]--;
+    
+    int64_t start_ns = steady_now_ns();
+    lane_progress_ns_[lane].store(start_ns, std::memory_order_relaxed);
+    
+    uint64_t dispatched_virtual = lane_virtual_time_[lane].load(std::memory_order_relaxed);
+    if (dispatched_virtual > virtual_time_.load(std::memory_order_relaxed)) {
+        virtual_time_.store(dispatched_virtual, std::memory_order_relaxed);
+    }
+    
+    int64_t created_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        owned->created_time.time_since_epoch()).count();
+    uint64_t wait_ns = static_cast<uint64_t>(std::max<int64_t>(0, start_ns - created_ns));
+    
+    // Fold the wait into the smoothed latency (weight 1/8); lost updates
+    // between workers only make the average slightly less smooth
+    int64_t wait_us = static_cast<int64_t>(wait_ns / 1000);
+    int64_t average_us = queue_wait_ewma_us_.load(std::memory_order_relaxed);
+    queue_wait_ewma_us_.store(average_us + (wait_us - average_us) / 8, std::memory_order_relaxed);
+    last_dispatch_ns_.store(start_ns, std::memory_order_relaxed);
+    
+    try {
+        // Execute the task
+        owned->function();
+    } catch (const std::exception& e) {
+        add_owned(counters.failed, 1);
+        LOG_ERROR("Task execution failed: " + std::string(e.what()));
+    } catch (...) {
+        add_owned(counters.failed, 1);
+        LOG_ERROR("Task execution failed with unknown exception");
+    }
+    
+    uint64_t exec_ns = static_cast<uint64_t>(std::max<int64_t>(0, steady_now_ns() - start_ns));
+    add_owned(counters.wait_buckets[lane][TaskHistogram::bucket_for(wait_ns)], 1);
+    add_owned(counters.exec_buckets[lane][TaskHistogram::bucket_for(exec_ns)], 1);
+    add_owned(counters.wait_ns[lane], wait_ns);
+    add_owned(counters.exec_ns[lane], exec_ns);
+    add_owned(counters.executed[lane], 1);
+    add_owned(counters.busy_ns, exec_ns);
+    
+    // Charge the lane for the worker time it used, scaled by its share
+    lane_virtual_time_[lane].fetch_add((exec_ns + 1) * FAIR_SHARE_SCALE / lane_weights_[lane],
+                                       std::memory_order_relaxed);
+    
+    owned.reset();
+    
+    if (--active_tasks_ == 0 && queued_tasks_.load() == 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        idle_condition_.notify_all();
     }
 }
 
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include "core/block_cipher.h"
+#include "utils/exceptions.h"
+#include <openssl/evp.h>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dfs::core;
+
+namespace {
+
+std::vector<uint8_t> from_hex(const std::string& hex) {
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<uint8_t>(std::stoul(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> test_key(size_t size) {
+    std::vector<uint8_t> key(size);
+    for (size_t i = 0; i < size; ++i) {
+        key[i] = static_cast<uint8_t>(i * 13 + 1);
+    }
+    return key;
+}
+
+// Reference XTS encryption from libcrypto, tweaked by the little-endian sector number
+std::vector<uint8_t> reference_encrypt(const std::vector<uint8_t>& key, uint64_t sector,
+                                       const std::vector<uint8_t>& data) {
+    uint8_t iv[16] = {};
+    for (int i = 0; i < 8; ++i) {
+        iv[i] = static_cast<uint8_t>(sector >> (8 * i));
+    }
+    
+    const EVP_CIPHER* cipher = key.size() == BlockCipher::XTS_AES128_KEY_SIZE ? EVP_aes_128_xts() : EVP_aes_256_xts();
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    std::vector<uint8_t> out(data.size());
+    int length = 0;
+    EVP_EncryptInit_ex(ctx, cipher, nullptr, key.data(), iv);
+    EVP_EncryptUpdate(ctx, out.data(), &length, data.data(), static_cast<int>(data.size()));
+    EVP_CIPHER_CTX_free(ctx);
+    return out;
+}
+
+} // namespace
+
+TEST(BlockCipherTest, Ieee1619Vector2) {
+    BlockCipher cipher;
+    cipher.set_key(1, from_hex(std::string(32, '1') + std::string(32, '2')));
+    
+    std::vector<uint8_t> data(32, 0x44);
+    cipher.encrypt(1, 0x3333333333ULL, data.data(), data.size());
+    EXPECT_EQ(data, from_hex("c454185e6a16936e39334038acef838bfb186fff7480adc4289382ecd6d394f0"));
+    
+    cipher.decrypt(1, 0x3333333333ULL, data.data(), data.size());
+    EXPECT_EQ(data, std::vector<uint8_t>(32, 0x44));
+}
+
+TEST(BlockCipherTest, MatchesLibcryptoIncludingStealing) {
+    BlockCipher cipher;
+    
+    for (size_t key_size : {BlockCipher::XTS_AES128_KEY_SIZE, BlockCipher::XTS_AES256_KEY_SIZE}) {
+        std::vector<uint8_t> key = test_key(key_size);
+        cipher.set_key(7, key);
+        
+        // Whole blocks, a partial final block, and a full 4 KiB extent
+        for (size_t size : {16, 17, 31, 100, 4096, 4099}) {
+            std::vector<uint8_t> plaintext(size);
+            for (size_t i = 0; i < size; ++i) {
+                plaintext[i] = static_cast<uint8_t>(i ^ 0x5A);
+            }
+            
+            uint64_t sector = 0x0123456789ULL + size;
+            std::vector<uint8_t> data = plaintext;
+            cipher.encrypt(7, sector, data.data(), data.size());
+            EXPECT_EQ(data, reference_encrypt(key, sector, plaintext)) << "size " << size;
+            
+            cipher.decrypt(7, sector, data.data(), data.size());
+            EXPECT_EQ(data, plaintext) << "size " << size;
+        }
+    }
+}
+
+TEST(BlockCipherTest, ConcurrentCallsShareOneKey) {
+    BlockCipher cipher;
+    std::vector<uint8_t> key = test_key(64);
+    cipher.set_key(2, key);
+    
+    std::vector<uint8_t> plaintext(4096, 0x33);
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cipher, &key, &plaintext, &mismatches, t]() {
+            for (uint64_t sector = t; sector < 200; sector += 4) {
+                std::vector<uint8_t> data = plaintext;
+                cipher.encrypt(2, sector, data.data(), data.size());
+                if (data != reference_encrypt(key, sector, plaintext)) {
+                    ++mismatches;
+                }
+                cipher.decrypt(2, sector, data.data(), data.size());
+                if (data != plaintext) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+TEST(BlockCipherKeyTest, SectorChangesCiphertext) {
+    BlockCipher cipher;
+    cipher.set_key(1, test_key(32));
+    
+    std::vector<uint8_t> first(4096, 0);
+    std::vector<uint8_t> second(4096, 0);
+    cipher.encrypt(1, 10, first.data(), first.size());
+    cipher.encrypt(1, 11, second.data(), second.size());
+    EXPECT_NE(first, second);
+}
+
+TEST(BlockCipherKeyTest, RejectsBadKeys) {
+    BlockCipher cipher;
+    EXPECT_THROW(cipher.set_key(1, test_key(24)), dfs::utils::ConfigurationException);
+    EXPECT_THROW(cipher.set_key(1, std::vector<uint8_t>(32, 0x11)), dfs::utils::ConfigurationException);
+    EXPECT_FALSE(cipher.has_key(1));
+    
+    uint8_t data[16] = {};
+    EXPECT_THROW(cipher.encrypt(1, 0, data, sizeof(data)), dfs::utils::ConfigurationException);
+    
+    cipher.set_key(1, test_key(32));
+    EXPECT_THROW(cipher.encrypt(1, 0, data, 15), dfs::utils::FileSystemException);
+    
+    cipher.remove_key(1);
+    EXPECT_FALSE(cipher.has_key(1));
+}
+
+TEST(BlockCipherKeyTest, LoadsKeyFile) {
+    std::string path = testing::TempDir() + "dfs_cipher.key";
+    std::vector<uint8_t> key = test_key(64);
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(key.data()), static_cast<std::streamsize>(key.size()));
+    }
+    
+    BlockCipher from_file;
+    from_file.load_key_file(3, path);
+    BlockCipher direct;
+    direct.set_key(3, key);
+    
+    std::vector<uint8_t> a(64, 9);
+    std::vector<uint8_t> b(64, 9);
+    from_file.encrypt(3, 5, a.data(), a.size());
+    direct.encrypt(3, 5, b.data(), b.size());
+    EXPECT_EQ(a, b);
+    
+    std::remove(path.c_str());
+    EXPECT_THROW(from_file.load_key_file(4, path), dfs::utils::ConfigurationException);
+}
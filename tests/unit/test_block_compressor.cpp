@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include "core/block_compressor.h"
+#include "utils/exceptions.h"
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace dfs::core;
+
+namespace {
+
+const uint32_t BLOCK_SIZE = 4096;
+
+std::vector<uint8_t> text_group(size_t size) {
+    std::string text;
+    while (text.size() < size) {
+        text += "inode " + std::to_string(text.size() % 113) + " updated\n";
+    }
+    return std::vector<uint8_t>(text.begin(), text.begin() + size);
+}
+
+std::vector<uint8_t> random_group(size_t size) {
+    std::vector<uint8_t> data(size);
+    uint32_t state = 99;
+    for (uint8_t& byte : data) {
+        state = state * 1664525 + 1013904223;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(BlockCompressorTest, CompressibleGroupRoundTrips) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data = text_group(compressor.get_group_bytes());
+    
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    EXPECT_FALSE(extent.raw);
+    EXPECT_LT(compressor.blocks_for(extent.bytes.size()), 8u);
+    
+    BlockCompressor::ExtentHeader header;
+    std::memcpy(&header, extent.bytes.data(), sizeof(header));
+    EXPECT_EQ(header.magic, BlockCompressor::EXTENT_MAGIC);
+    EXPECT_EQ(header.raw_length, data.size());
+    
+    EXPECT_EQ(compressor.decode_extent(extent.bytes.data(), extent.bytes.size(), false), data);
+    EXPECT_EQ(compressor.get_stats().extents_compressed, 1u);
+}
+
+TEST(BlockCompressorTest, IncompressibleGroupIsStoredRawWithoutHeader) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data = random_group(compressor.get_group_bytes());
+    
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    EXPECT_TRUE(extent.raw);
+    EXPECT_EQ(extent.bytes, data);
+    EXPECT_EQ(compressor.blocks_for(extent.bytes.size()), 8u);
+    EXPECT_EQ(compressor.get_stats().extents_bypassed, 1u);
+    
+    EXPECT_EQ(compressor.decode_extent(extent.bytes.data(), extent.bytes.size(), true), data);
+}
+
+TEST(BlockCompressorTest, RawDataThatLooksLikeAHeaderStaysRaw) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data = random_group(compressor.get_group_bytes());
+    uint32_t magic = BlockCompressor::EXTENT_MAGIC;
+    std::memcpy(data.data(), &magic, sizeof(magic));
+    
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    ASSERT_TRUE(extent.raw);
+    EXPECT_EQ(compressor.decode_extent(extent.bytes.data(), extent.bytes.size(), true), data);
+}
+
+TEST(BlockCompressorTest, SingleBlockGroupIsNeverCompressed) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data(BLOCK_SIZE, 0);
+    
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    EXPECT_TRUE(extent.raw);
+    EXPECT_EQ(extent.bytes.size(), data.size());
+}
+
+TEST(BlockCompressorTest, CorruptExtentsAreRejected) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data = text_group(compressor.get_group_bytes());
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    ASSERT_FALSE(extent.raw);
+    
+    std::vector<uint8_t> flipped = extent.bytes;
+    flipped.back() ^= 0x01;
+    EXPECT_THROW(compressor.decode_extent(flipped.data(), flipped.size(), false),
+                 dfs::utils::FileSystemCorruptedException);
+    
+    // A raw length past the group size is refused before anything is allocated
+    std::vector<uint8_t> oversized = extent.bytes;
+    uint32_t raw_length = 0x7FFFFFFF;
+    std::memcpy(oversized.data() + offsetof(BlockCompressor::ExtentHeader, raw_length),
+                &raw_length, sizeof(raw_length));
+    EXPECT_THROW(compressor.decode_extent(oversized.data(), oversized.size(), false),
+                 dfs::utils::FileSystemCorruptedException);
+    
+    EXPECT_THROW(compressor.decode_extent(extent.bytes.data(), 8, false),
+                 dfs::utils::FileSystemCorruptedException);
+    std::vector<uint8_t> too_long(compressor.get_group_bytes() + 1);
+    EXPECT_THROW(compressor.decode_extent(too_long.data(), too_long.size(), true),
+                 dfs::utils::FileSystemCorruptedException);
+}
+
+TEST(BlockCompressorTest, ReadExtentCachesUntilInvalidated) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> data = text_group(compressor.get_group_bytes());
+    BlockCompressor::EncodedExtent extent = compressor.encode_extent(data.data(), data.size());
+    
+    int reads = 0;
+    auto reader = [&](uint32_t first_block) {
+        EXPECT_EQ(first_block, 40u);
+        reads++;
+        return extent.bytes;
+    };
+    
+    EXPECT_EQ(*compressor.read_extent(40, extent.raw, reader), data);
+    EXPECT_EQ(*compressor.read_extent(40, extent.raw, reader), data);
+    EXPECT_EQ(reads, 1);
+    
+    compressor.invalidate_extent(40);
+    compressor.read_extent(40, extent.raw, reader);
+    EXPECT_EQ(reads, 2);
+    
+    BlockCompressor::CompressionStats stats = compressor.get_stats();
+    EXPECT_EQ(stats.cache_hits, 1u);
+    EXPECT_EQ(stats.cache_misses, 2u);
+}
+
+TEST(BlockCompressorTest, InvalidateDuringLoadIsNotCached) {
+    BlockCompressor compressor(BLOCK_SIZE);
+    std::vector<uint8_t> old_data = text_group(compressor.get_group_bytes());
+    std::vector<uint8_t> new_data = random_group(compressor.get_group_bytes());
+    BlockCompressor::EncodedExtent old_extent = compressor.encode_extent(old_data.data(), old_data.size());
+    
+    // The extent is rewritten while the old contents are being read
+    auto stale_reader = [&](uint32_t first_block) {
+        compressor.invalidate_extent(first_block);
+        return old_extent.bytes;
+    };
+    EXPECT_EQ(*compressor.read_extent(8, false, stale_reader), old_data);
+    
+    auto fresh_reader = [&](uint32_t) { return new_data; };
+    EXPECT_EQ(*compressor.read_extent(8, true, fresh_reader), new_data);
+}
+
+TEST(BlockCompressorTest, CacheStaysWithinCapacity) {
+    BlockCompressor::CompressionConfig config;
+    config.cache_bytes = 3 * 8 * BLOCK_SIZE;
+    BlockCompressor compressor(BLOCK_SIZE, config);
+    std::vector<uint8_t> data = random_group(compressor.get_group_bytes());
+    
+    std::map<uint32_t, int> reads;
+    auto reader = [&](uint32_t first_block) {
+        reads[first_block]++;
+        return data;
+    };
+    
+    for (uint32_t first_block = 0; first_block < 5 * 8; first_block += 8) {
+        compressor.read_extent(first_block, true, reader);
+    }
+    
+    // The two oldest extents were evicted, the newest is still cached
+    compressor.read_extent(32, true, reader);
+    compressor.read_extent(0, true, reader);
+    EXPECT_EQ(reads[32], 1);
+    EXPECT_EQ(reads[0], 2);
+}
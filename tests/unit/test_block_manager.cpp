@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include "core/block_manager.h"
+#include "core/superblock.h"
+#include "utils/exceptions.h"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+using namespace dfs::core;
+
+TEST(BlockManagerTest, SuperBlockCopiesAreReserved) {
+    BlockManager blocks(8192, 4096);
+    
+    for (uint32_t block_id : SuperBlock::copy_block_numbers(8192, 4096)) {
+        EXPECT_FALSE(blocks.is_block_free(block_id));
+    }
+    EXPECT_EQ(blocks.get_free_block_count(), 8192u - 3);
+}
+
+TEST(BlockManagerTest, AllocateAndDeallocate) {
+    BlockManager blocks(256, 4096);
+    uint32_t free_blocks = blocks.get_free_block_count();
+    
+    uint32_t block_id = blocks.allocate_block();
+    EXPECT_FALSE(blocks.is_block_free(block_id));
+    EXPECT_EQ(blocks.get_block_ref_count(block_id), 1u);
+    EXPECT_EQ(blocks.get_free_block_count(), free_blocks - 1);
+    
+    blocks.deallocate_block(block_id);
+    EXPECT_TRUE(blocks.is_block_free(block_id));
+    EXPECT_EQ(blocks.get_block_ref_count(block_id), 0u);
+}
+
+TEST(BlockManagerTest, AllocationsReachSuperBlockCounters) {
+    SuperBlock superblock;
+    superblock.initialize(256);
+    uint32_t free_blocks = superblock.free_blocks;
+    
+    SuperBlockCounters counters(superblock);
+    BlockManager blocks(256, 4096);
+    blocks.set_counters(&counters);
+    
+    std::vector<uint32_t> allocated = blocks.allocate_blocks(4);
+    blocks.deallocate_block(allocated[0]);
+    
+    EXPECT_EQ(counters.get_free_blocks(), free_blocks - 3);
+    counters.fold();
+    EXPECT_EQ(superblock.free_blocks, free_blocks - 3);
+}
+
+TEST(BlockManagerTest, SharedBlockFreedWithLastReference) {
+    BlockManager blocks(256, 4096);
+    uint32_t block_id = blocks.allocate_block();
+    
+    blocks.add_block_ref(block_id);
+    blocks.add_block_ref(block_id);
+    EXPECT_EQ(blocks.get_block_ref_count(block_id), 3u);
+    
+    blocks.deallocate_block(block_id);
+    blocks.deallocate_block(block_id);
+    EXPECT_FALSE(blocks.is_block_free(block_id));
+    
+    blocks.deallocate_block(block_id);
+    EXPECT_TRUE(blocks.is_block_free(block_id));
+}
+
+TEST(BlockManagerTest, ShareBlocksIsAllOrNothing) {
+    BlockManager blocks(256, 4096);
+    uint32_t used = blocks.allocate_block();
+    uint32_t free_block = blocks.allocate_block();
+    blocks.deallocate_block(free_block);
+    
+    EXPECT_THROW(blocks.share_blocks({used, free_block}), dfs::utils::BlockNotFoundException);
+    EXPECT_EQ(blocks.get_block_ref_count(used), 1u);
+}
+
+TEST(BlockManagerTest, CowBlockKeepsSoleOwnerInPlace) {
+    BlockManager blocks(256, 4096);
+    uint32_t block_id = blocks.allocate_block();
+    EXPECT_EQ(blocks.cow_block(block_id), block_id);
+    
+    blocks.add_block_ref(block_id);
+    uint32_t copy = blocks.cow_block(block_id);
+    EXPECT_NE(copy, block_id);
+    EXPECT_EQ(blocks.get_block_ref_count(block_id), 1u);
+    EXPECT_EQ(blocks.get_block_ref_count(copy), 1u);
+}
+
+TEST(BlockManagerTest, CowIndirectBlockSharesChildren) {
+    BlockManager blocks(256, 4096);
+    std::map<uint32_t, std::vector<uint32_t>> indirect;
+    blocks.set_indirect_reader([&indirect](uint32_t block_id) { return indirect[block_id]; });
+    
+    uint32_t root = blocks.allocate_block();
+    std::vector<uint32_t> children = blocks.allocate_blocks(3);
+    indirect[root] = children;
+    
+    // Sharing the root shares the children without touching their counts
+    blocks.add_block_ref(root);
+    EXPECT_EQ(blocks.get_block_ref_count(children[0]), 1u);
+    
+    // The copy points at the same children, so each gains a reference
+    uint32_t copy = blocks.cow_block(root, 1);
+    EXPECT_NE(copy, root);
+    indirect[copy] = children;
+    EXPECT_EQ(blocks.get_block_ref_count(root), 1u);
+    for (uint32_t child : children) {
+        EXPECT_EQ(blocks.get_block_ref_count(child), 2u);
+    }
+    
+    // A sole owner writes in place and leaves the children alone
+    EXPECT_EQ(blocks.cow_block(copy, 1), copy);
+    EXPECT_EQ(blocks.get_block_ref_count(children[0]), 2u);
+}
+
+TEST(BlockManagerTest, CowIndirectBlockNeedsReader) {
+    BlockManager blocks(256, 4096);
+    uint32_t root = blocks.allocate_block();
+    blocks.add_block_ref(root);
+    
+    EXPECT_THROW(blocks.cow_block(root, 1), dfs::utils::FileSystemException);
+    EXPECT_EQ(blocks.get_block_ref_count(root), 2u);
+}
+
+TEST(BlockManagerTest, DeallocateTreeReleasesChildrenWithLastReference) {
+    BlockManager blocks(256, 4096);
+    std::map<uint32_t, std::vector<uint32_t>> indirect;
+    blocks.set_indirect_reader([&indirect](uint32_t block_id) { return indirect[block_id]; });
+    uint32_t free_blocks = blocks.get_free_block_count();
+    
+    uint32_t root = blocks.allocate_block();
+    uint32_t middle = blocks.allocate_block();
+    std::vector<uint32_t> children = blocks.allocate_blocks(2);
+    indirect[root] = {middle};
+    indirect[middle] = children;
+    blocks.add_block_ref(children[1]);
+    blocks.add_block_ref(root);
+    
+    // A shared root only loses a reference
+    blocks.deallocate_tree(root, 2);
+    EXPECT_FALSE(blocks.is_block_free(root));
+    EXPECT_FALSE(blocks.is_block_free(middle));
+    
+    blocks.deallocate_tree(root, 2);
+    EXPECT_TRUE(blocks.is_block_free(root));
+    EXPECT_TRUE(blocks.is_block_free(middle));
+    EXPECT_TRUE(blocks.is_block_free(children[0]));
+    EXPECT_EQ(blocks.get_block_ref_count(children[1]), 1u);
+    EXPECT_EQ(blocks.get_free_block_count(), free_blocks - 1);
+}
+
+TEST(BlockManagerTest, AttachLoadsPagesOnDemand) {
+    const uint32_t total_blocks = BlockManager::BITMAP_PAGE_SIZE * 3;
+    std::string path = testing::TempDir() + "dfs_bitmap_attach.img";
+    uint32_t block_id;
+    {
+        BlockManager blocks(total_blocks, 4096);
+        block_id = blocks.allocate_block();
+        
+        std::ofstream file(path, std::ios::binary);
+        blocks.serialize_bitmap(file);
+    }
+    
+    BlockManager attached(total_blocks, 4096);
+    attached.attach_bitmap(path, 0);
+    EXPECT_EQ(attached.get_loaded_page_count(), 0u);
+    
+    EXPECT_FALSE(attached.is_block_free(block_id));
+    EXPECT_EQ(attached.get_loaded_page_count(), 1u);
+    
+    EXPECT_TRUE(attached.is_block_free(total_blocks - 1));
+    EXPECT_EQ(attached.get_loaded_page_count(), 2u);
+    
+    std::remove(path.c_str());
+}
+
+TEST(BlockManagerTest, AttachRejectsOtherGeometry) {
+    std::string path = testing::TempDir() + "dfs_bitmap_geometry.img";
+    {
+        BlockManager blocks(256, 4096);
+        std::ofstream file(path, std::ios::binary);
+        blocks.serialize_bitmap(file);
+    }
+    
+    BlockManager attached(512, 4096);
+    EXPECT_THROW(attached.attach_bitmap(path, 0), dfs::utils::FileSystemException);
+    
+    std::remove(path.c_str());
+}
+
+TEST(BlockManagerTest, SerializeWithoutReleasedReferences) {
+    std::string path = testing::TempDir() + "dfs_bitmap_released.img";
+    BlockManager blocks(256, 4096);
+    uint32_t snapshot_only = blocks.allocate_block();
+    uint32_t shared = blocks.allocate_block();
+    blocks.add_block_ref(shared);
+    {
+        std::ofstream file(path, std::ios::binary);
+        blocks.serialize_bitmap(file, {{snapshot_only, 0}, {shared, 0}});
+        blocks.serialize_block_refs(file, {{snapshot_only, 0}, {shared, 0}});
+    }
+    
+    // The live state keeps the references
+    EXPECT_FALSE(blocks.is_block_free(snapshot_only));
+    EXPECT_EQ(blocks.get_block_ref_count(shared), 2u);
+    
+    BlockManager loaded(256, 4096);
+    std::ifstream file(path, std::ios::binary);
+    loaded.deserialize_bitmap(file);
+    loaded.deserialize_block_refs(file);
+    EXPECT_TRUE(loaded.is_block_free(snapshot_only));
+    EXPECT_EQ(loaded.get_block_ref_count(shared), 1u);
+    
+    std::remove(path.c_str());
+}
+
+TEST(BlockManagerTest, SerializeWithoutReleasedTrees) {
+    std::string path = testing::TempDir() + "dfs_bitmap_released_tree.img";
+    BlockManager blocks(256, 4096);
+    std::map<uint32_t, std::vector<uint32_t>> indirect;
+    blocks.set_indirect_reader([&indirect](uint32_t block_id) { return indirect[block_id]; });
+    
+    uint32_t root = blocks.allocate_block();
+    std::vector<uint32_t> children = blocks.allocate_blocks(2);
+    indirect[root] = children;
+    blocks.add_block_ref(children[0]);
+    {
+        std::ofstream file(path, std::ios::binary);
+        blocks.serialize_bitmap(file, {{root, 1}});
+        blocks.serialize_block_refs(file, {{root, 1}});
+    }
+    EXPECT_FALSE(blocks.is_block_free(children[1]));
+    
+    BlockManager loaded(256, 4096);
+    std::ifstream file(path, std::ios::binary);
+    loaded.deserialize_bitmap(file);
+    loaded.deserialize_block_refs(file);
+    EXPECT_TRUE(loaded.is_block_free(root));
+    EXPECT_TRUE(loaded.is_block_free(children[1]));
+    EXPECT_EQ(loaded.get_block_ref_count(children[0]), 1u);
+    
+    std::remove(path.c_str());
+}
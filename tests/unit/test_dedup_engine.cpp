@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "core/dedup_engine.h"
+#include "core/block_manager.h"
+#include "utils/exceptions.h"
+#include <map>
+#include <vector>
+
+using namespace dfs::core;
+
+namespace {
+
+// Blocks held in memory, standing in for the data area of the device
+class DedupFixture : public testing::Test {
+protected:
+    DedupFixture() : blocks_(256, 4096) {
+        reader_ = [this](uint32_t block_id) { return disk_[block_id]; };
+    }
+    
+    std::vector<uint8_t> block_of(uint8_t value) const {
+        return std::vector<uint8_t>(4096, value);
+    }
+    
+    // Write through the engine the way a writer would, committing new blocks
+    uint32_t write(DedupEngine& engine, const std::vector<uint8_t>& data, bool& is_duplicate) {
+        uint32_t block_id = engine.write_block(data, is_duplicate, reader_);
+        if (!is_duplicate) {
+            disk_[block_id] = data;
+            engine.commit_block(block_id);
+        }
+        return block_id;
+    }
+    
+    BlockManager blocks_;
+    std::map<uint32_t, std::vector<uint8_t>> disk_;
+    DedupEngine::BlockReader reader_;
+};
+
+} // namespace
+
+TEST(DedupFingerprintTest, DependsOnContent) {
+    std::vector<uint8_t> a(4096, 1);
+    std::vector<uint8_t> b(4096, 1);
+    EXPECT_TRUE(DedupEngine::fingerprint(a.data(), a.size()) == DedupEngine::fingerprint(b.data(), b.size()));
+    
+    b[4095] = 2;
+    EXPECT_FALSE(DedupEngine::fingerprint(a.data(), a.size()) == DedupEngine::fingerprint(b.data(), b.size()));
+}
+
+TEST_F(DedupFixture, InlineDuplicateSharesBlock) {
+    DedupEngine engine(blocks_);
+    bool is_duplicate;
+    
+    uint32_t first = write(engine, block_of(7), is_duplicate);
+    EXPECT_FALSE(is_duplicate);
+    uint32_t second = write(engine, block_of(7), is_duplicate);
+    EXPECT_TRUE(is_duplicate);
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(blocks_.get_block_ref_count(first), 2u);
+    
+    uint32_t other = write(engine, block_of(8), is_duplicate);
+    EXPECT_FALSE(is_duplicate);
+    EXPECT_NE(other, first);
+    
+    DedupEngine::DedupStats stats = engine.get_stats();
+    EXPECT_EQ(stats.blocks_written, 3u);
+    EXPECT_EQ(stats.duplicate_blocks, 1u);
+    EXPECT_EQ(stats.bytes_saved, 4096u);
+    EXPECT_EQ(stats.index_entries, 2u);
+}
+
+TEST_F(DedupFixture, UncommittedBlockIsNotMatched) {
+    DedupEngine engine(blocks_);
+    bool is_duplicate;
+    
+    // The first writer has not written its data yet
+    uint32_t first = engine.write_block(block_of(3), is_duplicate, reader_);
+    uint32_t second = engine.write_block(block_of(3), is_duplicate, reader_);
+    EXPECT_FALSE(is_duplicate);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(engine.get_stats().index_entries, 0u);
+    
+    disk_[first] = block_of(3);
+    engine.commit_block(first);
+    EXPECT_EQ(engine.get_stats().index_entries, 1u);
+}
+
+TEST_F(DedupFixture, VerifyCatchesChangedBlock) {
+    DedupEngine engine(blocks_);
+    bool is_duplicate;
+    
+    uint32_t first = write(engine, block_of(5), is_duplicate);
+    
+    // Changed behind the engine's back, as a fingerprint collision would look
+    disk_[first] = block_of(6);
+    uint32_t second = write(engine, block_of(5), is_duplicate);
+    EXPECT_FALSE(is_duplicate);
+    EXPECT_NE(second, first);
+    EXPECT_EQ(blocks_.get_block_ref_count(first), 1u);
+    EXPECT_EQ(engine.get_stats().verify_mismatches, 1u);
+}
+
+TEST_F(DedupFixture, OverwriteAndReleaseUnindex) {
+    DedupEngine engine(blocks_);
+    bool is_duplicate;
+    
+    uint32_t first = write(engine, block_of(1), is_duplicate);
+    engine.prepare_overwrite(first);
+    disk_[first] = block_of(2);
+    EXPECT_NE(write(engine, block_of(1), is_duplicate), first);
+    
+    uint32_t other = write(engine, block_of(9), is_duplicate);
+    engine.release_block(other);
+    EXPECT_TRUE(blocks_.is_block_free(other));
+    EXPECT_FALSE(is_duplicate);
+    write(engine, block_of(9), is_duplicate);
+    EXPECT_FALSE(is_duplicate);
+}
+
+TEST_F(DedupFixture, VerifiedInlineNeedsReader) {
+    DedupEngine engine(blocks_);
+    bool is_duplicate;
+    EXPECT_THROW(engine.write_block(block_of(1), is_duplicate), dfs::utils::ConfigurationException);
+    
+    DedupEngine unverified(blocks_, DedupEngine::DedupConfig(DedupEngine::Mode::INLINE, false));
+    uint32_t block_id = unverified.write_block(block_of(1), is_duplicate);
+    unverified.commit_block(block_id);
+    EXPECT_EQ(unverified.write_block(block_of(1), is_duplicate), block_id);
+    EXPECT_TRUE(is_duplicate);
+}
+
+TEST_F(DedupFixture, PostProcessFoldsDuplicates) {
+    DedupEngine engine(blocks_, DedupEngine::DedupConfig(DedupEngine::Mode::POST_PROCESS));
+    bool is_duplicate;
+    
+    std::vector<uint32_t> written;
+    for (uint8_t value : {4, 4, 5, 4}) {
+        uint32_t block_id = engine.write_block(block_of(value), is_duplicate);
+        EXPECT_FALSE(is_duplicate);
+        disk_[block_id] = block_of(value);
+        written.push_back(block_id);
+    }
+    EXPECT_EQ(engine.get_stats().pending_blocks, 4u);
+    
+    std::map<uint32_t, uint32_t> remapped;
+    size_t freed = engine.process_pending(reader_, [&remapped](uint32_t from, uint32_t to) {
+        remapped[from] = to;
+        return true;
+    });
+    
+    EXPECT_EQ(freed, 2u);
+    EXPECT_EQ(remapped, (std::map<uint32_t, uint32_t>{{written[1], written[0]}, {written[3], written[0]}}));
+    EXPECT_TRUE(blocks_.is_block_free(written[1]));
+    EXPECT_EQ(blocks_.get_block_ref_count(written[0]), 3u);
+    EXPECT_EQ(engine.get_stats().pending_blocks, 0u);
+}
+
+TEST_F(DedupFixture, PostProcessKeepsBlockWhenRemapRefuses) {
+    DedupEngine engine(blocks_, DedupEngine::DedupConfig(DedupEngine::Mode::POST_PROCESS));
+    bool is_duplicate;
+    
+    uint32_t first = engine.write_block(block_of(4), is_duplicate);
+    uint32_t second = engine.write_block(block_of(4), is_duplicate);
+    disk_[first] = block_of(4);
+    disk_[second] = block_of(4);
+    
+    EXPECT_EQ(engine.process_pending(reader_, [](uint32_t, uint32_t) { return false; }), 0u);
+    EXPECT_EQ(blocks_.get_block_ref_count(first), 1u);
+    EXPECT_EQ(blocks_.get_block_ref_count(second), 1u);
+}
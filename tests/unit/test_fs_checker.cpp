@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+#include "core/fs_checker.h"
+#include "core/block_manager.h"
+#include "core/inode.h"
+#include "utils/thread_pool.h"
+#include <sys/stat.h>
+#include <map>
+#include <vector>
+
+using namespace dfs::core;
+
+namespace {
+
+// A small volume: root directory at inode 1 listing the files added to it
+class CheckerFixture : public testing::Test {
+protected:
+    CheckerFixture() : blocks_(1024, 4096), table_(512), pool_(2, 2) {
+        table_.set_block_manager(&blocks_);
+        table_.get_inode(1)->initialize(S_IFDIR | 0755, 0, 0);
+        
+        options_.partition_size = 64;
+        options_.directory_reader = [this](uint32_t dir_inode) {
+            return directories_[dir_inode];
+        };
+        options_.indirect_reader = [this](uint32_t block_id) {
+            return indirect_[block_id];
+        };
+        blocks_.set_indirect_reader(options_.indirect_reader);
+    }
+    
+    uint32_t add_file(const std::vector<uint32_t>& direct, uint32_t indirect = 0) {
+        uint32_t inode_num = table_.allocate_inode();
+        Inode* inode = table_.get_inode(inode_num);
+        inode->initialize(S_IFREG | 0644, 0, 0);
+        for (size_t i = 0; i < direct.size(); ++i) {
+            inode->direct_blocks[i] = direct[i];
+        }
+        inode->indirect_block = indirect;
+        inode->update_checksum();
+        directories_[1].push_back(inode_num);
+        return inode_num;
+    }
+    
+    FileSystemChecker::CheckReport check() {
+        FileSystemChecker checker(table_, blocks_, pool_);
+        return checker.run(options_);
+    }
+    
+    BlockManager blocks_;
+    InodeTable table_;
+    dfs::utils::ThreadPool pool_;
+    FileSystemChecker::CheckOptions options_;
+    std::map<uint32_t, std::vector<uint32_t>> directories_;
+    std::map<uint32_t, std::vector<uint32_t>> indirect_;
+};
+
+} // namespace
+
+TEST_F(CheckerFixture, ConsistentVolumeIsClean) {
+    for (int i = 0; i < 100; ++i) {
+        add_file(blocks_.allocate_blocks(3));
+    }
+    
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+    EXPECT_TRUE(report.connectivity_checked);
+    EXPECT_EQ(report.inodes_checked, 101u);
+    EXPECT_EQ(report.blocks_checked, 1024u);
+}
+
+TEST_F(CheckerFixture, FindsLeakedDuplicateAndUnmarkedBlocks) {
+    uint32_t shared = blocks_.allocate_block();
+    add_file({shared});
+    add_file({shared});
+    uint32_t leaked = blocks_.allocate_block();
+    uint32_t unmarked = 900;
+    add_file({unmarked});
+    
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_EQ(report.duplicate_blocks, std::vector<uint32_t>({shared}));
+    EXPECT_EQ(report.leaked_blocks, std::vector<uint32_t>({leaked}));
+    EXPECT_EQ(report.unmarked_blocks, std::vector<uint32_t>({unmarked}));
+    EXPECT_FALSE(report.is_clean());
+}
+
+TEST_F(CheckerFixture, SharedBlocksAreNotDuplicates) {
+    uint32_t source = add_file(blocks_.allocate_blocks(2));
+    directories_[1].push_back(table_.clone_inode(source));
+    
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+}
+
+TEST_F(CheckerFixture, CloneWithIndirectBlocksDivergesOnWrite) {
+    uint32_t indirect = blocks_.allocate_block();
+    std::vector<uint32_t> children = blocks_.allocate_blocks(4);
+    indirect_[indirect] = children;
+    uint32_t source = add_file(blocks_.allocate_blocks(2), indirect);
+    uint32_t clone = table_.clone_inode(source);
+    directories_[1].push_back(clone);
+    
+    // The children are shared through the root alone
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+    
+    // Write the clone's third child: copy the path from the root down
+    Inode* inode = table_.get_inode(clone);
+    uint32_t clone_indirect = blocks_.cow_block(inode->indirect_block, 1);
+    ASSERT_NE(clone_indirect, indirect);
+    indirect_[clone_indirect] = children;
+    inode->indirect_block = clone_indirect;
+    
+    uint32_t written = blocks_.cow_block(children[2]);
+    ASSERT_NE(written, children[2]);
+    indirect_[clone_indirect][2] = written;
+    inode->update_checksum();
+    
+    EXPECT_EQ(table_.get_inode(source)->indirect_block, indirect);
+    EXPECT_EQ(indirect_[indirect], children);
+    EXPECT_EQ(blocks_.get_block_ref_count(children[2]), 1u);
+    EXPECT_EQ(blocks_.get_block_ref_count(children[0]), 2u);
+    report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+    
+    // Deleting the clone leaves the source's tree intact
+    blocks_.deallocate_tree(clone_indirect, 1);
+    for (uint32_t block_id : table_.get_inode(clone)->direct_blocks) {
+        if (block_id != 0) {
+            blocks_.deallocate_block(block_id);
+        }
+    }
+    table_.deallocate_inode(clone);
+    directories_[1].pop_back();
+    
+    EXPECT_TRUE(blocks_.is_block_free(written));
+    EXPECT_EQ(blocks_.get_block_ref_count(children[0]), 1u);
+    report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+}
+
+TEST_F(CheckerFixture, ReadOnlyCheckLeavesTableAlone) {
+    InodeTable table(64);
+    table.get_inode(1)->initialize(S_IFDIR | 0755, 0, 0);
+    uint32_t block_id = blocks_.allocate_block();
+    uint32_t inode_num = table.allocate_inode();
+    table.get_inode(inode_num)->initialize(S_IFREG | 0644, 0, 0);
+    table.get_inode(inode_num)->direct_blocks[0] = block_id;
+    table.get_inode(inode_num)->update_checksum();
+    directories_[1] = {inode_num};
+    
+    // No block manager is needed, and no reference is taken or dropped
+    FileSystemChecker checker(table, blocks_, pool_);
+    EXPECT_TRUE(checker.run(options_).is_clean());
+    table.get_inode(inode_num)->uid = 3;
+    EXPECT_EQ(blocks_.get_block_ref_count(block_id), 1u);
+}
+
+TEST_F(CheckerFixture, ChildrenOfSharedIndirectBlocksAreNotDuplicates) {
+    uint32_t indirect = blocks_.allocate_block();
+    indirect_[indirect] = blocks_.allocate_blocks(3);
+    blocks_.add_block_ref(indirect);
+    add_file({}, indirect);
+    add_file({}, indirect);
+    
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+}
+
+TEST_F(CheckerFixture, FindsOutOfRangePointersAndUnreachableInodes) {
+    uint32_t bad = add_file({5000});
+    uint32_t orphan = add_file({});
+    directories_[1].pop_back();
+    
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_EQ(report.out_of_range_pointers, std::vector<uint32_t>({bad}));
+    EXPECT_EQ(report.unreachable_inodes, std::vector<uint32_t>({orphan}));
+}
+
+TEST_F(CheckerFixture, RepairFixesBitmapAndPointers) {
+    uint32_t leaked = blocks_.allocate_block();
+    uint32_t bad = add_file({5000});
+    add_file({900});
+    
+    options_.repair = true;
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_EQ(report.repaired, 3u);
+    EXPECT_TRUE(blocks_.is_block_free(leaked));
+    EXPECT_FALSE(blocks_.is_block_free(900));
+    EXPECT_EQ(table_.get_inode(bad)->direct_blocks[0], 0u);
+    
+    options_.repair = false;
+    EXPECT_TRUE(check().is_clean());
+}
+
+TEST_F(CheckerFixture, IndirectChildrenAreOwned) {
+    uint32_t indirect = blocks_.allocate_block();
+    std::vector<uint32_t> children = blocks_.allocate_blocks(4);
+    indirect_[indirect] = children;
+    add_file({}, indirect);
+    
+    EXPECT_TRUE(check().is_clean());
+    
+    // Without a reader the children look leaked, so repair must keep them
+    options_.indirect_reader = nullptr;
+    options_.repair = true;
+    FileSystemChecker::CheckReport report = check();
+    EXPECT_EQ(report.leaked_blocks, children);
+    for (uint32_t child : children) {
+        EXPECT_FALSE(blocks_.is_block_free(child));
+    }
+}
+
+TEST_F(CheckerFixture, SnapshotBlocksAreInUse) {
+    uint32_t original = blocks_.allocate_block();
+    uint32_t inode_num = add_file({original});
+    
+    std::shared_ptr<InodeTable> snapshot = table_.snapshot();
+    Inode* live = table_.get_inode(inode_num);
+    uint32_t rewritten = blocks_.cow_block(original);
+    live->direct_blocks[0] = rewritten;
+    live->update_checksum();
+    
+    FileSystemChecker checker(table_, blocks_, pool_);
+    EXPECT_EQ(checker.run(options_).leaked_blocks, std::vector<uint32_t>({original}));
+    
+    checker.add_snapshot(snapshot);
+    FileSystemChecker::CheckReport report = checker.run(options_);
+    EXPECT_TRUE(report.is_clean()) << report.to_string();
+    
+    table_.release_snapshot(*snapshot);
+}
+
+TEST_F(CheckerFixture, ReportsProgressForEveryPhase) {
+    for (int i = 0; i < 20; ++i) {
+        add_file(blocks_.allocate_blocks(1));
+    }
+    
+    std::map<FileSystemChecker::Phase, uint64_t> completed;
+    options_.progress_callback = [&completed](const FileSystemChecker::CheckProgress& progress) {
+        EXPECT_LE(progress.completed, progress.total);
+        completed[progress.phase] = progress.completed;
+    };
+    check();
+    
+    EXPECT_EQ(completed[FileSystemChecker::Phase::INODES], 512u);
+    EXPECT_EQ(completed[FileSystemChecker::Phase::BLOCKS], 1024u);
+    EXPECT_EQ(completed.count(FileSystemChecker::Phase::CONNECTIVITY), 1u);
+}
@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+#include "core/inode.h"
+#include "core/block_manager.h"
+#include "utils/exceptions.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+
+using namespace dfs::core;
+
+namespace {
+
+// Allocate a regular file inode pointing at the given blocks
+uint32_t make_file(InodeTable& table, std::initializer_list<uint32_t> block_ids) {
+    uint32_t inode_num = table.allocate_inode();
+    Inode* inode = table.get_inode(inode_num);
+    inode->initialize(S_IFREG | 0644, 0, 0);
+    
+    size_t i = 0;
+    for (uint32_t block_id : block_ids) {
+        inode->direct_blocks[i++] = block_id;
+    }
+    inode->blocks = block_ids.size();
+    inode->size = block_ids.size() * 4096;
+    inode->update_checksum();
+    return inode_num;
+}
+
+} // namespace
+
+TEST(InodeTest, FastSymlinkRoundTrip) {
+    Inode inode;
+    inode.initialize(S_IFLNK | 0777, 0, 0);
+    
+    std::string target(Inode::FAST_SYMLINK_MAX, 'x');
+    target.replace(0, 12, "/var/lib/dfs");
+    ASSERT_TRUE(inode.set_fast_symlink_target(target));
+    
+    EXPECT_TRUE(inode.is_fast_symlink());
+    EXPECT_EQ(inode.get_fast_symlink_target(), target);
+    
+    // The target bytes are not block pointers
+    EXPECT_TRUE(inode.get_block_pointers().empty());
+}
+
+TEST(InodeTest, LongSymlinkTargetIsNotInline) {
+    Inode inode;
+    inode.initialize(S_IFLNK | 0777, 0, 0);
+    
+    EXPECT_FALSE(inode.set_fast_symlink_target(std::string(Inode::FAST_SYMLINK_MAX + 1, 'x')));
+    EXPECT_EQ(inode.size, 0u);
+}
+
+TEST(InodeTableTest, AllocateAndDeallocate) {
+    InodeTable table(64);
+    uint32_t free_inodes = table.get_free_inode_count();
+    
+    uint32_t inode_num = table.allocate_inode();
+    EXPECT_FALSE(table.is_inode_free(inode_num));
+    EXPECT_EQ(table.get_free_inode_count(), free_inodes - 1);
+    
+    table.deallocate_inode(inode_num);
+    EXPECT_TRUE(table.is_inode_free(inode_num));
+    EXPECT_EQ(table.get_free_inode_count(), free_inodes);
+}
+
+TEST(InodeTableTest, AttachLoadsChunksOnDemand) {
+    std::string path = testing::TempDir() + "dfs_inode_attach.img";
+    uint32_t inode_num;
+    uint32_t free_inodes;
+    {
+        InodeTable table(InodeTable::CHUNK_SIZE * 4);
+        inode_num = table.allocate_inode();
+        table.get_inode(inode_num)->initialize(S_IFREG | 0600, 7, 8);
+        free_inodes = table.get_free_inode_count();
+        
+        std::ofstream file(path, std::ios::binary);
+        file.write("HEADER", 6);
+        table.serialize(file);
+    }
+    
+    InodeTable attached(0);
+    attached.attach(path, 6);
+    EXPECT_EQ(attached.get_total_inode_count(), InodeTable::CHUNK_SIZE * 4);
+    EXPECT_EQ(attached.get_loaded_chunk_count(), 0u);
+    
+    const InodeTable& view = attached;
+    EXPECT_EQ(view.get_inode(inode_num)->uid, 7);
+    EXPECT_EQ(attached.get_loaded_chunk_count(), 1u);
+    
+    // Counting free inodes needs every chunk
+    EXPECT_EQ(attached.get_free_inode_count(), free_inodes);
+    EXPECT_EQ(attached.get_loaded_chunk_count(), 4u);
+    
+    std::remove(path.c_str());
+}
+
+TEST(InodeTableTest, HardLinksCountUpAndDown) {
+    InodeTable table(64);
+    uint32_t inode_num = make_file(table, {});
+    
+    EXPECT_EQ(table.link_inode(inode_num), 2u);
+    EXPECT_EQ(table.link_inode(inode_num), 3u);
+    EXPECT_EQ(table.unlink_inode(inode_num), 2u);
+    EXPECT_EQ(table.unlink_inode(inode_num), 1u);
+    EXPECT_EQ(table.unlink_inode(inode_num), 0u);
+    EXPECT_EQ(table.unlink_inode(inode_num), 0u);
+}
+
+TEST(InodeTableTest, HardLinkRefusesDirectoriesAndOverflow) {
+    InodeTable table(64);
+    uint32_t directory = table.allocate_inode();
+    table.get_inode(directory)->initialize(S_IFDIR | 0755, 0, 0);
+    EXPECT_THROW(table.link_inode(directory), dfs::utils::FileSystemException);
+    
+    uint32_t file = make_file(table, {});
+    table.get_inode(file)->link_count = Inode::MAX_LINK_COUNT;
+    EXPECT_THROW(table.link_inode(file), dfs::utils::FileSystemException);
+    EXPECT_EQ(table.get_inode(file)->link_count, Inode::MAX_LINK_COUNT);
+    
+    EXPECT_THROW(table.link_inode(file + 1), dfs::utils::InodeNotFoundException);
+}
+
+TEST(InodeTableTest, CloneSharesBlocks) {
+    BlockManager blocks(256, 4096);
+    InodeTable table(64);
+    table.set_block_manager(&blocks);
+    
+    uint32_t first = blocks.allocate_block();
+    uint32_t second = blocks.allocate_block();
+    uint32_t source = make_file(table, {first, second});
+    table.link_inode(source);
+    
+    uint32_t clone = table.clone_inode(source);
+    EXPECT_NE(clone, source);
+    EXPECT_EQ(table.get_inode(clone)->direct_blocks[0], first);
+    EXPECT_EQ(table.get_inode(clone)->link_count, 1u);
+    EXPECT_EQ(blocks.get_block_ref_count(first), 2u);
+    EXPECT_EQ(blocks.get_block_ref_count(second), 2u);
+    
+    // Writing the clone's first block moves it to a block of its own
+    uint32_t copy = blocks.cow_block(first);
+    EXPECT_NE(copy, first);
+    table.get_inode(clone)->direct_blocks[0] = copy;
+    EXPECT_EQ(blocks.get_block_ref_count(first), 1u);
+    EXPECT_EQ(blocks.get_block_ref_count(copy), 1u);
+    EXPECT_EQ(table.get_inode(source)->direct_blocks[0], first);
+}
+
+TEST(InodeTableTest, CloneRefusesDirectories) {
+    BlockManager blocks(256, 4096);
+    InodeTable table(64);
+    table.set_block_manager(&blocks);
+    
+    uint32_t directory = table.allocate_inode();
+    table.get_inode(directory)->initialize(S_IFDIR | 0755, 0, 0);
+    EXPECT_THROW(table.clone_inode(directory), dfs::utils::FileSystemException);
+}
+
+TEST(InodeTableTest, SnapshotKeepsOldPointers) {
+    BlockManager blocks(256, 4096);
+    InodeTable table(64);
+    table.set_block_manager(&blocks);
+    
+    uint32_t original = blocks.allocate_block();
+    uint32_t inode_num = make_file(table, {original});
+    
+    std::shared_ptr<InodeTable> snapshot = table.snapshot();
+    
+    // Changing the live inode copies its chunk, adding a reference to every block in it
+    Inode* live = table.get_inode(inode_num);
+    EXPECT_EQ(blocks.get_block_ref_count(original), 2u);
+    
+    uint32_t rewritten = blocks.cow_block(original);
+    live->direct_blocks[0] = rewritten;
+    EXPECT_NE(rewritten, original);
+    
+    const InodeTable& view = *snapshot;
+    EXPECT_EQ(view.get_inode(inode_num)->direct_blocks[0], original);
+    std::vector<BlockTree> snapshot_only = table.snapshot_only_blocks();
+    ASSERT_EQ(snapshot_only.size(), 1u);
+    EXPECT_EQ(snapshot_only[0].block_id, original);
+    EXPECT_EQ(snapshot_only[0].depth, 0u);
+    
+    // Releasing the snapshot frees the block only it still pointed to
+    table.release_snapshot(*snapshot);
+    EXPECT_TRUE(blocks.is_block_free(original));
+    EXPECT_FALSE(blocks.is_block_free(rewritten));
+    EXPECT_EQ(snapshot->get_total_inode_count(), 0u);
+}
+
+TEST(InodeTableTest, CloneSharesIndirectChildrenThroughRoot) {
+    BlockManager blocks(256, 4096);
+    std::map<uint32_t, std::vector<uint32_t>> indirect;
+    blocks.set_indirect_reader([&indirect](uint32_t block_id) { return indirect[block_id]; });
+    InodeTable table(64);
+    table.set_block_manager(&blocks);
+    
+    uint32_t root = blocks.allocate_block();
+    std::vector<uint32_t> children = blocks.allocate_blocks(2);
+    indirect[root] = children;
+    uint32_t source = make_file(table, {});
+    table.get_inode(source)->indirect_block = root;
+    
+    uint32_t clone = table.clone_inode(source);
+    EXPECT_EQ(blocks.get_block_ref_count(root), 2u);
+    EXPECT_EQ(blocks.get_block_ref_count(children[0]), 1u);
+    
+    // Deleting the clone drops its root reference and leaves the tree whole
+    blocks.deallocate_tree(table.get_inode(clone)->indirect_block, 1);
+    table.deallocate_inode(clone);
+    EXPECT_EQ(blocks.get_block_ref_count(root), 1u);
+    EXPECT_FALSE(blocks.is_block_free(children[1]));
+}
+
+TEST(InodeTableTest, SnapshotOfAttachedTableLoadsNothing) {
+    std::string path = testing::TempDir() + "dfs_inode_snapshot_attach.img";
+    uint32_t inode_num;
+    {
+        InodeTable table(InodeTable::CHUNK_SIZE * 4);
+        inode_num = table.allocate_inode();
+        table.get_inode(inode_num)->initialize(S_IFREG | 0600, 7, 8);
+        
+        std::ofstream file(path, std::ios::binary);
+        table.serialize(file);
+    }
+    
+    BlockManager blocks(256, 4096);
+    InodeTable attached(0);
+    attached.set_block_manager(&blocks);
+    attached.attach(path, 0);
+    
+    std::shared_ptr<InodeTable> snapshot = attached.snapshot();
+    std::shared_ptr<const InodeTable> view = attached.view();
+    EXPECT_EQ(attached.get_loaded_chunk_count(), 0u);
+    
+    // A chunk read by one table is resident for every table sharing it
+    EXPECT_EQ(view->get_inode(inode_num)->uid, 7);
+    EXPECT_EQ(attached.get_loaded_chunk_count(), 1u);
+    EXPECT_EQ(snapshot->get_loaded_chunk_count(), 1u);
+    
+    attached.release_snapshot(*snapshot);
+    std::remove(path.c_str());
+}
+
+TEST(InodeTableTest, ViewHoldsNoBlockReferences) {
+    BlockManager blocks(256, 4096);
+    InodeTable table(64);
+    
+    uint32_t block_id = blocks.allocate_block();
+    uint32_t inode_num = make_file(table, {block_id});
+    
+    std::shared_ptr<const InodeTable> view = table.view();
+    table.get_inode(inode_num)->uid = 9;
+    EXPECT_EQ(blocks.get_block_ref_count(block_id), 1u);
+    EXPECT_EQ(view->get_inode(inode_num)->uid, 0);
+}
+
+TEST(InodeTableTest, SnapshotsDoNotSurviveRemount) {
+    std::string path = testing::TempDir() + "dfs_inode_snapshot_remount.img";
+    BlockManager blocks(256, 4096);
+    InodeTable table(64);
+    table.set_block_manager(&blocks);
+    
+    uint32_t original = blocks.allocate_block();
+    uint32_t inode_num = make_file(table, {original});
+    std::shared_ptr<InodeTable> snapshot = table.snapshot();
+    
+    Inode* live = table.get_inode(inode_num);
+    uint32_t rewritten = blocks.cow_block(original);
+    live->direct_blocks[0] = rewritten;
+    {
+        std::ofstream file(path, std::ios::binary);
+        table.serialize(file);
+        blocks.serialize_bitmap(file, table.snapshot_only_blocks());
+        blocks.serialize_block_refs(file, table.snapshot_only_blocks());
+    }
+    
+    // The image holds the live table only; the snapshot's block is free
+    InodeTable loaded_table(0);
+    BlockManager loaded_blocks(256, 4096);
+    std::ifstream file(path, std::ios::binary);
+    loaded_table.deserialize(file);
+    loaded_blocks.deserialize_bitmap(file);
+    loaded_blocks.deserialize_block_refs(file);
+    EXPECT_EQ(loaded_table.get_inode(inode_num)->direct_blocks[0], rewritten);
+    EXPECT_TRUE(loaded_blocks.is_block_free(original));
+    EXPECT_EQ(loaded_blocks.get_block_ref_count(rewritten), 1u);
+    
+    table.release_snapshot(*snapshot);
+    std::remove(path.c_str());
+}
+
+TEST(InodeTableTest, SnapshotNeedsBlockManager) {
+    InodeTable table(64);
+    EXPECT_THROW(table.snapshot(), dfs::utils::FileSystemException);
+}
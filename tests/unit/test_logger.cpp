@@ -0,0 +1,351 @@
+#include <gtest/gtest.h>
+#include "utils/logger.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dfs::utils;
+
+namespace {
+
+// Log files under a per-test directory removed when the test ends
+class LoggerFixture : public testing::Test {
+protected:
+    LoggerFixture() {
+        const testing::TestInfo* info = testing::UnitTest::GetInstance()->current_test_info();
+        directory_ = std::filesystem::path(testing::TempDir()) / ("dfs_logger_" + std::string(info->name()));
+        std::filesystem::remove_all(directory_);
+        std::filesystem::create_directories(directory_);
+    }
+    
+    ~LoggerFixture() override {
+        std::filesystem::remove_all(directory_);
+    }
+    
+    Logger::LoggerConfig file_config(const std::string& name = "test.log") const {
+        Logger::LoggerConfig config(Logger::Level::LOG_DEBUG, (directory_ / name).string(), false, true, true);
+        config.overflow_policy = Logger::OverflowPolicy::BLOCK;
+        return config;
+    }
+    
+    std::string read_file(const std::string& name = "test.log") const {
+        std::ifstream file(directory_ / name, std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+    
+    std::vector<std::string> read_lines(const std::string& name = "test.log") const {
+        std::vector<std::string> lines;
+        std::istringstream contents(read_file(name));
+        std::string line;
+        while (std::getline(contents, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+    
+    std::filesystem::path directory_;
+};
+
+} // namespace
+
+TEST_F(LoggerFixture, AsyncKeepsEveryRecordInThreadOrder) {
+    const int threads = 4;
+    const int per_thread = 2000;
+    {
+        Logger::LoggerConfig config = file_config();
+        config.queue_capacity = 64;
+        Logger logger(config);
+        
+        std::vector<std::thread> writers;
+        for (int t = 0; t < threads; ++t) {
+            writers.emplace_back([&logger, t]() {
+                for (int i = 0; i < per_thread; ++i) {
+                    logger.info("writer " + std::to_string(t) + " seq " + std::to_string(i));
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        logger.flush();
+        
+        Logger::LoggerStats stats = logger.get_stats();
+        EXPECT_EQ(stats.info_logs, static_cast<uint64_t>(threads * per_thread));
+        EXPECT_EQ(stats.dropped_logs, 0u);
+        EXPECT_TRUE(stats.async_enabled);
+    }
+    
+    std::vector<int> next(threads, 0);
+    size_t records = 0;
+    for (const std::string& line : read_lines()) {
+        size_t at = line.find("writer ");
+        ASSERT_NE(at, std::string::npos) << line;
+        int t = 0;
+        int seq = 0;
+        ASSERT_EQ(std::sscanf(line.c_str() + at, "writer %d seq %d", &t, &seq), 2);
+        EXPECT_EQ(seq, next[t]);
+        next[t] = seq + 1;
+        records++;
+    }
+    EXPECT_EQ(records, static_cast<size_t>(threads * per_thread));
+}
+
+TEST_F(LoggerFixture, DroppedRecordsAreCounted) {
+    const int count = 5000;
+    uint64_t dropped;
+    {
+        Logger::LoggerConfig config = file_config();
+        config.queue_capacity = 4;
+        config.overflow_policy = Logger::OverflowPolicy::DROP;
+        config.staging_records = 0;
+        Logger logger(config);
+        
+        for (int i = 0; i < count; ++i) {
+            logger.debug("record " + std::to_string(i));
+        }
+        logger.flush();
+        dropped = logger.get_stats().dropped_logs;
+    }
+    
+    EXPECT_EQ(read_lines().size() + dropped, static_cast<size_t>(count));
+}
+
+TEST_F(LoggerFixture, LongMessagesAreTruncated) {
+    {
+        Logger logger(file_config());
+        logger.warn(std::string(Logger::MESSAGE_CAPACITY * 2, 'x'));
+    }
+    
+    std::vector<std::string> lines = read_lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find(std::string(Logger::MESSAGE_CAPACITY - 16, 'x')), std::string::npos);
+    EXPECT_EQ(lines[0].find(std::string(Logger::MESSAGE_CAPACITY + 1, 'x')), std::string::npos);
+}
+
+TEST_F(LoggerFixture, DeferredFormatRendersArguments) {
+    {
+        Logger logger(file_config());
+        const std::string name = "root";
+        int value = 0;
+        detail::FormatLogCall::log(&logger, Logger::Level::LOG_INFO, __FILE__, __LINE__, __FUNCTION__,
+                                   "{} blocks in {} ms, ok={}, name={}, tag={}, missing={}",
+                                   7, 1.5, true, name, 'Q');
+        detail::FormatLogCall::log(&logger, Logger::Level::LOG_INFO, __FILE__, __LINE__, __FUNCTION__,
+                                   "negative {} and unsigned {} and pointer {}",
+                                   -42, uint64_t(18446744073709551615ULL), static_cast<void*>(&value));
+    }
+    
+    std::vector<std::string> lines = read_lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("7 blocks in 1.5 ms, ok=true, name=root, tag=Q, missing="), std::string::npos)
+        << lines[0];
+    EXPECT_NE(lines[0].find("test_logger.cpp"), std::string::npos);
+    EXPECT_NE(lines[1].find("negative -42 and unsigned 18446744073709551615 and pointer 0x"), std::string::npos)
+        << lines[1];
+}
+
+TEST_F(LoggerFixture, LevelFilterSkipsRecords) {
+    {
+        Logger logger(file_config());
+        logger.set_level(Logger::Level::LOG_WARN);
+        EXPECT_FALSE(logger.is_enabled(Logger::Level::LOG_INFO));
+        EXPECT_TRUE(logger.is_enabled(Logger::Level::LOG_ERROR));
+        
+        logger.info("hidden");
+        logger.error("shown");
+        EXPECT_EQ(logger.get_stats().total_logs, 1u);
+    }
+    
+    std::vector<std::string> lines = read_lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("[ERROR]"), std::string::npos);
+    EXPECT_NE(lines[0].find("shown"), std::string::npos);
+}
+
+TEST_F(LoggerFixture, JsonLinesEscapeMessages) {
+    {
+        Logger::LoggerConfig config = file_config();
+        config.file_format = Logger::FileFormat::JSON;
+        Logger logger(config);
+        logger.error("quote \" backslash \\ newline \n end", "src/file.cpp", 12, "fn");
+    }
+    
+    std::vector<std::string> lines = read_lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0].front(), '{');
+    EXPECT_EQ(lines[0].back(), '}');
+    EXPECT_NE(lines[0].find("\"level\":\"ERROR\""), std::string::npos) << lines[0];
+    EXPECT_NE(lines[0].find("\"file\":\"file.cpp\",\"line\":12"), std::string::npos) << lines[0];
+    EXPECT_NE(lines[0].find("\"function\":\"fn\""), std::string::npos) << lines[0];
+    EXPECT_NE(lines[0].find("\"msg\":\"quote \\\" backslash \\\\ newline \\n end\""), std::string::npos)
+        << lines[0];
+}
+
+TEST_F(LoggerFixture, BinaryRecordsAreLengthPrefixed) {
+    {
+        Logger::LoggerConfig config = file_config();
+        config.file_format = Logger::FileFormat::BINARY;
+        Logger logger(config);
+        logger.info("first", "a.cpp", 1, "f");
+        logger.warn("second record", "dir/b.cpp", 22, "g");
+    }
+    
+    std::string contents = read_file();
+    ASSERT_GE(contents.size(), 8u);
+    EXPECT_EQ(contents.substr(0, 8), "DFSLOG1\n");
+    
+    std::vector<std::string> messages;
+    size_t offset = 8;
+    while (offset < contents.size()) {
+        uint32_t size;
+        std::memcpy(&size, contents.data() + offset, sizeof(size));
+        const char* record = contents.data() + offset + sizeof(size);
+        ASSERT_LE(offset + sizeof(size) + size, contents.size());
+        
+        // level, flags, timestamp, thread id, line, then file, function and message
+        size_t at = 2 + 8 + 8 + 4;
+        uint16_t file_length;
+        std::memcpy(&file_length, record + at, sizeof(file_length));
+        at += sizeof(file_length) + file_length;
+        uint16_t function_length;
+        std::memcpy(&function_length, record + at, sizeof(function_length));
+        at += sizeof(function_length) + function_length;
+        uint32_t message_length;
+        std::memcpy(&message_length, record + at, sizeof(message_length));
+        at += sizeof(message_length);
+        EXPECT_EQ(at + message_length, size);
+        messages.emplace_back(record + at, message_length);
+        
+        offset += sizeof(size) + size;
+    }
+    EXPECT_EQ(messages, std::vector<std::string>({"first", "second record"}));
+}
+
+TEST_F(LoggerFixture, RotationShiftsAndCompressesOldFiles) {
+    {
+        Logger::LoggerConfig config = file_config();
+        config.max_log_files = 3;
+        Logger logger(config);
+        
+        for (int i = 0; i < 4; ++i) {
+            logger.info("generation " + std::to_string(i));
+            logger.flush();
+            logger.rotate_logs();
+        }
+        logger.info("current");
+    }
+    
+    // The destructor waits for queued rotations
+    EXPECT_TRUE(std::filesystem::exists(directory_ / "test.1.log.lz4"));
+    EXPECT_TRUE(std::filesystem::exists(directory_ / "test.2.log.lz4"));
+    EXPECT_FALSE(std::filesystem::exists(directory_ / "test.3.log.lz4"));
+    EXPECT_NE(read_file().find("current"), std::string::npos);
+    
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        EXPECT_EQ(entry.path().string().find(".pending"), std::string::npos) << entry.path();
+        EXPECT_EQ(entry.path().string().find(".tmp"), std::string::npos) << entry.path();
+    }
+}
+
+TEST_F(LoggerFixture, RotationWithoutCompressionRenames) {
+    {
+        Logger::LoggerConfig config = file_config();
+        config.compress_rotated = false;
+        Logger logger(config);
+        logger.info("old");
+        logger.flush();
+        logger.rotate_logs();
+        logger.info("new");
+    }
+    
+    EXPECT_NE(read_file("test.1.log").find("old"), std::string::npos);
+    EXPECT_EQ(read_file().find("old"), std::string::npos);
+}
+
+TEST_F(LoggerFixture, StagedRecordsSurviveThreadExit) {
+    {
+        Logger::LoggerConfig config = file_config();
+        config.staging_records = 64;
+        Logger logger(config);
+        
+        // Fewer records than a staging buffer holds, so none is handed over early
+        std::thread([&logger]() {
+            for (int i = 0; i < 10; ++i) {
+                logger.info("staged " + std::to_string(i));
+            }
+        }).join();
+        
+        logger.info("from main");
+        logger.flush();
+        EXPECT_EQ(read_lines().size(), 11u);
+    }
+}
+
+TEST_F(LoggerFixture, StagingIsPerLoggerInstance) {
+    {
+        Logger::LoggerConfig first_config = file_config("first.log");
+        Logger::LoggerConfig second_config = file_config("second.log");
+        first_config.staging_records = 16;
+        second_config.staging_records = 16;
+        Logger first(first_config);
+        Logger second(second_config);
+        
+        for (int i = 0; i < 40; ++i) {
+            first.info("to first " + std::to_string(i));
+            second.info("to second " + std::to_string(i));
+        }
+    }
+    
+    std::vector<std::string> first_lines = read_lines("first.log");
+    std::vector<std::string> second_lines = read_lines("second.log");
+    EXPECT_EQ(first_lines.size(), 40u);
+    EXPECT_EQ(second_lines.size(), 40u);
+    for (const std::string& line : first_lines) {
+        EXPECT_NE(line.find("to first"), std::string::npos) << line;
+    }
+    for (const std::string& line : second_lines) {
+        EXPECT_NE(line.find("to second"), std::string::npos) << line;
+    }
+}
+
+TEST_F(LoggerFixture, WarningsAreHandedOverImmediately) {
+    Logger::LoggerConfig config = file_config();
+    config.staging_records = 64;
+    Logger logger(config);
+    
+    logger.info("staged");
+    logger.warn("urgent");
+    
+    // The warning takes the staged record with it, without a flush
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (read_lines().size() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::vector<std::string> lines = read_lines();
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("staged"), std::string::npos);
+    EXPECT_NE(lines[1].find("urgent"), std::string::npos);
+}
+
+TEST_F(LoggerFixture, TimestampsAreMonotonicPerThread) {
+    {
+        Logger logger(file_config());
+        for (int i = 0; i < 200; ++i) {
+            logger.info("tick");
+        }
+    }
+    
+    // Text lines start with the cached, millisecond-resolution timestamp
+    std::string previous;
+    for (const std::string& line : read_lines()) {
+        std::string stamp = line.substr(0, 23);
+        EXPECT_GE(stamp, previous);
+        previous = stamp;
+    }
+}
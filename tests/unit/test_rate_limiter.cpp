@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include "utils/rate_limiter.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dfs::utils;
+
+namespace {
+
+RateLimiter::RateLimitConfig per_client_config(uint32_t rps, uint32_t burst) {
+    return RateLimiter::RateLimitConfig(rps, burst, std::chrono::seconds(1), true);
+}
+
+// Requests allowed back to back before the first denial
+int drain(RateLimiter& limiter, const std::string& client_id) {
+    int allowed = 0;
+    while (limiter.is_allowed(client_id) && allowed < 1000000) {
+        allowed++;
+    }
+    return allowed;
+}
+
+} // namespace
+
+TEST(RateLimiterTest, ClientsHaveSeparateBuckets) {
+    RateLimiter limiter(per_client_config(1, 3));
+    
+    EXPECT_EQ(drain(limiter, "a"), 3);
+    EXPECT_FALSE(limiter.is_allowed("a"));
+    EXPECT_TRUE(limiter.is_allowed("b"));
+    
+    RateLimiter::RateLimiterStats stats = limiter.get_stats();
+    EXPECT_EQ(stats.active_clients, 2u);
+    EXPECT_EQ(stats.allowed_requests, 4u);
+    EXPECT_EQ(stats.denied_requests, 2u);
+    EXPECT_EQ(stats.total_requests, 6u);
+}
+
+TEST(RateLimiterTest, RemovedClientStartsWithFullBucket) {
+    RateLimiter limiter(per_client_config(1, 2));
+    
+    EXPECT_EQ(drain(limiter, "a"), 2);
+    limiter.remove_client("a");
+    EXPECT_EQ(limiter.get_stats().active_clients, 0u);
+    EXPECT_EQ(limiter.get_client_stats("a").request_count, 0u);
+    EXPECT_EQ(drain(limiter, "a"), 2);
+    
+    // Resetting clears the window counts but leaves the buckets drained
+    limiter.reset_all_clients();
+    EXPECT_EQ(limiter.get_client_stats("a").request_count, 0u);
+    EXPECT_FALSE(limiter.is_allowed("a"));
+}
+
+TEST(RateLimiterTest, CleanupKeepsActiveClients) {
+    RateLimiter limiter(per_client_config(100, 100));
+    
+    EXPECT_TRUE(limiter.is_allowed("a"));
+    EXPECT_TRUE(limiter.is_allowed("b"));
+    limiter.cleanup_expired_clients(std::chrono::seconds(0));
+    
+    // Both still have requests counted in the open window
+    EXPECT_EQ(limiter.get_stats().active_clients, 2u);
+    EXPECT_EQ(limiter.get_client_stats("a").request_count, 1u);
+}
+
+TEST(RateLimiterTest, ConcurrentChecksWithRemovalAndCleanup) {
+    RateLimiter limiter(per_client_config(1000, 50));
+    const int threads = 4;
+    const int per_thread = 20000;
+    const int clients = 64;
+    std::atomic<bool> running{true};
+    
+    // Removal and cleanup race the lock-free lookups on the same shards
+    std::thread remover([&]() {
+        int i = 0;
+        while (running.load()) {
+            limiter.remove_client("client" + std::to_string(i++ % clients));
+            if (i % 16 == 0) {
+                limiter.cleanup_expired_clients(std::chrono::seconds(0));
+            }
+        }
+    });
+    
+    std::vector<std::thread> checkers;
+    for (int t = 0; t < threads; ++t) {
+        checkers.emplace_back([&limiter, t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                limiter.is_allowed("client" + std::to_string((i * 7 + t) % clients));
+            }
+        });
+    }
+    for (auto& checker : checkers) {
+        checker.join();
+    }
+    running.store(false);
+    remover.join();
+    
+    RateLimiter::RateLimiterStats stats = limiter.get_stats();
+    EXPECT_EQ(stats.total_requests, static_cast<uint64_t>(threads * per_thread));
+    EXPECT_EQ(stats.allowed_requests + stats.denied_requests, stats.total_requests);
+    EXPECT_LE(stats.active_clients, static_cast<uint32_t>(clients));
+}
+
+TEST(RateLimiterTest, BurstIsExactlyBurstCapacity) {
+    RateLimiter limiter(per_client_config(10, 5));
+    
+    EXPECT_EQ(limiter.get_client_stats("a").available_tokens, 0u);
+    EXPECT_FALSE(limiter.is_allowed("a", 6));
+    EXPECT_TRUE(limiter.is_allowed("a", 5));
+    EXPECT_FALSE(limiter.is_allowed("a"));
+    EXPECT_EQ(limiter.get_client_stats("a").available_tokens, 0u);
+}
+
+TEST(RateLimiterTest, TokensRefillContinuously) {
+    // One token per millisecond, so a refill never waits for a whole second
+    RateLimiter limiter(per_client_config(1000, 1));
+    
+    EXPECT_TRUE(limiter.is_allowed("a"));
+    EXPECT_FALSE(limiter.is_allowed("a"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(limiter.get_client_stats("a").available_tokens, 1u);
+    EXPECT_TRUE(limiter.is_allowed("a"));
+}
+
+TEST(RateLimiterTest, PartialRefillAllowsProportionalRequests) {
+    RateLimiter limiter(per_client_config(20, 20));
+    
+    EXPECT_EQ(drain(limiter, "a"), 20);
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    
+    // About five tokens back after a quarter of a second
+    int allowed = drain(limiter, "a");
+    EXPECT_GE(allowed, 4);
+    EXPECT_LE(allowed, 8);
+}
+
+TEST(RateLimiterTest, GlobalModeSharesOneBucket) {
+    RateLimiter limiter(RateLimiter::RateLimitConfig(1, 3, std::chrono::seconds(1), false));
+    
+    EXPECT_TRUE(limiter.is_allowed("a"));
+    EXPECT_TRUE(limiter.is_allowed("b"));
+    EXPECT_TRUE(limiter.is_allowed(1));
+    EXPECT_FALSE(limiter.is_allowed("c"));
+    EXPECT_EQ(limiter.get_stats().active_clients, 0u);
+}
+
+TEST(RateLimiterTest, UpdatedConfigAppliesToExistingClients) {
+    RateLimiter limiter(per_client_config(1, 2));
+    EXPECT_EQ(drain(limiter, "a"), 2);
+    
+    limiter.update_config(per_client_config(1, 10));
+    EXPECT_EQ(limiter.get_config().burst_capacity, 10u);
+    EXPECT_EQ(drain(limiter, "b"), 10);
+}
+
+TEST(RateLimiterTest, ConfigUpdatesArePublishedWhole) {
+    RateLimiter limiter(per_client_config(1, 1));
+    std::atomic<bool> stop(false);
+    std::atomic<int> torn(0);
+    
+    // Every published config has burst_capacity == 2 * max_requests_per_second
+    std::thread writer([&]() {
+        for (uint32_t rps = 1; rps <= 2000; ++rps) {
+            limiter.update_config(per_client_config(rps, rps * 2));
+        }
+        stop.store(true);
+    });
+    
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t]() {
+            while (!stop.load()) {
+                RateLimiter::RateLimitConfig config = limiter.get_config();
+                if (config.max_requests_per_second != 1 &&
+                    config.burst_capacity != config.max_requests_per_second * 2) {
+                    torn.fetch_add(1);
+                }
+                limiter.is_allowed("client" + std::to_string(t));
+            }
+        });
+    }
+    
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(limiter.get_config().max_requests_per_second, 2000u);
+}
+
+TEST(SlidingWindowRateLimiterTest, LimitsRequestsPerWindow) {
+    SlidingWindowRateLimiter limiter(10, std::chrono::seconds(1));
+    
+    int allowed = 0;
+    while (limiter.is_allowed("a") && allowed < 100) {
+        allowed++;
+    }
+    EXPECT_EQ(allowed, 10);
+    EXPECT_EQ(limiter.get_request_count("a"), 10u);
+    EXPECT_TRUE(limiter.is_allowed("b"));
+    EXPECT_EQ(limiter.get_request_count("missing"), 0u);
+}
+
+TEST(SlidingWindowRateLimiterTest, OldWindowsExpire) {
+    SlidingWindowRateLimiter limiter(10, std::chrono::seconds(1));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(limiter.is_allowed("a"));
+    }
+    EXPECT_FALSE(limiter.is_allowed("a"));
+    
+    // Two windows later neither counter covers the old requests
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    EXPECT_EQ(limiter.get_request_count("a"), 0u);
+    
+    limiter.cleanup_old_requests();
+    EXPECT_EQ(limiter.get_request_count("a"), 0u);
+    EXPECT_TRUE(limiter.is_allowed("a"));
+    EXPECT_EQ(limiter.get_request_count("a"), 1u);
+}
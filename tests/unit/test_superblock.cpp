@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include "core/superblock.h"
+#include "core/block_manager.h"
+#include "utils/exceptions.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dfs::core;
+
+namespace {
+
+// Temporary device image removed when the test ends
+class TempImage {
+public:
+    explicit TempImage(const std::string& name)
+        : path_(testing::TempDir() + "dfs_" + name + ".img") {
+        std::remove(path_.c_str());
+    }
+    
+    ~TempImage() {
+        std::remove(path_.c_str());
+    }
+    
+    const std::string& path() const { return path_; }
+    
+private:
+    std::string path_;
+};
+
+SuperBlock read_copy(const std::string& path, uint32_t index) {
+    SuperBlock copy;
+    std::ifstream device(path, std::ios::binary);
+    device.seekg(static_cast<std::streamoff>(SuperBlock::COPY_OFFSETS[index]));
+    device.read(reinterpret_cast<char*>(&copy), sizeof(SuperBlock));
+    return copy;
+}
+
+void corrupt_copy(const std::string& path, uint32_t index) {
+    std::fstream device(path, std::ios::in | std::ios::out | std::ios::binary);
+    device.seekp(static_cast<std::streamoff>(SuperBlock::COPY_OFFSETS[index] + 8));
+    uint32_t garbage = 0xFFFFFFFF;
+    device.write(reinterpret_cast<const char*>(&garbage), sizeof(garbage));
+}
+
+} // namespace
+
+TEST(SuperBlockTest, SizeMatchesStructure) {
+    EXPECT_EQ(SuperBlock::size(), sizeof(SuperBlock));
+    EXPECT_EQ(SuperBlock::size(), 120u);
+}
+
+TEST(SuperBlockTest, InitializeIsValidAfterChecksum) {
+    SuperBlock superblock;
+    superblock.initialize(1024);
+    superblock.update_checksum();
+    
+    EXPECT_TRUE(superblock.is_valid());
+    EXPECT_EQ(superblock.total_blocks, 1024u);
+    EXPECT_EQ(superblock.free_blocks, 1022u);
+    EXPECT_EQ(superblock.generation, 0u);
+    EXPECT_TRUE(superblock.was_cleanly_unmounted());
+}
+
+TEST(SuperBlockTest, FreeBlocksMatchBlockManager) {
+    for (uint32_t total_blocks : {200u, 1024u, 8192u, 70000u}) {
+        SuperBlock superblock;
+        superblock.initialize(total_blocks);
+        BlockManager blocks(total_blocks, 4096);
+        EXPECT_EQ(superblock.free_blocks, blocks.get_free_block_count()) << total_blocks;
+    }
+}
+
+TEST(SuperBlockTest, CounterDeltasFoldIntoSuperBlock) {
+    SuperBlock superblock;
+    superblock.initialize(1024);
+    uint32_t free_blocks = superblock.free_blocks;
+    uint32_t free_inodes = superblock.free_inodes;
+    
+    SuperBlockCounters counters(superblock);
+    counters.block_allocated(10);
+    counters.block_freed(3);
+    counters.inode_allocated(2);
+    
+    // Pending deltas are visible through the counters but not yet folded
+    EXPECT_EQ(counters.get_free_blocks(), free_blocks - 7);
+    EXPECT_EQ(counters.get_free_inodes(), free_inodes - 2);
+    EXPECT_EQ(superblock.free_blocks, free_blocks);
+    
+    counters.fold();
+    EXPECT_EQ(superblock.free_blocks, free_blocks - 7);
+    EXPECT_EQ(superblock.free_inodes, free_inodes - 2);
+    EXPECT_EQ(counters.get_free_blocks(), free_blocks - 7);
+}
+
+TEST(SuperBlockTest, CountersAreExactUnderConcurrency) {
+    SuperBlock superblock;
+    superblock.initialize(1 << 20);
+    uint32_t free_blocks = superblock.free_blocks;
+    
+    SuperBlockCounters counters(superblock);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&counters]() {
+            for (int i = 0; i < 10000; ++i) {
+                counters.block_allocated();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    counters.fold();
+    EXPECT_EQ(superblock.free_blocks, free_blocks - 40000);
+}
+
+TEST(SuperBlockTest, FoldClampsToGeometry) {
+    SuperBlock superblock;
+    superblock.initialize(1024);
+    
+    SuperBlockCounters counters(superblock);
+    counters.block_freed(5000);
+    counters.fold();
+    
+    EXPECT_EQ(superblock.free_blocks, superblock.total_blocks);
+}
+
+TEST(SuperBlockTest, CopyBlockNumbersSkipCopiesPastDevice) {
+    // 1 MiB device of 4 KiB blocks holds only the primary
+    EXPECT_EQ(SuperBlock::copy_block_numbers(256, 4096), std::vector<uint32_t>({0}));
+    
+    // 32 MiB device holds the primary and the copies at 1 MiB and 16 MiB
+    EXPECT_EQ(SuperBlock::copy_block_numbers(8192, 4096), std::vector<uint32_t>({0, 256, 4096}));
+    
+    EXPECT_TRUE(SuperBlock::copy_block_numbers(8192, 0).empty());
+}
+
+TEST(SuperBlockTest, WriteCopiesAndReadNewest) {
+    TempImage image("write_copies");
+    
+    SuperBlock superblock;
+    superblock.initialize(8192);
+    superblock.write_copies(image.path());
+    EXPECT_EQ(superblock.generation, 1u);
+    
+    std::vector<uint32_t> stale;
+    SuperBlock loaded = SuperBlock::read_newest_copy(image.path(), &stale);
+    EXPECT_TRUE(stale.empty());
+    EXPECT_EQ(loaded.generation, 1u);
+    EXPECT_EQ(loaded.total_blocks, 8192u);
+    EXPECT_TRUE(loaded.is_valid());
+    
+    // The copy at 256 MiB does not fit on a 32 MiB device
+    EXPECT_NE(read_copy(image.path(), 3).magic_number, SuperBlock::MAGIC_NUMBER);
+}
+
+TEST(SuperBlockTest, CorruptPrimaryFallsBackToBackup) {
+    TempImage image("corrupt_primary");
+    
+    SuperBlock superblock;
+    superblock.initialize(8192);
+    superblock.write_copies(image.path());
+    corrupt_copy(image.path(), 0);
+    
+    std::vector<uint32_t> stale;
+    SuperBlock loaded = SuperBlock::read_newest_copy(image.path(), &stale);
+    EXPECT_EQ(loaded.generation, 1u);
+    EXPECT_EQ(loaded.total_blocks, 8192u);
+    EXPECT_EQ(stale, std::vector<uint32_t>({0}));
+}
+
+TEST(SuperBlockTest, NewestGenerationWins) {
+    TempImage image("newest_generation");
+    
+    SuperBlock superblock;
+    superblock.initialize(8192);
+    superblock.write_copies(image.path());
+    
+    // A newer write that only reached the backups before a crash
+    SuperBlock older = read_copy(image.path(), 0);
+    superblock.free_blocks -= 5;
+    superblock.write_copies(image.path());
+    {
+        std::fstream device(image.path(), std::ios::in | std::ios::out | std::ios::binary);
+        device.write(reinterpret_cast<const char*>(&older), sizeof(SuperBlock));
+    }
+    
+    std::vector<uint32_t> stale;
+    SuperBlock loaded = SuperBlock::read_newest_copy(image.path(), &stale);
+    EXPECT_EQ(loaded.generation, 2u);
+    EXPECT_EQ(loaded.free_blocks, superblock.free_blocks);
+    EXPECT_EQ(stale, std::vector<uint32_t>({0}));
+}
+
+TEST(SuperBlockTest, NoValidCopyThrows) {
+    TempImage image("no_valid_copy");
+    
+    SuperBlock superblock;
+    superblock.initialize(256);
+    superblock.write_copies(image.path());
+    corrupt_copy(image.path(), 0);
+    
+    EXPECT_THROW(SuperBlock::read_newest_copy(image.path()), dfs::utils::FileSystemCorruptedException);
+}
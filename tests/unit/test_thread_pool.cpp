@@ -0,0 +1,390 @@
+#include <gtest/gtest.h>
+#include "utils/thread_pool.h"
+#include "utils/parallel.h"
+#include "utils/cpu_topology.h"
+#include "utils/coroutine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace dfs::utils;
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+    ThreadPool pool(2, 4);
+    std::atomic<int> count{0};
+    
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 1000; ++i) {
+        results.push_back(pool.enqueue([i, &count]() {
+            count++;
+            return i * 2;
+        }));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(results[i].get(), i * 2);
+    }
+    EXPECT_EQ(count.load(), 1000);
+}
+
+TEST(ThreadPoolTest, TasksSubmittedFromWorkersAreStolen) {
+    ThreadPool pool(4, 4);
+    std::atomic<int> count{0};
+    std::mutex threads_mutex;
+    std::set<std::thread::id> threads;
+    
+    // A worker pushes onto its own deque; idle workers steal from it
+    pool.post([&]() {
+        EXPECT_TRUE(pool.is_worker_thread());
+        for (int i = 0; i < 400; ++i) {
+            pool.post([&]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                std::lock_guard<std::mutex> lock(threads_mutex);
+                threads.insert(std::this_thread::get_id());
+                count++;
+            });
+        }
+    });
+    
+    pool.wait_for_all_tasks();
+    EXPECT_EQ(count.load(), 400);
+    EXPECT_FALSE(pool.is_worker_thread());
+    EXPECT_GT(threads.size(), 1u);
+}
+
+TEST(ThreadPoolTest, WorksWithoutWorkStealing) {
+    ThreadPool::ThreadPoolConfig config(2, 2);
+    config.enable_work_stealing = false;
+    ThreadPool pool(config);
+    
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.post([&count]() { count++; });
+    }
+    pool.wait_for_all_tasks();
+    EXPECT_EQ(count.load(), 100);
+}
+
+TEST(ThreadPoolTest, FutureCarriesException) {
+    ThreadPool pool(1, 1);
+    auto result = pool.enqueue([]() -> int { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(result.get(), std::runtime_error);
+    
+    // Only a task with no future to carry its exception counts as failed
+    pool.post([]() { throw std::runtime_error("posted task failed"); });
+    pool.wait_for_all_tasks();
+    EXPECT_EQ(pool.get_stats().total_tasks_failed, 1u);
+}
+
+TEST(ThreadPoolTest, EnqueueMovesArgumentsIntoTheCall) {
+    ThreadPool pool(1, 1);
+    
+    // Args precedes the priority parameter, so it is named rather than deduced
+    using Take = int (*)(std::unique_ptr<int>);
+    Take take = [](std::unique_ptr<int> value) { return *value * 2; };
+    auto doubled = pool.enqueue<Take, std::unique_ptr<int>>(std::move(take), std::make_unique<int>(21));
+    EXPECT_EQ(doubled.get(), 42);
+    
+    // A move-only callable runs once, from the task
+    auto owned = std::make_unique<int>(7);
+    auto result = pool.enqueue([owned = std::move(owned)]() { return *owned; });
+    EXPECT_EQ(result.get(), 7);
+}
+
+TEST(ThreadPoolTest, RejectsTasksAfterShutdown) {
+    ThreadPool pool(1, 1);
+    pool.shutdown();
+    EXPECT_FALSE(pool.is_running());
+    EXPECT_THROW(pool.post([]() {}), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, GrowsWhenQueuedWorkStalls) {
+    ThreadPool::ThreadPoolConfig config(1, 4, std::chrono::seconds(1));
+    config.grow_latency_threshold = std::chrono::milliseconds(5);
+    ThreadPool pool(config);
+    EXPECT_EQ(pool.get_thread_count(), 1u);
+    
+    // Blocked tasks hold every worker while more work waits
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> started{0};
+    for (int i = 0; i < 4; ++i) {
+        pool.post([released, &started]() {
+            started++;
+            released.wait();
+        });
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (started.load() < 4 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(started.load(), 4);
+    EXPECT_EQ(pool.get_thread_count(), 4u);
+    release.set_value();
+    pool.wait_for_all_tasks();
+    
+    // Idle workers past the timeout retire down to the minimum
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.get_thread_count() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(pool.get_thread_count(), 1u);
+    
+    ThreadPool::ThreadPoolStats stats = pool.get_stats();
+    EXPECT_EQ(stats.threads_started, 4u);
+    EXPECT_EQ(stats.threads_retired, 3u);
+}
+
+TEST(ThreadPoolTest, PostAcceptsMoveOnlyCallables) {
+    ThreadPool pool(1, 1);
+    auto value = std::make_unique<int>(5);
+    std::promise<int> promise;
+    std::future<int> future = promise.get_future();
+    
+    pool.post([value = std::move(value), promise = std::move(promise)]() mutable {
+        promise.set_value(*value);
+    });
+    EXPECT_EQ(future.get(), 5);
+}
+
+TEST(TaskHistogramTest, BucketsArePowersOfTwo) {
+    EXPECT_EQ(ThreadPool::TaskHistogram::bucket_for(0), 0u);
+    EXPECT_EQ(ThreadPool::TaskHistogram::bucket_for(1), 1u);
+    EXPECT_EQ(ThreadPool::TaskHistogram::bucket_for(1023), 10u);
+    EXPECT_EQ(ThreadPool::TaskHistogram::bucket_for(1024), 11u);
+    EXPECT_EQ(ThreadPool::TaskHistogram::bucket_for(UINT64_MAX), ThreadPool::TaskHistogram::BUCKETS - 1);
+    
+    ThreadPool::TaskHistogram histogram;
+    histogram.buckets[ThreadPool::TaskHistogram::bucket_for(1000)] = 90;
+    histogram.buckets[ThreadPool::TaskHistogram::bucket_for(1000000)] = 10;
+    histogram.count = 100;
+    histogram.total = std::chrono::nanoseconds(90 * 1000 + 10 * 1000000);
+    EXPECT_EQ(histogram.percentile(0.5), std::chrono::nanoseconds(1024));
+    EXPECT_EQ(histogram.percentile(0.99), std::chrono::nanoseconds(1 << 20));
+    EXPECT_EQ(histogram.mean(), std::chrono::nanoseconds(100900));
+}
+
+TEST(ThreadPoolTest, RecordsTimingsPerPriority) {
+    ThreadPool pool(1, 1);
+    for (int i = 0; i < 10; ++i) {
+        pool.enqueue([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); },
+                     ThreadPool::Priority::HIGH);
+    }
+    pool.enqueue([]() {}, ThreadPool::Priority::LOW);
+    pool.wait_for_all_tasks();
+    
+    auto timings = pool.get_task_timings();
+    const auto& high = timings[static_cast<size_t>(ThreadPool::Priority::HIGH)];
+    EXPECT_EQ(high.execution.count, 10u);
+    EXPECT_GE(high.execution.mean(), std::chrono::milliseconds(2));
+    EXPECT_GE(high.execution.percentile(0.5), std::chrono::milliseconds(2));
+    EXPECT_EQ(timings[static_cast<size_t>(ThreadPool::Priority::LOW)].execution.count, 1u);
+    EXPECT_EQ(timings[static_cast<size_t>(ThreadPool::Priority::NORMAL)].execution.count, 0u);
+    
+    ThreadPool::ThreadPoolStats stats = pool.get_stats();
+    EXPECT_EQ(stats.total_tasks_executed, 11u);
+    EXPECT_GE(stats.average_task_duration, 1.5);
+}
+
+TEST(ThreadPoolTest, LowPriorityIsNotStarved) {
+    ThreadPool pool(1, 1);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.post([released]() { released.wait(); });
+    
+    // A flood of high-priority work queued ahead of one low-priority task
+    std::mutex order_mutex;
+    std::vector<ThreadPool::Priority> order;
+    auto record = [&](ThreadPool::Priority priority) {
+        return [&order_mutex, &order, priority]() {
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(priority);
+        };
+    };
+    for (int i = 0; i < 500; ++i) {
+        pool.post(record(ThreadPool::Priority::HIGH), ThreadPool::Priority::HIGH);
+    }
+    pool.post(record(ThreadPool::Priority::LOW), ThreadPool::Priority::LOW);
+    release.set_value();
+    pool.wait_for_all_tasks();
+    
+    // Weighted fair queuing gives the low lane a turn long before the flood drains
+    ASSERT_EQ(order.size(), 501u);
+    auto low = std::find(order.begin(), order.end(), ThreadPool::Priority::LOW);
+    EXPECT_LT(low - order.begin(), 100);
+    EXPECT_EQ(order.front(), ThreadPool::Priority::HIGH);
+}
+
+TEST(ThreadPoolTest, PinnedWorkersRunTasks) {
+    for (auto affinity : {ThreadPool::Affinity::CORE, ThreadPool::Affinity::NODE}) {
+        ThreadPool::ThreadPoolConfig config(2, 2);
+        config.affinity = affinity;
+        ThreadPool pool(config);
+        EXPECT_EQ(pool.get_node_count(), CpuTopology::get_instance().get_node_count());
+        
+        std::atomic<int> count{0};
+        for (size_t node = 0; node < pool.get_node_count(); ++node) {
+            pool.post_on_node(node, [&count]() { count++; });
+        }
+        int buffer = 0;
+        pool.post_near(&buffer, [&count]() { count++; });
+        pool.wait_for_all_tasks();
+        EXPECT_EQ(count.load(), static_cast<int>(pool.get_node_count()) + 1);
+        
+        std::vector<ThreadPool::WorkerUtilization> workers = pool.get_worker_utilization();
+        ASSERT_EQ(workers.size(), 2u);
+        for (const auto& worker : workers) {
+            EXPECT_LT(worker.node, pool.get_node_count());
+            EXPECT_GE(worker.utilization, 0.0);
+            EXPECT_LE(worker.utilization, 1.0);
+            if (affinity == ThreadPool::Affinity::NODE) {
+                EXPECT_EQ(worker.cpu, -1);
+            }
+        }
+    }
+}
+
+TEST(ParallelTest, ParallelForCoversRangeOnce) {
+    ThreadPool pool(2, 2);
+    std::vector<std::atomic<int>> hits(1003);
+    
+    parallel_for(pool, size_t(0), hits.size(), size_t(64), [&hits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            hits[i]++;
+        }
+    });
+    for (auto& hit : hits) {
+        EXPECT_EQ(hit.load(), 1);
+    }
+    
+    // An empty range calls nothing
+    parallel_for(pool, 5, 5, 1, [](int, int) { FAIL(); });
+}
+
+TEST(ParallelTest, ParallelReduceSums) {
+    ThreadPool pool(2, 2);
+    uint64_t sum = parallel_reduce(pool, uint64_t(1), uint64_t(100001), uint64_t(1000), uint64_t(0),
+        [](uint64_t begin, uint64_t end) {
+            uint64_t partial = 0;
+            for (uint64_t i = begin; i < end; ++i) {
+                partial += i;
+            }
+            return partial;
+        },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    EXPECT_EQ(sum, 5000050000ULL);
+}
+
+TEST(ParallelTest, NestedParallelForDoesNotDeadlock) {
+    ThreadPool pool(1, 1);
+    std::atomic<int> count{0};
+    
+    // The only worker waits on chunks it must run itself
+    auto outer = pool.enqueue([&]() {
+        parallel_for(pool, 0, 100, 1, [&count](int begin, int end) { count += end - begin; });
+    });
+    outer.get();
+    EXPECT_EQ(count.load(), 100);
+}
+
+TEST(ParallelTest, FirstExceptionIsRethrown) {
+    ThreadPool pool(2, 2);
+    EXPECT_THROW(run_chunks(pool, 50, [](size_t chunk) {
+        if (chunk == 10) {
+            throw std::invalid_argument("chunk failed");
+        }
+    }), std::invalid_argument);
+}
+
+TEST(TaskGraphTest, RunsInDependencyOrder) {
+    ThreadPool pool(2, 2);
+    TaskGraph graph(pool);
+    std::mutex order_mutex;
+    std::vector<int> order;
+    auto step = [&](int id) {
+        return [&order_mutex, &order, id]() {
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(id);
+        };
+    };
+    
+    // Diamond: 0 before 1 and 2, both before 3
+    TaskGraph::TaskId a = graph.add_task(step(0));
+    TaskGraph::TaskId b = graph.add_task(step(1));
+    TaskGraph::TaskId c = graph.add_task(step(2));
+    TaskGraph::TaskId d = graph.add_task(step(3));
+    graph.add_dependency(a, b);
+    graph.add_dependency(a, c);
+    graph.add_dependency(b, d);
+    graph.add_dependency(c, d);
+    EXPECT_EQ(graph.size(), 4u);
+    
+    for (int run = 0; run < 2; ++run) {
+        order.clear();
+        graph.run();
+        ASSERT_EQ(order.size(), 4u);
+        EXPECT_EQ(order.front(), 0);
+        EXPECT_EQ(order.back(), 3);
+    }
+}
+
+TEST(TaskGraphTest, ExceptionSkipsDependents) {
+    ThreadPool pool(2, 2);
+    TaskGraph graph(pool);
+    bool dependent_ran = false;
+    
+    TaskGraph::TaskId failing = graph.add_task([]() { throw std::runtime_error("task failed"); });
+    TaskGraph::TaskId dependent = graph.add_task([&dependent_ran]() { dependent_ran = true; });
+    graph.add_dependency(failing, dependent);
+    
+    EXPECT_THROW(graph.run(), std::runtime_error);
+    EXPECT_FALSE(dependent_ran);
+}
+
+TEST(TaskGraphTest, RejectsCycles) {
+    ThreadPool pool(1, 1);
+    TaskGraph graph(pool);
+    TaskGraph::TaskId a = graph.add_task([]() {});
+    TaskGraph::TaskId b = graph.add_task([]() {});
+    graph.add_dependency(a, b);
+    graph.add_dependency(b, a);
+    
+    EXPECT_THROW(graph.run(), std::invalid_argument);
+    EXPECT_THROW(graph.add_dependency(a, a), std::invalid_argument);
+    EXPECT_THROW(graph.add_dependency(a, 5), std::invalid_argument);
+}
+
+#ifdef DFS_HAVE_COROUTINES
+namespace {
+
+Task<int> add_on_pool(ThreadPool& pool, int a, int b) {
+    int first = co_await run_on(pool, [a]() { return a; });
+    EXPECT_TRUE(pool.is_worker_thread());
+    int second = co_await run_on(pool, [b]() { return b; });
+    co_return first + second;
+}
+
+Task<void> fail_on_pool(ThreadPool& pool) {
+    co_await schedule_on(pool);
+    throw std::runtime_error("coroutine failed");
+}
+
+} // namespace
+
+TEST(CoroutineTest, AwaitsWorkOnPool) {
+    ThreadPool pool(2, 2);
+    EXPECT_EQ(sync_wait(add_on_pool(pool, 2, 3)), 5);
+}
+
+TEST(CoroutineTest, ExceptionReachesAwaiter) {
+    ThreadPool pool(1, 1);
+    EXPECT_THROW(sync_wait(fail_on_pool(pool)), std::runtime_error);
+}
+#endif
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "core/transaction_manager.h"
+#include "core/superblock.h"
+#include <cstdio>
+#include <string>
+
+using namespace dfs::core;
+
+namespace {
+
+// Commit one transaction with the given number of log entries
+void commit_entries(TransactionManager& transactions, uint32_t count) {
+    uint64_t tx_id = transactions.begin_transaction();
+    for (uint32_t i = 0; i < count; ++i) {
+        LogEntry entry(tx_id, 1, 2, 100 + i);
+        entry.new_data.assign(16, static_cast<uint8_t>(i));
+        entry.update_checksum();
+        transactions.add_log_entry(tx_id, entry);
+    }
+    ASSERT_TRUE(transactions.commit_transaction(tx_id));
+}
+
+} // namespace
+
+TEST(TransactionManagerTest, RecoverSkipsReplayAfterCleanUnmount) {
+    std::string path = testing::TempDir() + "dfs_wal_clean.log";
+    std::remove(path.c_str());
+    {
+        TransactionManager transactions(path);
+        commit_entries(transactions, 3);
+    }
+    
+    SuperBlock superblock;
+    superblock.initialize(1024);
+    TransactionManager transactions(path);
+    
+    superblock.mark_clean();
+    EXPECT_EQ(transactions.recover(superblock), 0u);
+    
+    superblock.mark_dirty();
+    EXPECT_EQ(transactions.recover(superblock), 3u);
+    
+    std::remove(path.c_str());
+}
@@ -0,0 +1,451 @@
+#include <gtest/gtest.h>
+#include "utils/checksum.h"
+#include "utils/lz4.h"
+#include "utils/exceptions.h"
+#include "utils/work_stealing_deque.h"
+#include "utils/inline_task.h"
+#include "utils/block_pool.h"
+#include "utils/cpu_topology.h"
+#include "utils/mpsc_ring.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dfs::utils;
+
+TEST(ChecksumTest, Crc32cKnownVector) {
+    const std::string data = "123456789";
+    EXPECT_EQ(Checksum::crc32c(data.data(), data.size()), 0xE3069283u);
+    EXPECT_EQ(Checksum::crc32c(nullptr, 0), 0u);
+}
+
+TEST(ChecksumTest, Crc32cIsIncremental) {
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    
+    // Odd split points exercise the unaligned head and tail of the hardware path
+    uint32_t whole = Checksum::crc32c(data.data(), data.size());
+    uint32_t partial = Checksum::crc32c(data.data(), 333);
+    partial = Checksum::crc32c(data.data() + 333, data.size() - 333, partial);
+    EXPECT_EQ(partial, whole);
+}
+
+TEST(ChecksumTest, Xxh64KnownVectors) {
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    EXPECT_EQ(Checksum::xxh64("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(Checksum::xxh64(fox.data(), fox.size()), 0x0B242D361FDA71BCULL);
+    EXPECT_EQ(Checksum::xxh64(fox.data(), fox.size(), 1), 0xDF5091B6DAD2C6DBULL);
+    
+    // Longer than one 32-byte stripe, with a tail
+    std::string data;
+    for (int i = 0; i < 5; ++i) {
+        for (int byte = 0; byte < 256; ++byte) {
+            data.push_back(static_cast<char>(byte));
+        }
+    }
+    data += fox;
+    EXPECT_EQ(Checksum::xxh64(data.data(), data.size()), 0x6A4CECEEA1A78E9BULL);
+}
+
+TEST(ChecksumTest, Xxh3_128KnownVectors) {
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    std::string data;
+    for (int i = 0; i < 5; ++i) {
+        for (int byte = 0; byte < 256; ++byte) {
+            data.push_back(static_cast<char>(byte));
+        }
+    }
+    data += fox;
+    
+    // One input per length class: empty, 4-8, 17-128, 129-240 and long
+    struct Vector {
+        const char* data;
+        size_t size;
+        uint64_t low;
+        uint64_t high;
+    };
+    const Vector vectors[] = {
+        {"", 0, 0x6001C324468D497FULL, 0x99AA06D3014798D8ULL},
+        {fox.data(), 8, 0xCDD8FDE3D093FCE5ULL, 0xED018A48369E32F4ULL},
+        {fox.data(), fox.size(), 0x24A1CC2E3A8A7651ULL, 0xDDD650205CA3E7FAULL},
+        {data.data(), 200, 0xDD97E9AF3609D9F5ULL, 0xCB0395310643BA0EULL},
+        {data.data(), data.size(), 0x474657260B90E68CULL, 0x0C2EB058772E6BC0ULL},
+    };
+    for (const Vector& vector : vectors) {
+        Checksum::Hash128 hash = Checksum::xxh3_128(vector.data, vector.size);
+        EXPECT_EQ(hash.low, vector.low) << vector.size;
+        EXPECT_EQ(hash.high, vector.high) << vector.size;
+    }
+}
+
+TEST(ChecksumTest, Xxh32KnownVectors) {
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    EXPECT_EQ(Checksum::xxh32("", 0), 0x02CC5D05u);
+    EXPECT_EQ(Checksum::xxh32(fox.data(), fox.size()), 0xE85EA4DEu);
+    
+    std::string data;
+    for (int i = 0; i < 5; ++i) {
+        for (int byte = 0; byte < 256; ++byte) {
+            data.push_back(static_cast<char>(byte));
+        }
+    }
+    data += fox;
+    EXPECT_EQ(Checksum::xxh32(data.data(), data.size()), 0x41BCAF3Du);
+}
+
+namespace {
+
+std::vector<uint8_t> lz4_round_trip(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> compressed(Lz4::compress_bound(data.size()));
+    size_t compressed_size = Lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+    EXPECT_GT(compressed_size, 0u);
+    
+    std::vector<uint8_t> decompressed(data.size());
+    size_t size = Lz4::decompress(compressed.data(), compressed_size, decompressed.data(), decompressed.size());
+    EXPECT_EQ(size, data.size());
+    return decompressed;
+}
+
+uint32_t read_le32(const std::string& bytes, size_t offset) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+TEST(Lz4Test, RoundTripCompressibleData) {
+    std::vector<uint8_t> data;
+    while (data.size() < 64 * 1024) {
+        const std::string line = "block " + std::to_string(data.size() % 97) + " of the file system\n";
+        data.insert(data.end(), line.begin(), line.end());
+    }
+    
+    std::vector<uint8_t> compressed(Lz4::compress_bound(data.size()));
+    size_t compressed_size = Lz4::compress(data.data(), data.size(), compressed.data(), compressed.size());
+    EXPECT_LT(compressed_size, data.size() / 4);
+    
+    EXPECT_EQ(lz4_round_trip(data), data);
+}
+
+TEST(Lz4Test, RoundTripIncompressibleAndTinyData) {
+    std::vector<uint8_t> random(10000);
+    uint32_t state = 12345;
+    for (uint8_t& byte : random) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+    EXPECT_EQ(lz4_round_trip(random), random);
+    
+    for (size_t size : {1, 5, 12, 13}) {
+        std::vector<uint8_t> tiny(size, 'a');
+        EXPECT_EQ(lz4_round_trip(tiny), tiny);
+    }
+}
+
+TEST(Lz4Test, DecompressesReferenceBlock) {
+    // "abc" repeated 14 times, as compressed by the reference implementation
+    const uint8_t reference[] = {0x3f, 0x61, 0x62, 0x63, 0x03, 0x00, 0x0f,
+                                 0x50, 0x62, 0x63, 0x61, 0x62, 0x63};
+    std::string expected;
+    for (int i = 0; i < 14; ++i) {
+        expected += "abc";
+    }
+    
+    std::vector<char> output(expected.size());
+    size_t size = Lz4::decompress(reference, sizeof(reference), output.data(), output.size());
+    EXPECT_EQ(std::string(output.data(), size), expected);
+}
+
+TEST(Lz4Test, RejectsCorruptInput) {
+    // Match offset pointing before the start of the output
+    const uint8_t corrupt[] = {0x14, 0x61, 0x10, 0x00, 0x50, 0x61, 0x61, 0x61, 0x61, 0x61};
+    std::vector<uint8_t> output(64);
+    EXPECT_THROW(Lz4::decompress(corrupt, sizeof(corrupt), output.data(), output.size()),
+                 dfs::utils::FileSystemCorruptedException);
+}
+
+TEST(Lz4Test, FrameHasValidHeaderAndBlocks) {
+    std::string data;
+    while (data.size() < 100000) {
+        data += "log line " + std::to_string(data.size()) + "\n";
+    }
+    
+    std::istringstream in(data);
+    std::ostringstream out;
+    Lz4::compress_frame(in, out);
+    const std::string frame = out.str();
+    
+    ASSERT_GE(frame.size(), 11u);
+    EXPECT_EQ(read_le32(frame, 0), 0x184D2204u);
+    EXPECT_EQ(static_cast<uint8_t>(frame[6]),
+              static_cast<uint8_t>(Checksum::xxh32(frame.data() + 4, 2) >> 8));
+    
+    // Walk the blocks, verifying each checksum, up to the end mark
+    std::string decoded;
+    size_t offset = 7;
+    while (true) {
+        uint32_t header = read_le32(frame, offset);
+        offset += 4;
+        if (header == 0) {
+            break;
+        }
+        
+        uint32_t size = header & 0x7FFFFFFFU;
+        EXPECT_EQ(read_le32(frame, offset + size), Checksum::xxh32(frame.data() + offset, size));
+        if (header & 0x80000000U) {
+            decoded.append(frame, offset, size);
+        } else {
+            std::vector<char> block(4 * 1024 * 1024);
+            size_t block_size = Lz4::decompress(frame.data() + offset, size, block.data(), block.size());
+            decoded.append(block.data(), block_size);
+        }
+        offset += size + 4;
+    }
+    
+    EXPECT_EQ(offset, frame.size());
+    EXPECT_EQ(decoded, data);
+}
+
+TEST(WorkStealingDequeTest, OwnerPopsLifoThiefStealsFifo) {
+    WorkStealingDeque<int> deque(4);
+    for (int i = 0; i < 10; ++i) {
+        deque.push(i);
+    }
+    EXPECT_EQ(deque.size(), 10u);
+    
+    int item = -1;
+    ASSERT_TRUE(deque.pop(item));
+    EXPECT_EQ(item, 9);
+    ASSERT_TRUE(deque.steal(item));
+    EXPECT_EQ(item, 0);
+    ASSERT_TRUE(deque.steal(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_EQ(deque.size(), 7u);
+}
+
+TEST(WorkStealingDequeTest, EmptyDequeYieldsNothing) {
+    WorkStealingDeque<int> deque;
+    int item = -1;
+    EXPECT_FALSE(deque.pop(item));
+    EXPECT_FALSE(deque.steal(item));
+    EXPECT_TRUE(deque.empty());
+}
+
+TEST(WorkStealingDequeTest, EveryItemTakenExactlyOnce) {
+    const int item_count = 100000;
+    WorkStealingDeque<int> deque(16);
+    std::vector<std::atomic<int>> taken(item_count);
+    std::atomic<bool> done{false};
+    
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&]() {
+            int item;
+            while (!done.load() || !deque.empty()) {
+                if (deque.steal(item)) {
+                    taken[item]++;
+                }
+            }
+        });
+    }
+    
+    // The owner pushes in bursts, growing the ring, and pops some back
+    int item;
+    for (int i = 0; i < item_count; ++i) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(item)) {
+            taken[item]++;
+        }
+    }
+    while (deque.pop(item)) {
+        taken[item]++;
+    }
+    done = true;
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+    
+    for (int i = 0; i < item_count; ++i) {
+        ASSERT_EQ(taken[i].load(), 1) << "item " << i;
+    }
+}
+
+TEST(InlineTaskTest, SmallCallableIsStoredInline) {
+    int calls = 0;
+    auto small = [&calls]() { calls++; };
+    static_assert(InlineTask::fits_inline<decltype(small)>(), "small lambda should fit inline");
+    
+    InlineTask task(small);
+    ASSERT_TRUE(task);
+    task();
+    task();
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(InlineTaskTest, LargeCallableMovesToHeap) {
+    std::array<uint64_t, 32> payload{};
+    payload[31] = 42;
+    uint64_t seen = 0;
+    auto large = [payload, &seen]() { seen = payload[31]; };
+    static_assert(!InlineTask::fits_inline<decltype(large)>(), "large lambda should not fit inline");
+    
+    InlineTask task(large);
+    InlineTask moved(std::move(task));
+    EXPECT_FALSE(task);
+    moved();
+    EXPECT_EQ(seen, 42u);
+}
+
+TEST(InlineTaskTest, HoldsMoveOnlyCallables) {
+    std::promise<int> promise;
+    std::future<int> future = promise.get_future();
+    
+    InlineTask task([promise = std::move(promise)]() mutable { promise.set_value(7); });
+    InlineTask assigned;
+    assigned = std::move(task);
+    assigned();
+    EXPECT_EQ(future.get(), 7);
+}
+
+TEST(InlineTaskTest, DestroysCapturedState) {
+    auto counter = std::make_shared<int>(0);
+    {
+        InlineTask task([counter]() {});
+        EXPECT_EQ(counter.use_count(), 2);
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+}
+
+TEST(BlockPoolTest, RecyclesBlocksAcrossThreads) {
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; ++i) {
+        void* block = BlockPool::allocate(48);
+        std::memset(block, 0xAB, 48);
+        blocks.push_back(block);
+    }
+    
+    // Freed on another thread, as with tasks run by a pool worker
+    std::thread([&blocks]() {
+        for (void* block : blocks) {
+            BlockPool::deallocate(block, 48);
+        }
+    }).join();
+    
+    for (int i = 0; i < 1000; ++i) {
+        void* block = BlockPool::allocate(48);
+        std::memset(block, 0xCD, 48);
+        BlockPool::deallocate(block, 48);
+    }
+    
+    // Oversized requests go to the general-purpose heap
+    void* large = BlockPool::allocate(BlockPool::MAX_BLOCK_SIZE + 1);
+    std::memset(large, 0, BlockPool::MAX_BLOCK_SIZE + 1);
+    BlockPool::deallocate(large, BlockPool::MAX_BLOCK_SIZE + 1);
+}
+
+TEST(BlockPoolTest, PoolAllocatorBacksStandardContainers) {
+    std::vector<int, PoolAllocator<int>> values;
+    for (int i = 0; i < 50; ++i) {
+        values.push_back(i);
+    }
+    EXPECT_EQ(values[49], 49);
+    
+    std::promise<int> promise(std::allocator_arg, PoolAllocator<int>());
+    std::future<int> future = promise.get_future();
+    promise.set_value(3);
+    EXPECT_EQ(future.get(), 3);
+}
+
+TEST(CpuTopologyTest, ParsesKernelCpuLists) {
+    EXPECT_EQ(CpuTopology::parse_cpu_list("0-3,8,10-11"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(CpuTopology::parse_cpu_list("5\n"), std::vector<int>({5}));
+    EXPECT_TRUE(CpuTopology::parse_cpu_list("").empty());
+}
+
+TEST(CpuTopologyTest, EveryNodeHasCpus) {
+    const CpuTopology& topology = CpuTopology::get_instance();
+    ASSERT_GE(topology.get_node_count(), 1u);
+    
+    for (size_t index = 0; index < topology.get_node_count(); ++index) {
+        const CpuTopology::Node& node = topology.get_nodes()[index];
+        ASSERT_FALSE(node.cpus.empty());
+        EXPECT_EQ(topology.node_of_cpu(node.cpus.front()), index);
+    }
+    EXPECT_LT(topology.current_node(), topology.get_node_count());
+}
+
+TEST(MpscRingTest, ConsumesInOrder) {
+    MpscRing<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+    
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.try_push([i](int& slot) { slot = i; }));
+    }
+    EXPECT_FALSE(ring.try_push([](int& slot) { slot = 99; }));
+    EXPECT_EQ(ring.size(), 4u);
+    
+    std::vector<int> consumed;
+    EXPECT_EQ(ring.consume([&consumed](int& value) { consumed.push_back(value); }, 2), 2u);
+    EXPECT_EQ(ring.consume([&consumed](int& value) { consumed.push_back(value); }, 10), 2u);
+    EXPECT_EQ(consumed, std::vector<int>({0, 1, 2, 3}));
+    EXPECT_FALSE(ring.ready());
+}
+
+TEST(MpscRingTest, BatchPushIsContiguous) {
+    MpscRing<int> ring(8);
+    EXPECT_TRUE(ring.try_push([](int& slot) { slot = -1; }));
+    EXPECT_TRUE(ring.try_push_batch(5, [](int& slot, size_t i) { slot = static_cast<int>(i); }));
+    
+    // Only two slots are left
+    EXPECT_FALSE(ring.try_push_batch(3, [](int& slot, size_t) { slot = 99; }));
+    EXPECT_FALSE(ring.try_push_batch(9, [](int& slot, size_t) { slot = 99; }));
+    
+    std::vector<int> consumed;
+    ring.consume([&consumed](int& value) { consumed.push_back(value); }, 10);
+    EXPECT_EQ(consumed, std::vector<int>({-1, 0, 1, 2, 3, 4}));
+}
+
+TEST(MpscRingTest, ConcurrentProducersLoseNothing) {
+    const int producers = 4;
+    const int per_producer = 20000;
+    MpscRing<std::pair<int, int>> ring(256);
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ring, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                while (!ring.try_push([p, i](std::pair<int, int>& slot) { slot = {p, i}; })) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    
+    // Each producer's items arrive in the order it pushed them
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    while (received < producers * per_producer) {
+        received += static_cast<int>(ring.consume([&next](std::pair<int, int>& item) {
+            EXPECT_EQ(item.second, next[item.first]);
+            next[item.first] = item.second + 1;
+        }, 64));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    for (int p = 0; p < producers; ++p) {
+        EXPECT_EQ(next[p], per_producer);
+    }
+}